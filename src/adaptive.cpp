@@ -0,0 +1,110 @@
+#include "adaptive.h"
+#include <chrono>
+
+using namespace sdr;
+
+// weight of a new measurement in the cost model
+static const double ALPHA = 0.125;
+// number of blocks that drain the input before the block shrinks
+static const size_t IDLE_BLOCKS = 4;
+
+// steady clock in s
+static double now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Block sizer
+// Constructor
+BlockSizer::BlockSizer(double sampleRate, double latency, size_t minBlock, size_t maxBlock)
+  : _rate(sampleRate), _budget(latency), _min(std::max(size_t(1), minBlock)),
+    _max(std::max(_min, maxBlock)), _block(_min), _limit(_max),
+    _n(0), _c(0), _nn(0), _nc(0), _count(0), _overhead(0), _per_sample(0),
+    _idle(0), _grown(0), _shrunk(0)
+{
+  fit();
+}
+
+// Destructor
+BlockSizer::~BlockSizer() {}
+
+size_t BlockSizer::update(size_t N, double cost, size_t queued) {
+  if (N) {
+    // exponentially weighted moments, the first measurement initializes
+    double a = _count ? ALPHA : 1.0, n = double(N);
+    _n += a*(n-_n); _c += a*(cost-_c);
+    _nn += a*(n*n-_nn); _nc += a*(n*cost-_nc);
+    _count++;
+    fit();
+  }
+
+  size_t next = _block;
+  if (queued >= _block) {
+    // another full block is waiting: amortize the overhead
+    _idle = 0;
+    next = clamp(2*_block);
+  } else if (queued < _min) {
+    // drained the input: lower the latency
+    if (++_idle >= IDLE_BLOCKS) { _idle = 0; next = clamp(_block/2); }
+  } else {
+    _idle = 0;
+  }
+  // the limit may have dropped
+  next = clamp(next);
+  if (next > _block) { _grown++; }
+  if (next < _block) { _shrunk++; }
+  _block = next;
+  return _block;
+}
+
+void BlockSizer::reset() {
+  _block = _min;
+  _idle = 0;
+}
+
+void BlockSizer::fit() {
+  // least squares fit of cost = overhead + N*perSample
+  double var = _nn - _n*_n, cov = _nc - _n*_c;
+  _overhead = 0; _per_sample = (_n > 0) ? _c/_n : 0;
+  if (var > (1e-4*_n*_n)) {
+    double slope = cov/var, intercept = _c - slope*_n;
+    // without a meaningful split, the average cost per sample is a
+    // conservative estimate for larger blocks
+    if ((slope >= 0) && (intercept >= 0)) { _per_sample = slope; _overhead = intercept; }
+  }
+  // largest block within the budget: N/fs + overhead + N*perSample <= budget
+  double room = _budget - _overhead;
+  double N = (room > 0) ? room/(1.0/_rate + _per_sample) : 0;
+  _limit = (N >= double(_max)) ? _max : std::max(_min, size_t(N));
+}
+
+size_t BlockSizer::clamp(size_t N) const {
+  N = std::min(N, std::min(_max, _limit));
+  N = std::max(N, _min);
+  return N - (N % _min);
+}
+
+
+// Adaptive stage
+// Constructor
+AdaptiveStage::AdaptiveStage(double sampleRate, double latency, size_t minBlock, size_t maxBlock)
+  : Stage(), _sizer(sampleRate, latency, minBlock, maxBlock), _last(now())
+{}
+
+// Destructor
+AdaptiveStage::~AdaptiveStage() {}
+
+bool AdaptiveStage::ready() const {
+  size_t block = _sizer.block(), N = queued();
+  if (N >= block) { return space() >= block; }
+  // a partial block once a full one would have arrived at the sample rate
+  return (N > 0) && (space() >= N) && ((now()-_last) >= (block/_sizer.rate()));
+}
+
+void AdaptiveStage::process() {
+  size_t N = std::min(queued(), _sizer.block());
+  double start = now();
+  processBlock(N);
+  _last = now();
+  _sizer.update(N, _last-start, queued());
+}
@@ -0,0 +1,240 @@
+#ifndef __SDR_ADAPTIVE_H__
+#define __SDR_ADAPTIVE_H__
+
+#include "buffer.h"
+#include "scheduler.h"
+#include <functional>
+
+namespace sdr {
+
+  // Latency-bounded adaptive block sizing.
+  //
+  // A stage states its latency budget: the time a sample may spend from its
+  // arrival in the input ring until it left the stage. A block of N samples
+  // takes N/fs to accumulate and cost(N) = overhead + N*perSample to
+  // process. The cost model is fitted to the measured cost of the processed
+  // blocks, the block size is limited to the largest N with
+  // N/fs + cost(N) <= budget.
+  //
+  // Within this limit, the block grows (doubles) while the input ring holds
+  // another full block after processing, i.e. the stage falls behind and
+  // needs to amortize its per-block overhead. It shrinks (halves) once the
+  // input ran dry for several blocks, small blocks then minimize the latency
+  // at no cost in throughput. Block sizes are multiples of the minimum block.
+  class BlockSizer {
+    public:
+      // Constructor with sample rate (Hz), latency budget (s) and block size
+      // range, the initial block size is the minimum
+      BlockSizer(double sampleRate, double latency, size_t minBlock=64, size_t maxBlock=65536);
+
+      // Destructor
+      virtual ~BlockSizer();
+
+      // Inline helper functions
+      // returns the sample rate
+      inline double rate() const { return _rate; }
+      // returns the current block size
+      inline size_t block() const { return _block; }
+      // returns the largest block size within the latency budget
+      inline size_t limit() const { return _limit; }
+      // returns the fitted per-block overhead in s
+      inline double overhead() const { return _overhead; }
+      // returns the fitted cost per sample in s
+      inline double perSample() const { return _per_sample; }
+      // returns the predicted processing time of N samples in s
+      inline double cost(size_t N) const { return _overhead + N*_per_sample; }
+      // returns the predicted latency of the current block size in s
+      inline double latency() const { return _block/_rate + cost(_block); }
+      // returns the fraction of real time needed at the current block size,
+      // above 1 the stage cannot keep up at any block size within the budget
+      inline double load() const { return cost(_block)*_rate/_block; }
+      // returns the number of times the block grew
+      inline size_t grown() const { return _grown; }
+      // returns the number of times the block shrank
+      inline size_t shrunk() const { return _shrunk; }
+
+      // Records the processing of N samples which took cost seconds, queued
+      // samples remained in the input. Returns the next block size.
+      size_t update(size_t N, double cost, size_t queued);
+
+      // Restarts at the minimum block size, keeps the cost model
+      void reset();
+
+    protected:
+      // refits the cost model and updates the latency limit
+      void fit();
+      // rounds down to a multiple of the minimum block within the limits
+      size_t clamp(size_t N) const;
+
+    protected:
+      // sample rate
+      double _rate;
+      // latency budget
+      double _budget;
+      // block size range
+      size_t _min, _max;
+      // current block size
+      size_t _block;
+      // latency-bounded maximum
+      size_t _limit;
+      // exponentially weighted moments of block size and cost
+      double _n, _c, _nn, _nc;
+      // number of measurements
+      size_t _count;
+      // fitted cost model
+      double _overhead, _per_sample;
+      // consecutive blocks that drained the input
+      size_t _idle;
+      // statistics
+      size_t _grown, _shrunk;
+  };
+
+
+  // A stage with an adaptive block size, see BlockSizer.
+  //
+  // Sub-classes report the queued input and the free output space (in input
+  // samples) and process blocks of the given size. The stage is ready once a
+  // full block is queued and fits into the output, hence a full output ring
+  // holds back this stage and everything upstream of it. If the input
+  // arrives slower than the sample rate (or stops), the queued samples are
+  // processed as a partial block once a full block would have arrived.
+  class AdaptiveStage: public Stage {
+    public:
+      // Constructor with sample rate (Hz), latency budget (s) and block size range
+      AdaptiveStage(double sampleRate, double latency, size_t minBlock=64, size_t maxBlock=65536);
+
+      // Destructor
+      virtual ~AdaptiveStage();
+
+      // Returns the block sizer
+      inline const BlockSizer &sizer() const { return _sizer; }
+
+      // Needs to be implemented by sub-classes: returns the number of samples
+      // queued in the input
+      virtual size_t queued() const = 0;
+      // Needs to be implemented by sub-classes: returns the free output space
+      // in input samples
+      virtual size_t space() const = 0;
+      // Needs to be implemented by sub-classes: processes N input samples
+      virtual void processBlock(size_t N) = 0;
+
+      // Returns true if a full block (or an overdue partial block) is queued
+      // and fits into the output
+      virtual bool ready() const;
+      // Processes one block, measures its cost and adapts the block size
+      virtual void process();
+
+    protected:
+      // block sizer
+      BlockSizer _sizer;
+      // end of the last block (steady clock, s)
+      double _last;
+  };
+
+
+  // A circular buffer which signals its fill level upstream.
+  //
+  // The flow state is FLOW_OK until the fill level reaches the high mark,
+  // then FLOW_SLOW (the producer should reduce its block rate, e.g. skip
+  // optional work or decimate earlier). A rejected push sets FLOW_STOP. The
+  // state returns to FLOW_OK once the fill level fell to the low mark. The
+  // listener is called on every change, in the thread that caused it. Use
+  // the functions of this class (not those of the base) to keep the state
+  // up to date.
+  template <class Scalar>
+  class FlowControlBuffer: public CircularBuffer<Scalar> {
+    public:
+      // Flow state
+      typedef enum {
+        FLOW_OK,   // below the high mark
+        FLOW_SLOW, // above the high mark
+        FLOW_STOP  // a push was rejected
+      } Flow;
+
+    public:
+      // Constructor with size N and high and low marks (fractions of N)
+      FlowControlBuffer(size_t N, double high=0.75, double low=0.5)
+        : CircularBuffer<Scalar>(N), _high(size_t(high*N)), _low(size_t(low*N)), _flow(FLOW_OK),
+          _listener(), _rejected(0), _signals(0) {}
+
+      // Destructor
+      virtual ~FlowControlBuffer() {}
+
+      // Inline helper functions
+      // returns the flow state
+      inline Flow flow() const { return _flow; }
+      // returns the number of samples rejected by push
+      inline size_t rejected() const { return _rejected; }
+      // returns the number of state changes
+      inline size_t signals() const { return _signals; }
+      // sets the function called on state changes
+      inline void setListener(const std::function<void(Flow)> &listener) { _listener = listener; }
+
+      // Pushes the samples, returns the flow state afterwards (FLOW_STOP if
+      // they were rejected)
+      Flow offer(const Buffer<Scalar> &data) {
+        if (! CircularBuffer<Scalar>::push(data)) {
+          _rejected += data.size();
+          signal(FLOW_STOP);
+          return _flow;
+        }
+        update();
+        return _flow;
+      }
+
+      // push samples, returns false if they were rejected (see offer())
+      inline bool push(const Buffer<Scalar> &data) { return FLOW_STOP != offer(data); }
+
+      // pull N samples into dest
+      inline bool pull(const Buffer<Scalar> &dest, size_t N) {
+        if (! CircularBuffer<Scalar>::pull(dest, N)) { return false; }
+        update();
+        return true;
+      }
+
+      // delete N elements from buffer
+      inline void drop(size_t N) {
+        CircularBuffer<Scalar>::drop(N);
+        update();
+      }
+
+      // makes N elements written into the free spans readable
+      inline void commit(size_t N) {
+        CircularBuffer<Scalar>::commit(N);
+        update();
+      }
+
+    protected:
+      // updates the state from the fill level (with hysteresis)
+      inline void update() {
+        size_t n = this->stored();
+        if (n >= _high) { signal((FLOW_STOP == _flow) ? FLOW_STOP : FLOW_SLOW); }
+        else if (n <= _low) { signal(FLOW_OK); }
+        else if (FLOW_STOP == _flow) { signal(FLOW_SLOW); }
+      }
+      // changes the state and notifies the listener
+      inline void signal(Flow flow) {
+        if (flow == _flow) { return; }
+        _flow = flow;
+        _signals++;
+        if (_listener) { _listener(flow); }
+      }
+
+    protected:
+      // high mark in samples
+      size_t _high;
+      // low mark in samples
+      size_t _low;
+      // flow state
+      Flow _flow;
+      // state change listener
+      std::function<void(Flow)> _listener;
+      // rejected samples
+      size_t _rejected;
+      // number of state changes
+      size_t _signals;
+  };
+
+}
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef __SDR_BROADCAST_H__
+#define __SDR_BROADCAST_H__
+
+#include "buffer.h"
+#include <atomic>
+#include <memory>
+
+namespace sdr {
+
+  // A ring buffer with a single writer and several independent readers.
+  //
+  // The writer pushes every block once, each registered reader has its own
+  // read cursor and consumes at its own pace. Readers get zero-copy views
+  // into the ring storage by peek() and release them by drop(). The writer
+  // and the readers may run in different threads (one thread per reader).
+  //
+  // Space is reclaimed once the slowest reader has dropped the data. With the
+  // SKIP_LAGGING policy, the writer never blocks but moves the cursor of
+  // readers that fall more than the ring size behind. Such readers lose data,
+  // which is counted by skipped(). Data in a view held by a skipped reader
+  // may be overwritten: release views with the cursor returned by peek(),
+  // that drop() fails if the reader was skipped in the meantime.
+  template <class Scalar>
+  class BroadcastBuffer {
+    public:
+      // Space reclaim policy
+      typedef enum {
+        WAIT_FOR_SLOWEST, // push fails until the slowest reader made room
+        SKIP_LAGGING      // push always succeeds, lagging readers are skipped
+      } Policy;
+
+    protected:
+      // State of a reader slot
+      struct Reader {
+        Reader() : active(false), take(0), skipped(0) {}
+        // slot is in use
+        std::atomic<bool> active;
+        // read cursor (total number of elements consumed)
+        std::atomic<uint64_t> take;
+        // number of elements lost by this reader
+        std::atomic<uint64_t> skipped;
+      };
+
+    public:
+      // Condition: at least N elements available for a reader or free for
+      // the writer (reader -1), coroutine.h makes it awaitable
+      class Condition {
+        public:
+          Condition(const BroadcastBuffer &buffer, int reader, size_t N)
+            : _buffer(buffer), _reader(reader), _N(N) {}
+          // returns true if the condition holds
+          inline bool holds() const {
+            return (0 > _reader) ? (_buffer.free() >= _N) : (_buffer.available(_reader) >= _N);
+          }
+          // returns the buffer (as reported to the RingObserver)
+          inline const void *source() const { return &_buffer; }
+        protected:
+          const BroadcastBuffer &_buffer;
+          int _reader;
+          size_t _N;
+      };
+
+      // Constructor with ring size N (in elements), maximum number of readers
+      // and reclaim policy
+      BroadcastBuffer(size_t N, size_t maxReaders=8, Policy policy=WAIT_FOR_SLOWEST)
+        : _storage(N), _size(N), _policy(policy), _put(0), _maxReaders(maxReaders),
+          _readers(new Reader[maxReaders])
+      {}
+
+      // Destructor
+      virtual ~BroadcastBuffer() {}
+
+      // Inline helper functions
+      // returns the size of the ring buffer
+      inline size_t size() const { return _size; }
+      // returns the reclaim policy
+      inline Policy policy() const { return _policy; }
+      // returns the total number of elements written (write cursor)
+      inline uint64_t written() const { return _put.load(std::memory_order_acquire); }
+
+      // READERS
+      // registers a new reader starting at the current write position,
+      // returns the reader id or -1 if all slots are in use
+      inline int addReader() {
+        for (size_t i=0; i<_maxReaders; i++) {
+          bool expected = false;
+          if (_readers[i].active.load(std::memory_order_relaxed)) { continue; }
+          _readers[i].take.store(_put.load(std::memory_order_acquire), std::memory_order_relaxed);
+          _readers[i].skipped.store(0, std::memory_order_relaxed);
+          if (_readers[i].active.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            return int(i);
+        }
+        return -1;
+      }
+
+      // unregisters a reader, its data no longer holds back the writer
+      inline void removeReader(int reader) {
+        if (isReader(reader)) {
+          _readers[reader].active.store(false, std::memory_order_release);
+          RingObserver::notify(this);
+        }
+      }
+
+      // returns true if the given id is a registered reader
+      inline bool isReader(int reader) const {
+        return (reader >= 0) && (size_t(reader) < _maxReaders) &&
+            _readers[reader].active.load(std::memory_order_acquire);
+      }
+
+      // returns the number of elements available for the given reader
+      inline size_t available(int reader) const {
+        if (! isReader(reader)) { return 0; }
+        return size_t(_put.load(std::memory_order_acquire) -
+                      _readers[reader].take.load(std::memory_order_acquire));
+      }
+
+      // condition: at least n elements available for the given reader
+      inline Condition readable(int reader, size_t n) const { return Condition(*this, reader, n); }
+
+      // condition: space for at least n elements
+      inline Condition writable(size_t n) const { return Condition(*this, -1, n); }
+
+      // returns the number of elements the given reader has lost
+      inline uint64_t skipped(int reader) const {
+        if (! isReader(reader)) { return 0; }
+        return _readers[reader].skipped.load(std::memory_order_acquire);
+      }
+
+      // returns a zero-copy view of at most n elements for the given reader.
+      // The view ends at the end of the ring storage, hence it may be shorter
+      // than the available data. Returns an empty buffer if nothing is
+      // available. The read cursor of the view is stored in from (if given).
+      inline Buffer<Scalar> peek(int reader, size_t n, uint64_t *from=0) const {
+        if (! isReader(reader)) { return Buffer<Scalar>(); }
+        uint64_t take = _readers[reader].take.load(std::memory_order_acquire);
+        size_t len = std::min(n, size_t(_put.load(std::memory_order_acquire) - take));
+        if (from) { *from = take; }
+        if (0 == len) { return Buffer<Scalar>(); }
+        size_t idx = take % _size;
+        return _storage.sub(idx, std::min(len, _size-idx));
+      }
+
+      // releases at most n elements from the current read cursor of the
+      // given reader (use the form below to release a view)
+      inline void drop(int reader, size_t n) {
+        if (! isReader(reader)) { return; }
+        std::atomic<uint64_t> &take = _readers[reader].take;
+        uint64_t cur = take.load(std::memory_order_acquire);
+        uint64_t put = _put.load(std::memory_order_acquire);
+        uint64_t target = std::min(cur+n, put);
+        // the writer may move the cursor past target in the meantime (SKIP_LAGGING)
+        while ((cur < target) && (! take.compare_exchange_weak(cur, target, std::memory_order_acq_rel))) {}
+        RingObserver::notify(this);
+      }
+
+      // releases at most n elements of a view whose read cursor was from
+      // (see peek()). Returns false and releases nothing if the reader was
+      // skipped since, the view may then have been overwritten.
+      inline bool drop(int reader, size_t n, uint64_t from) {
+        if (! isReader(reader)) { return false; }
+        uint64_t target = std::min(from+n, _put.load(std::memory_order_acquire));
+        if (! _readers[reader].take.compare_exchange_strong(from, std::max(from, target), std::memory_order_acq_rel)) {
+          return false;
+        }
+        RingObserver::notify(this);
+        return true;
+      }
+
+      // copies n elements into dest for the given reader and releases them,
+      // returns false if less than n elements are available, dest is too
+      // small or the reader was skipped during the copy (dest is then
+      // incomplete, the lost elements are counted by skipped())
+      inline bool pull(int reader, const Buffer<Scalar> &dest, size_t n) {
+        if ((n > dest.size()) || (n > available(reader))) { return false; }
+        size_t done = 0;
+        while (done < n) {
+          uint64_t from;
+          Buffer<Scalar> view = peek(reader, n-done, &from);
+          if (0 == view.size()) { return false; }
+          std::memcpy(dest.data()+done*sizeof(Scalar), view.data(), view.bytesLen());
+          if (! drop(reader, view.size(), from)) { return false; }
+          done += view.size();
+        }
+        return true;
+      }
+
+      // WRITER
+      // returns the number of free elements (with respect to the slowest reader)
+      inline size_t free() const {
+        uint64_t put = _put.load(std::memory_order_relaxed);
+        return _size - size_t(put-slowest(put));
+      }
+
+      // pushes the data into the ring, returns false if the data does not fit
+      // (WAIT_FOR_SLOWEST policy) or is larger than the ring.
+      inline bool push(const Buffer<Scalar> &data) {
+        size_t n = data.size();
+        if (n > _size) { return false; }
+        uint64_t put = _put.load(std::memory_order_relaxed);
+        if (n > (_size - size_t(put-slowest(put)))) {
+          if (WAIT_FOR_SLOWEST == _policy) { return false; }
+          skipLagging(put+n-_size);
+        }
+        // store data (in two parts if wrapped around)
+        size_t idx = put % _size, num_a = std::min(n, _size-idx);
+        std::memcpy(_storage.data()+idx*sizeof(Scalar), data.data(), num_a*sizeof(Scalar));
+        std::memcpy(_storage.data(), data.data()+num_a*sizeof(Scalar), (n-num_a)*sizeof(Scalar));
+        _put.store(put+n, std::memory_order_release);
+        RingObserver::notify(this);
+        return true;
+      }
+
+    protected:
+      // returns the read cursor of the slowest reader (put if there are none)
+      inline uint64_t slowest(uint64_t put) const {
+        uint64_t min = put;
+        for (size_t i=0; i<_maxReaders; i++) {
+          if (! _readers[i].active.load(std::memory_order_acquire)) { continue; }
+          min = std::min(min, _readers[i].take.load(std::memory_order_acquire));
+        }
+        return min;
+      }
+
+      // moves all readers behind the given cursor forward
+      inline void skipLagging(uint64_t cursor) {
+        for (size_t i=0; i<_maxReaders; i++) {
+          if (! _readers[i].active.load(std::memory_order_acquire)) { continue; }
+          uint64_t cur = _readers[i].take.load(std::memory_order_acquire);
+          while ((cur < cursor) &&
+                 (! _readers[i].take.compare_exchange_weak(cur, cursor, std::memory_order_acq_rel))) {}
+          if (cur < cursor) { _readers[i].skipped.fetch_add(cursor-cur, std::memory_order_acq_rel); }
+        }
+      }
+
+    protected:
+      // ring storage
+      Buffer<Scalar> _storage;
+      // size of the ring in elements
+      size_t _size;
+      // reclaim policy
+      Policy _policy;
+      // write cursor (total number of elements written)
+      std::atomic<uint64_t> _put;
+      // number of reader slots
+      size_t _maxReaders;
+      // reader slots
+      std::unique_ptr<Reader[]> _readers;
+  };
+
+}
+
+#endif
@@ -10,7 +10,7 @@ RawBuffer::RawBuffer()
 
 // construct buffer of size N
 RawBuffer::RawBuffer(size_t N)
-  : _ptr((char*)malloc(N)), _storage_size(N), _offset(0), _length(N), _refcount((int*)malloc(sizeof(int)))
+  : _ptr((char*)malloc(N)), _storage_size(N), _offset(0), _length(N), _refcount((int*)malloc(2*sizeof(int)))
 {
   if ((_ptr == 0) && (_refcount != 0)) {
     free(_refcount); // free this memory location
@@ -19,7 +19,8 @@ RawBuffer::RawBuffer(size_t N)
     return;
   }
   
-  if (_refcount) { (*_refcount) = 1; }
+  // reference count and allocation tag (see MemoryTracker)
+  if (_refcount) { _refcount[0] = 1; _refcount[1] = MemoryTracker::allocated(N); }
 }
 
 // construct from data
@@ -30,30 +31,57 @@ RawBuffer::RawBuffer(char* data, size_t offset, size_t len)
 // construct from another buffe
 RawBuffer::RawBuffer(const RawBuffer &other)
   : _ptr(other._ptr), _storage_size(other._storage_size), _offset(other._offset), _length(other._length), _refcount(other._refcount)
-{}
+{
+  ref();
+}
 
 // Create new view on buffer
 RawBuffer::RawBuffer(const RawBuffer &other, size_t offset, size_t len)
   : _ptr(other._ptr), _storage_size(other._storage_size), _offset(other._offset+offset), _length(len), _refcount(other._refcount)
-{}
+{
+  ref();
+}
+
+// move constructor, other is left empty
+RawBuffer::RawBuffer(RawBuffer &&other) noexcept
+  : _ptr(other._ptr), _storage_size(other._storage_size), _offset(other._offset), _length(other._length), _refcount(other._refcount)
+{
+  other._ptr = 0; other._storage_size = other._offset = other._length = 0;
+  other._refcount = 0;
+}
 
-// virtual destructor
+// virtual destructor, releases the reference
 RawBuffer::~RawBuffer()
-{}
+{
+  unref();
+}
 
 // Circular Buffers
 RawCircularBuffer::RawCircularBuffer()
-  : RawBuffer(), _take_index(0), _b_stored(0) 
+  : RawBuffer(), _take_index(0), _b_stored(0), _overwrite(false),
+    _b_overwritten(0), _overruns(0), _b_gap(0)
 {}
 
-RawCircularBuffer::RawCircularBuffer(size_t size)
-  : RawBuffer(size), _take_index(0), _b_stored(0)
+RawCircularBuffer::RawCircularBuffer(size_t size, bool overwrite)
+  : RawBuffer(size), _take_index(0), _b_stored(0), _overwrite(overwrite),
+    _b_overwritten(0), _overruns(0), _b_gap(0)
 {}
 
 RawCircularBuffer::RawCircularBuffer(const RawCircularBuffer &other)
-  : RawBuffer(other), _take_index(other._take_index), _b_stored(other._b_stored)
+  : RawBuffer(other), _take_index(other._take_index), _b_stored(other._b_stored),
+    _overwrite(other._overwrite), _b_overwritten(other._b_overwritten),
+    _overruns(other._overruns), _b_gap(other._b_gap)
 {}
 
+RawCircularBuffer::RawCircularBuffer(RawCircularBuffer &&other) noexcept
+  : RawBuffer(std::move(other)), _take_index(other._take_index), _b_stored(other._b_stored),
+    _overwrite(other._overwrite), _b_overwritten(other._b_overwritten),
+    _overruns(other._overruns), _b_gap(other._b_gap)
+{
+  other._take_index = other._b_stored = 0;
+  other._b_overwritten = other._overruns = other._b_gap = 0;
+}
+
 RawCircularBuffer::~RawCircularBuffer()
 {}
 
@@ -6,6 +6,10 @@
 #include <inttypes.h>
 #include <math.h>
 #include <cstring>
+#include <utility>
+#include <stdlib.h>
+#include <type_traits>
+#include "memory.h"
 
 namespace sdr {
 
@@ -28,9 +32,68 @@ namespace sdr {
       // Create new view on buffer
       RawBuffer(const RawBuffer &other, size_t offset, size_t len);
 
+      // Move constructor, takes over the reference held by other
+      RawBuffer(RawBuffer &&other) noexcept;
+
       // Destructor
       virtual ~RawBuffer();
 
+      // OPERATOR OVERLOAD
+      // Assignment operator (new reference)
+      inline RawBuffer &operator = (const RawBuffer &other) {
+        if (_refcount != other._refcount) {
+          other.ref();
+          unref();
+        }
+        _ptr = other._ptr; _storage_size = other._storage_size;
+        _offset = other._offset; _length = other._length;
+        _refcount = other._refcount;
+        return *this;
+      }
+
+      // Move assignment, takes over the reference held by other
+      inline RawBuffer &operator = (RawBuffer &&other) noexcept {
+        if (this != &other) {
+          unref();
+          _ptr = other._ptr; _storage_size = other._storage_size;
+          _offset = other._offset; _length = other._length;
+          _refcount = other._refcount;
+          other._ptr = 0; other._storage_size = other._offset = other._length = 0;
+          other._refcount = 0;
+        }
+        return *this;
+      }
+
+      // Swap buffers without touching the reference counter
+      inline void swap(RawBuffer &other) noexcept {
+        std::swap(_ptr, other._ptr);
+        std::swap(_storage_size, other._storage_size);
+        std::swap(_offset, other._offset);
+        std::swap(_length, other._length);
+        std::swap(_refcount, other._refcount);
+      }
+
+      // REFERENCE COUNTING
+      // adds a reference to the buffer storage
+      inline void ref() const {
+        if (_refcount) { __atomic_add_fetch(_refcount, 1, __ATOMIC_RELAXED); }
+      }
+
+      // removes a reference, the storage is freed with the last reference
+      inline void unref() {
+        if (_refcount && (0 == __atomic_sub_fetch(_refcount, 1, __ATOMIC_ACQ_REL))) {
+          // the allocation tag follows the reference count
+          MemoryTracker::released(_storage_size, _refcount[1]);
+          free(_ptr); free(_refcount);
+        }
+        _ptr = 0; _storage_size = _offset = _length = 0; _refcount = 0;
+      }
+
+      // returns the number of references to the buffer storage (0 if not owned)
+      inline int refCount() const {
+        return _refcount ? __atomic_load_n(_refcount, __ATOMIC_RELAXED) : 0;
+      }
+
       // INLINE FUNCTIONS
       // returns pointer to data
       inline char *ptr() const { return (char*)_ptr; }
@@ -89,6 +152,13 @@ namespace sdr {
         : RawBuffer(other), _size(other._size)
       {}
 
+      // Move constructor (takes over the reference)
+      Buffer(Buffer<T> &&other) noexcept
+        : RawBuffer(std::move(other)), _size(other._size)
+      {
+        other._size = 0;
+      }
+
       // Destructor
       virtual ~Buffer() {
         _size = 0;
@@ -98,15 +168,34 @@ namespace sdr {
       explicit Buffer(const RawBuffer &other)
         : RawBuffer(other), _size(_length/sizeof(T))
       {}
+
+      // Explicit type cast, takes over the reference
+      explicit Buffer(RawBuffer &&other) noexcept
+        : RawBuffer(std::move(other)), _size(_length/sizeof(T))
+      {}
       
     public:
       // OPERATOR OVERLOAD
       // Assignment operator
-      const Buffer<T> &operator = (const Buffer<T> other) {
+      inline Buffer<T> &operator = (const Buffer<T> &other) {
         RawBuffer::operator =(other);
         _size = other._size;
         return *this;
       }
+
+      // Move assignment
+      inline Buffer<T> &operator = (Buffer<T> &&other) noexcept {
+        RawBuffer::operator =(std::move(other));
+        _size = other._size;
+        other._size = 0;
+        return *this;
+      }
+
+      // Swap buffers
+      inline void swap(Buffer<T> &other) noexcept {
+        RawBuffer::swap(other);
+        std::swap(_size, other._size);
+      }
       
       // Return Size
       inline size_t size() const { return _size; }
@@ -227,30 +316,117 @@ namespace sdr {
     return stream;
   }
 
+  // Observer of the ring buffers changed by the calling thread. The typed
+  // ring buffers report pushes, pulls, drops and commits to the observer of
+  // the current thread (if any), the coroutine Executor (coroutine.h)
+  // installs itself while it resumes stages and only checks the stages
+  // waiting on a changed ring.
+  class RingObserver {
+    public:
+      // Destructor
+      virtual ~RingObserver() {}
+
+      // Needs to be implemented by sub-classes: the fill level of ring changed
+      virtual void changed(const void *ring) = 0;
+
+      // returns the observer of the calling thread (may be 0)
+      static inline RingObserver *&current() {
+        static thread_local RingObserver *observer = 0;
+        return observer;
+      }
+      // reports a change of ring to the observer of the calling thread
+      static inline void notify(const void *ring) {
+        RingObserver *observer = current();
+        if (observer) { observer->changed(ring); }
+      }
+  };
+
+  // Condition on the fill level of a ring buffer: at least N elements are
+  // readable (stored) or writable (free). Returned by readable() and
+  // writable() of the typed ring buffers, coroutine.h makes it awaitable.
+  template <class Ring>
+  class FillCondition {
+    public:
+      // Kind of condition
+      typedef enum { READABLE, WRITABLE } Kind;
+
+      // Constructor from ring buffer, number of elements and kind
+      FillCondition(const Ring &ring, size_t N, Kind kind)
+        : _ring(ring), _N(N), _kind(kind) {}
+
+      // returns true if the condition holds
+      inline bool holds() const {
+        return (READABLE == _kind) ? (_ring.stored() >= _N) : (_ring.free() >= _N);
+      }
+      // returns the ring buffer (as reported to the RingObserver)
+      inline const void *source() const { return &_ring; }
+
+    protected:
+      // the ring buffer
+      const Ring &_ring;
+      // number of elements
+      size_t _N;
+      // kind of condition
+      Kind _kind;
+  };
+
   // Circular Buffer
   class RawCircularBuffer: public RawBuffer {
     public:
       // Empty constructor
       RawCircularBuffer();
 
-      // Construct from size
-      RawCircularBuffer(size_t size);
+      // Construct from size, if overwrite is true, push overwrites the oldest
+      // data instead of failing when the buffer is full
+      RawCircularBuffer(size_t size, bool overwrite=false);
       
       // Construct from another buffer
       RawCircularBuffer(const RawCircularBuffer &other);
 
+      // Move constructor
+      RawCircularBuffer(RawCircularBuffer &&other) noexcept;
+
       // virtual destructor
       virtual ~RawCircularBuffer();
 
       // Operator Overloading
       // Assignment overloading
-      inline const RawCircularBuffer &operator = (const RawCircularBuffer &other) {
+      inline RawCircularBuffer &operator = (const RawCircularBuffer &other) {
         RawBuffer::operator = (other);
         _take_index = other._take_index;
         _b_stored = other._b_stored;
+        _overwrite = other._overwrite;
+        _b_overwritten = other._b_overwritten;
+        _overruns = other._overruns;
+        _b_gap = other._b_gap;
+        return *this;
+      }
+
+      // Move assignment
+      inline RawCircularBuffer &operator = (RawCircularBuffer &&other) noexcept {
+        RawBuffer::operator = (std::move(other));
+        _take_index = other._take_index;
+        _b_stored = other._b_stored;
+        _overwrite = other._overwrite;
+        _b_overwritten = other._b_overwritten;
+        _overruns = other._overruns;
+        _b_gap = other._b_gap;
+        other._take_index = other._b_stored = 0;
+        other._b_overwritten = other._overruns = other._b_gap = 0;
         return *this;
       }
 
+      // Swap ring buffers
+      inline void swap(RawCircularBuffer &other) noexcept {
+        RawBuffer::swap(other);
+        std::swap(_take_index, other._take_index);
+        std::swap(_b_stored, other._b_stored);
+        std::swap(_overwrite, other._overwrite);
+        std::swap(_b_overwritten, other._b_overwritten);
+        std::swap(_overruns, other._overruns);
+        std::swap(_b_gap, other._b_gap);
+      }
+
       // Element access
       // TODO: exception handling for out of bounds indexing
       char &operator[] (int index) {
@@ -265,13 +441,50 @@ namespace sdr {
       // Return number of free bytes
       inline size_t bytesFree() const { return _storage_size-_b_stored; }
 
+      // DIRECT WRITE
+      // returns views of the free space at the write position: the part up
+      // to the end of the storage and the wrapped part (possibly empty).
+      // Allows reading from a device or socket directly into the ring, the
+      // written bytes become readable with commit().
+      inline std::pair<RawBuffer, RawBuffer> freeSpans() const {
+        size_t put_index = _take_index+_b_stored;
+        if (put_index >= _storage_size) { put_index -= _storage_size; } // wrap around
+        size_t first = std::min(bytesFree(), _storage_size-put_index);
+        return std::make_pair(RawBuffer(*this, put_index, first), RawBuffer(*this, 0, bytesFree()-first));
+      }
+      // makes N bytes written into the free spans readable
+      inline void commit(size_t N) { _b_stored += std::min(N, bytesFree()); }
+
+      // OVERWRITE MODE
+      // enable or disable overwriting of the oldest data if the buffer is full
+      inline void setOverwrite(bool enable) { _overwrite = enable; }
+      // returns true if push overwrites the oldest data
+      inline bool overwrite() const { return _overwrite; }
+      // total number of bytes overwritten before they were read
+      inline size_t bytesOverwritten() const { return _b_overwritten; }
+      // number of pushes that overwrote unread data
+      inline size_t overruns() const { return _overruns; }
+      // returns the number of bytes lost since the last call (0 if there was
+      // no gap in the data) and resets it. Call before reading to detect gaps.
+      inline size_t takeGap() {
+        size_t gap = _b_gap;
+        _b_gap = 0;
+        return gap;
+      }
+
       // push given data in buffer, size of given data must be smaller of equal to
-      // the number of free bytes. If so, return true. If not, return false
+      // the number of free bytes. If so, return true. If not, return false.
+      // In overwrite mode, the oldest data is dropped to make room and the
+      // push always succeeds (only the newest storageSize() bytes are kept if
+      // the given data is larger than the buffer).
       inline bool push(const RawBuffer &src) {
         // if given data is larger than number of free bytes
-        if (src.bytesLen() > bytesFree()) { return false; }
+        if (src.bytesLen() > bytesFree()) {
+          if ((! _overwrite) || (0 == _storage_size)) { return false; }
+          return pushOverwrite(src);
+        }
         size_t put_index = _take_index+_b_stored;
-        if (put_index > _storage_size) { put_index -= _storage_size; } // wrap around
+        if (put_index >= _storage_size) { put_index -= _storage_size; } // wrap around
         // store data
         if (_storage_size >= (put_index+src.bytesLen())) {
           // if data can be copied directly
@@ -335,11 +548,42 @@ namespace sdr {
       }
 
     protected:
+      // push in overwrite mode if src does not fit into the free space
+      inline bool pushOverwrite(const RawBuffer &src) {
+        size_t len = src.bytesLen();
+        _overruns++;
+        if (len >= _storage_size) {
+          // keep only the newest data
+          size_t lost = _b_stored + (len-_storage_size);
+          _b_overwritten += lost; _b_gap += lost;
+          std::memcpy(_ptr, src.data()+(len-_storage_size), _storage_size);
+          _take_index = 0; _b_stored = _storage_size;
+          return true;
+        }
+        // advance read cursor by the missing space
+        size_t lost = len-bytesFree();
+        _b_overwritten += lost; _b_gap += lost;
+        drop(lost);
+        return push(src);
+      }
+
       // current read pointer
       size_t _take_index;
 
       // offset of the write pointer relative to ptr
       size_t _b_stored;
+
+      // if true, push overwrites the oldest data
+      bool _overwrite;
+
+      // total number of overwritten bytes
+      size_t _b_overwritten;
+
+      // number of pushes that overwrote data
+      size_t _overruns;
+
+      // number of bytes lost since the last call to takeGap()
+      size_t _b_gap;
   };
 
   // A Typed Circular Buffer
@@ -349,25 +593,49 @@ namespace sdr {
       // Empty constructor
       CircularBuffer() : RawCircularBuffer(), _size(0), _stored(0) {}
 
-      // Construct from size N
-      CircularBuffer(size_t N) : RawCircularBuffer(N*sizeof(Scalar)), _size(N), _stored(0) {}
+      // Construct from size N, optionally in overwrite mode
+      CircularBuffer(size_t N, bool overwrite=false)
+        : RawCircularBuffer(N*sizeof(Scalar), overwrite), _size(N), _stored(0) {}
 
       // Construct from another buffer
       CircularBuffer(const CircularBuffer<Scalar> &other)
         : RawCircularBuffer(other), _size(other._size), _stored(other._stored) {}
 
+      // Move constructor
+      CircularBuffer(CircularBuffer<Scalar> &&other) noexcept
+        : RawCircularBuffer(std::move(other)), _size(other._size), _stored(other._stored)
+      {
+        other._size = other._stored = 0;
+      }
+
       // virtual destructor
       virtual ~CircularBuffer() {}
       
       // Operator Overloading
       // Assignment operator
-      const CircularBuffer<Scalar> &operator = (const CircularBuffer<Scalar> &other) {
+      CircularBuffer<Scalar> &operator = (const CircularBuffer<Scalar> &other) {
         RawCircularBuffer::operator =(other);
         _size = other._size;
-        _stored = other._other;
+        _stored = other._stored;
         return *this;
       }
 
+      // Move assignment
+      CircularBuffer<Scalar> &operator = (CircularBuffer<Scalar> &&other) noexcept {
+        RawCircularBuffer::operator =(std::move(other));
+        _size = other._size;
+        _stored = other._stored;
+        other._size = other._stored = 0;
+        return *this;
+      }
+
+      // Swap ring buffers
+      inline void swap(CircularBuffer<Scalar> &other) noexcept {
+        RawCircularBuffer::swap(other);
+        std::swap(_size, other._size);
+        std::swap(_stored, other._stored);
+      }
+
       // Indexing
       Scalar &operator[] (int index) {
         return reinterpret_cast<Scalar &> (RawCircularBuffer::operator [] (index*sizeof(Scalar)));
@@ -380,12 +648,25 @@ namespace sdr {
       inline size_t free() const { return _size-_stored; }
       // returns the size of ring buffer
       inline size_t size() const { return _size; }
+      // condition: at least N elements stored
+      inline FillCondition< CircularBuffer<Scalar> > readable(size_t N) const {
+        return FillCondition< CircularBuffer<Scalar> >(*this, N, FillCondition< CircularBuffer<Scalar> >::READABLE);
+      }
+      // condition: space for at least N elements
+      inline FillCondition< CircularBuffer<Scalar> > writable(size_t N) const {
+        return FillCondition< CircularBuffer<Scalar> >(*this, N, FillCondition< CircularBuffer<Scalar> >::WRITABLE);
+      }
+      // total number of elements overwritten before they were read
+      inline size_t overwritten() const { return _b_overwritten/sizeof(Scalar); }
+      // returns the number of elements lost since the last call and resets it
+      inline size_t takeGap() { return RawCircularBuffer::takeGap()/sizeof(Scalar); }
 
       // Push and Pull functions
       // push function
       inline bool push(const Buffer<Scalar> &data) {
         if (RawCircularBuffer::push(data)) { // referencing push functions in original class
-          _stored += data.size(); // update number of stored data
+          _stored = _b_stored/sizeof(Scalar); // update number of stored data (may have overwritten)
+          RingObserver::notify(this);
           return true;
         }
         return false; // return false if cant push data (i.e. sizes doesnt work out)
@@ -395,6 +676,7 @@ namespace sdr {
       inline bool pull(const Buffer<Scalar> &dest, size_t N) {
         if (RawCircularBuffer::pull(dest, N*sizeof(Scalar))) {
           _stored -= N;
+          RingObserver::notify(this);
           return true;
         }
         return false;
@@ -404,11 +686,21 @@ namespace sdr {
       inline void drop(size_t N) {
         RawCircularBuffer::drop(N*sizeof(Scalar));
         _stored = _b_stored/sizeof(Scalar);
+        RingObserver::notify(this);
+      }
+
+      // makes N elements written into the free spans readable
+      inline void commit(size_t N) {
+        RawCircularBuffer::commit(N*sizeof(Scalar));
+        _stored = _b_stored/sizeof(Scalar);
+        RingObserver::notify(this);
       }
 
       // resize buffer to size N
       inline void resize(size_t N) {
         RawCircularBuffer::resize(N*sizeof(Scalar));
+        _size = N; _stored = 0;
+        RingObserver::notify(this);
       }
 
     protected:
@@ -419,6 +711,128 @@ namespace sdr {
 
   };
 
+  // A circular buffer with compile-time capacity N (a power of two) and inline
+  // storage. The read and write cursors are 64-bit counters that only ever
+  // increase, the storage index is obtained by masking, hence there are no
+  // wrap-around branches and no heap allocation. Intended for small delay
+  // lines and filter histories.
+  template <class T, size_t N>
+  class StaticCircularBuffer {
+    static_assert((N > 0) && (0 == (N & (N-1))), "Capacity must be a power of two");
+
+    public:
+      // Empty constructor
+      StaticCircularBuffer() : _put(0), _take(0) {}
+
+      // Inline helper functions
+      // return number of stored elements
+      inline size_t stored() const { return size_t(_put-_take); }
+      // return number of free elements
+      inline size_t free() const { return N-stored(); }
+      // returns the size of ring buffer
+      static constexpr size_t size() { return N; }
+      // condition: at least n elements stored
+      inline FillCondition<StaticCircularBuffer> readable(size_t n) const {
+        return FillCondition<StaticCircularBuffer>(*this, n, FillCondition<StaticCircularBuffer>::READABLE);
+      }
+      // condition: space for at least n elements
+      inline FillCondition<StaticCircularBuffer> writable(size_t n) const {
+        return FillCondition<StaticCircularBuffer>(*this, n, FillCondition<StaticCircularBuffer>::WRITABLE);
+      }
+      // returns the total number of elements pushed so far (write cursor)
+      inline uint64_t written() const { return _put; }
+      // returns the total number of elements taken so far (read cursor)
+      inline uint64_t taken() const { return _take; }
+
+      // Indexing relative to the read cursor
+      inline T &operator[] (size_t index) { return _data[(_take+index) & MASK]; }
+      inline const T &operator[] (size_t index) const { return _data[(_take+index) & MASK]; }
+
+      // Push and Pull functions
+      // push a single element, returns false if the buffer is full
+      inline bool push(const T &value) {
+        if (N == stored()) { return false; }
+        _data[(_put++) & MASK] = value;
+        RingObserver::notify(this);
+        return true;
+      }
+
+      // push all elements of data, returns false if they do not fit
+      inline bool push(const Buffer<T> &data) {
+        size_t n = data.size();
+        if (n > free()) { return false; }
+        copyIn(reinterpret_cast<const T *>(data.data()), n);
+        _put += n;
+        RingObserver::notify(this);
+        return true;
+      }
+
+      // pull a single element, returns false if the buffer is empty
+      inline bool pull(T &value) {
+        if (0 == stored()) { return false; }
+        value = _data[(_take++) & MASK];
+        RingObserver::notify(this);
+        return true;
+      }
+
+      // pull n elements into dest, returns false if not enough elements are
+      // stored or dest is too small
+      inline bool pull(const Buffer<T> &dest, size_t n) {
+        if (! peek(dest, n)) { return false; }
+        _take += n;
+        RingObserver::notify(this);
+        return true;
+      }
+
+      // copy n elements into dest without removing them
+      inline bool peek(const Buffer<T> &dest, size_t n) const {
+        if ((n > dest.size()) || (n > stored())) { return false; }
+        copyOut(reinterpret_cast<T *>(dest.data()), n);
+        return true;
+      }
+
+      // delete at most n elements from buffer
+      inline void drop(size_t n) { _take += std::min(n, stored()); RingObserver::notify(this); }
+
+      // clear ring buffer
+      inline void clear() { _put = _take = 0; RingObserver::notify(this); }
+
+    protected:
+      // copy n elements to the write cursor
+      inline void copyIn(const T *src, size_t n) {
+        if ((n < SMALL) || (! std::is_trivially_copyable<T>::value)) {
+          for (size_t i=0; i<n; i++) { _data[(_put+i) & MASK] = src[i]; }
+          return;
+        }
+        size_t idx = _put & MASK, num_a = std::min(n, N-idx);
+        std::memcpy(_data+idx, src, num_a*sizeof(T));
+        std::memcpy(_data, src+num_a, (n-num_a)*sizeof(T));
+      }
+
+      // copy n elements from the read cursor
+      inline void copyOut(T *dest, size_t n) const {
+        if ((n < SMALL) || (! std::is_trivially_copyable<T>::value)) {
+          for (size_t i=0; i<n; i++) { dest[i] = _data[(_take+i) & MASK]; }
+          return;
+        }
+        size_t idx = _take & MASK, num_a = std::min(n, N-idx);
+        std::memcpy(dest, _data+idx, num_a*sizeof(T));
+        std::memcpy(dest+num_a, _data, (n-num_a)*sizeof(T));
+      }
+
+    protected:
+      // index mask
+      static const uint64_t MASK = N-1;
+      // blocks smaller than a cache line (in elements) are copied element-wise
+      static const size_t SMALL = (64 >= sizeof(T)) ? (64/sizeof(T)) : 1;
+      // storage
+      alignas(64) T _data[N];
+      // write cursor
+      uint64_t _put;
+      // read cursor
+      uint64_t _take;
+  };
+
   // TODO: print pretty
 }
 
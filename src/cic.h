@@ -0,0 +1,253 @@
+#ifndef __SDR_CIC_H__
+#define __SDR_CIC_H__
+
+#include "buffer.h"
+#include <vector>
+#include <limits>
+
+namespace sdr {
+
+  // Sample traits for the CIC decimator: number of integer lanes per sample
+  // (1 for real, 2 for complex samples) and the integer type of a lane
+  template <class Scalar>
+  struct CICTraits {
+    static const size_t lanes = 1;
+    typedef Scalar Lane;
+  };
+
+  template <class T>
+  struct CICTraits< std::complex<T> > {
+    static const size_t lanes = 2;
+    typedef T Lane;
+  };
+
+
+  // Cascaded integrator-comb (CIC) decimator for integer and complex integer
+  // samples (e.g. int16_t, int32_t, std::complex<int16_t>).
+  //
+  // The filter consists of N integrator stages at the input rate, decimation
+  // by R and N comb stages with differential delay M at the output rate. The
+  // state is kept across blocks. The integrators wrap around (modular
+  // arithmetic in 64 bits), which is exact as long as the bit growth
+  // N*log2(R*M) plus the input width stays below 64 bits.
+  //
+  // The output is scaled back to the input range by a right shift of
+  // ceil(log2((R*M)^N)) bits, hence the DC gain is exactly 1 if R*M is a
+  // power of two and between 0.5 and 1 otherwise (see gain()).
+  //
+  // Optionally, a compensation FIR at the output rate flattens the sinc^N
+  // droop of the CIC within the given passband.
+  template <class Scalar>
+  class CICDecimator {
+    public:
+      // integer type of a lane
+      typedef typename CICTraits<Scalar>::Lane Lane;
+      // number of lanes per sample
+      static const size_t LANES = CICTraits<Scalar>::lanes;
+
+    public:
+      // Constructor with order N, decimation R, differential delay M and
+      // number of taps of the compensation FIR (0: none). The compensation
+      // passband edge is given relative to the output rate (0..0.5/M).
+      CICDecimator(size_t order, size_t rate, size_t delay=1, size_t compTaps=0, double passband=0.25)
+        : _order(std::max(size_t(1), order)), _rate(std::max(size_t(1), rate)),
+          _delay(std::max(size_t(1), delay)), _shift(0), _count(0), _comb_index(0)
+      {
+        // bit growth
+        double growth = _order*std::log2(double(_rate*_delay));
+        _shift = size_t(std::ceil(growth-1e-9));
+        _gain = std::pow(2., growth-_shift);
+        // compensation filter
+        if (compTaps) {
+          std::vector<double> taps = compensationTaps(_order, _rate, _delay, compTaps, passband);
+          for (size_t i=0; i<taps.size(); i++) { _comp.push_back(int64_t(std::floor(taps[i]*(1<<15)+0.5))); }
+        }
+        reset();
+      }
+
+      // Destructor
+      virtual ~CICDecimator() {}
+
+      // Inline helper functions
+      // returns the order
+      inline size_t order() const { return _order; }
+      // returns the decimation factor
+      inline size_t rate() const { return _rate; }
+      // returns the differential delay
+      inline size_t delay() const { return _delay; }
+      // returns the DC gain after scaling
+      inline double gain() const { return _gain; }
+      // returns the maximum number of outputs for an input block of N samples
+      inline size_t maxOutputs(size_t N) const { return N/_rate + 1; }
+
+      // Clears the filter state
+      void reset() {
+        _count = 0; _comb_index = 0;
+        _integ.assign(_order*LANES, 0);
+        _comb.assign(_order*_delay*LANES, 0);
+        _comp_hist.assign(2*_comp.size()*LANES, 0);
+        _comp_index = 0;
+      }
+
+      // Decimates the input block, returns the number of samples written into
+      // out or 0 if out may be too small (see maxOutputs()).
+      size_t process(const Buffer<Scalar> &in, const Buffer<Scalar> &out) {
+        if (out.size() < maxOutputs(in.size())) { return 0; }
+        const Lane *x = reinterpret_cast<const Lane *>(in.data());
+        Lane *y = reinterpret_cast<Lane *>(out.data());
+        size_t N = in.size(), count = 0;
+        uint64_t *integ = &_integ[0];
+        for (size_t i=0; i<N; i++) {
+          // integrators (modular arithmetic)
+          for (size_t l=0; l<LANES; l++) {
+            uint64_t v = uint64_t(int64_t(x[LANES*i+l]));
+            uint64_t *s = integ + l*_order;
+            for (size_t k=0; k<_order; k++) { v = s[k] += v; }
+          }
+          if (++_count < _rate) { continue; }
+          _count = 0;
+          // combs
+          for (size_t l=0; l<LANES; l++) {
+            uint64_t v = integ[l*_order+_order-1];
+            for (size_t k=0; k<_order; k++) {
+              uint64_t &d = _comb[(l*_order+k)*_delay + _comb_index];
+              uint64_t prev = d;
+              d = v;
+              v -= prev;
+            }
+            int64_t value = int64_t(v) >> _shift;
+            if (_comp.size()) { value = compensate(l, value); }
+            y[LANES*count+l] = saturate(value);
+          }
+          if (_comp.size()) { _comp_index = (_comp_index+1) % _comp.size(); }
+          _comb_index = (_comb_index+1) % _delay;
+          count++;
+        }
+        return count;
+      }
+
+      // Designs a linear-phase FIR of the given length which flattens the
+      // CIC response up to the passband edge (relative to the output rate).
+      // Weighted least squares fit of the inverse CIC response in the
+      // passband and of zero in the stopband, which starts halfway between
+      // the passband edge and half the output rate (the band in between is
+      // a transition band). The DC gain is 1.
+      static std::vector<double> compensationTaps(size_t order, size_t rate, size_t delay,
+                                                  size_t ntaps, double passband) {
+        const size_t K = 1024;
+        const double PASS_WEIGHT = 10;
+        ntaps = std::max(size_t(1), ntaps);
+        passband = std::min(std::max(passband, 0.), 0.5);
+        double stopband = passband + 0.5*(0.5-passband);
+        // linear phase: A(f) = sum_j a_j b_j(f) with cosine basis functions
+        // around the center, j=0 is the center tap for odd lengths
+        bool odd = (1 == (ntaps % 2));
+        size_t J = (ntaps+1)/2;
+        std::vector<double> G(J*J, 0), rhs(J, 0), b(J);
+        for (size_t k=0; k<=K; k++) {
+          double f = 0.5*double(k)/K, d = 0, w = 0;
+          if (f <= passband) {
+            d = std::min(1./response(order, rate, delay, f), 10.); w = PASS_WEIGHT;
+          } else if (f >= stopband) {
+            w = 1;
+          } else {
+            continue;
+          }
+          for (size_t j=0; j<J; j++) {
+            b[j] = odd ? ((0 == j) ? 1 : 2*std::cos(2*M_PI*f*j)) : 2*std::cos(2*M_PI*f*(j+0.5));
+          }
+          for (size_t i=0; i<J; i++) {
+            rhs[i] += w*d*b[i];
+            for (size_t j=0; j<J; j++) { G[i*J+j] += w*b[i]*b[j]; }
+          }
+        }
+        // solve the normal equations (Gaussian elimination, partial pivoting)
+        for (size_t c=0; c<J; c++) {
+          size_t p = c;
+          for (size_t r=c+1; r<J; r++) { if (std::abs(G[r*J+c]) > std::abs(G[p*J+c])) { p = r; } }
+          for (size_t j=0; j<J; j++) { std::swap(G[c*J+j], G[p*J+j]); }
+          std::swap(rhs[c], rhs[p]);
+          if (0 == G[c*J+c]) { continue; }
+          for (size_t r=c+1; r<J; r++) {
+            double m = G[r*J+c]/G[c*J+c];
+            for (size_t j=c; j<J; j++) { G[r*J+j] -= m*G[c*J+j]; }
+            rhs[r] -= m*rhs[c];
+          }
+        }
+        std::vector<double> a(J, 0);
+        for (size_t c=J; c-- > 0;) {
+          double v = rhs[c];
+          for (size_t j=c+1; j<J; j++) { v -= G[c*J+j]*a[j]; }
+          a[c] = (0 == G[c*J+c]) ? 0 : v/G[c*J+c];
+        }
+        // taps from the coefficients (symmetric), normalized to DC gain 1
+        std::vector<double> taps(ntaps, 0);
+        size_t m = ntaps/2;
+        double sum = 0;
+        for (size_t j=0; j<J; j++) {
+          if (odd) { taps[m+j] = taps[m-j] = a[j]; }
+          else { taps[m+j] = taps[m-1-j] = a[j]; }
+        }
+        for (size_t n=0; n<ntaps; n++) { sum += taps[n]; }
+        for (size_t n=0; n<ntaps; n++) { taps[n] /= sum; }
+        return taps;
+      }
+
+      // Returns the magnitude response of the (normalized) CIC at the given
+      // frequency relative to the output rate
+      static double response(size_t order, size_t rate, size_t delay, double f) {
+        if (0 == f) { return 1; }
+        double num = std::sin(M_PI*delay*f), den = rate*delay*std::sin(M_PI*f/rate);
+        return std::pow(std::abs(num/den), double(order));
+      }
+
+    protected:
+      // applies the compensation FIR to the given lane
+      inline int64_t compensate(size_t lane, int64_t value) {
+        size_t L = _comp.size();
+        // stored twice, hence the last L values are contiguous at index+1
+        int64_t *hist = &_comp_hist[2*lane*L] + _comp_index;
+        hist[0] = hist[L] = value;
+        int64_t acc = 0;
+        // newest sample with the first tap
+        for (size_t j=0; j<L; j++) { acc += _comp[j]*hist[L-j]; }
+        return (acc + (1<<14)) >> 15;
+      }
+
+      // saturates to the lane type
+      static inline Lane saturate(int64_t value) {
+        if (value > int64_t(std::numeric_limits<Lane>::max())) { return std::numeric_limits<Lane>::max(); }
+        if (value < int64_t(std::numeric_limits<Lane>::min())) { return std::numeric_limits<Lane>::min(); }
+        return Lane(value);
+      }
+
+    protected:
+      // order (number of integrator and comb stages)
+      size_t _order;
+      // decimation factor
+      size_t _rate;
+      // differential delay
+      size_t _delay;
+      // output scaling
+      size_t _shift;
+      // DC gain after scaling
+      double _gain;
+      // input samples since the last output
+      size_t _count;
+      // integrator states [lane][stage]
+      std::vector<uint64_t> _integ;
+      // comb delay lines [lane][stage][delay]
+      std::vector<uint64_t> _comb;
+      // current index into the comb delay lines
+      size_t _comb_index;
+      // compensation taps (Q15)
+      std::vector<int64_t> _comp;
+      // compensation history [lane][2*tap]
+      std::vector<int64_t> _comp_hist;
+      // current index into the compensation history
+      size_t _comp_index;
+  };
+
+}
+
+#endif
@@ -0,0 +1,348 @@
+#include "codec.h"
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+using namespace sdr;
+
+static_assert(24 == sizeof(IQBlockHeader), "IQBlockHeader must not be padded");
+
+// identifies a block ("IQB1" in little-endian byte order)
+static const uint32_t IQ_BLOCK_MAGIC = 0x31425149;
+// Rice codes with a quotient of at least this are escaped
+static const int RICE_LIMIT = 24;
+// width of an escaped (zigzag mapped) delta
+static const int RICE_ESCAPE_BITS = 17;
+
+
+// sign extends the lower bits of v
+static inline int16_t signExtend(uint64_t v, int bits) {
+  return int16_t(int32_t(uint32_t(v) << (32-bits)) >> (32-bits));
+}
+
+// maps signed deltas to unsigned values, 0,-1,1,-2,... -> 0,1,2,3,...
+static inline uint32_t zigzag(int32_t d) { return (uint32_t(d) << 1) ^ uint32_t(d >> 31); }
+static inline int32_t unzigzag(uint32_t z) { return int32_t(z >> 1) ^ -int32_t(z & 1); }
+
+// Writes bit fields LSB first
+class BitWriter {
+  public:
+    BitWriter(uint8_t *out) : _out(out), _pos(0), _acc(0), _n(0) {}
+    // appends the lower n bits of value (n <= 56)
+    inline void put(uint64_t value, int n) {
+      _acc |= value << _n; _n += n;
+      while (_n >= 8) { _out[_pos++] = uint8_t(_acc); _acc >>= 8; _n -= 8; }
+    }
+    // writes the remaining bits, returns the number of bytes written
+    inline size_t flush() {
+      if (_n) { _out[_pos++] = uint8_t(_acc); _acc = 0; _n = 0; }
+      return _pos;
+    }
+  protected:
+    uint8_t *_out;
+    size_t _pos;
+    uint64_t _acc;
+    int _n;
+};
+
+// Reads bit fields LSB first
+class BitReader {
+  public:
+    BitReader(const uint8_t *data, size_t len) : _p(data), _end(data+len), _acc(0), _n(0) {}
+    // fills the accumulator with at least 57 bits if available
+    inline void refill() {
+      while ((_n <= 56) && (_p < _end)) { _acc |= uint64_t(*_p++) << _n; _n += 8; }
+    }
+    // returns the number of buffered bits
+    inline int available() const { return _n; }
+    // returns the buffered bits without consuming them
+    inline uint64_t bits() const { return _acc; }
+    // consumes n buffered bits (n < 64)
+    inline uint64_t get(int n) {
+      uint64_t v = _acc & ((uint64_t(1) << n)-1);
+      _acc >>= n; _n -= n;
+      return v;
+    }
+  protected:
+    const uint8_t *_p, *_end;
+    uint64_t _acc;
+    int _n;
+};
+
+
+// Packs groups of 4 samples of even width, returns the number of samples
+// packed, pos is advanced by the bytes written
+template <int BITS>
+static inline size_t packGroups(const int16_t *x, uint8_t *y, size_t N, size_t &pos) {
+  const int32_t hi = (1 << (BITS-1))-1, lo = -(1 << (BITS-1));
+  const uint64_t mask = (uint64_t(1) << BITS)-1;
+  size_t i = 0;
+  for (; (i+4)<=N; i+=4, pos+=BITS/2) {
+    uint64_t w = 0;
+    for (int j=0; j<4; j++) {
+      int32_t v = std::min(hi, std::max(lo, int32_t(x[i+j])));
+      w |= (uint64_t(v) & mask) << (j*BITS);
+    }
+    std::memcpy(y+pos, &w, BITS/2);
+  }
+  return i;
+}
+
+// Unpacks groups of 4 samples of even width starting at sample i, returns
+// the next sample, pos is advanced by the bytes read
+template <int BITS>
+static inline size_t unpackGroups(const uint8_t *x, int16_t *y, size_t N, size_t i, size_t &pos) {
+  const uint64_t mask = (uint64_t(1) << BITS)-1;
+  for (; (i+4)<=N; i+=4, pos+=BITS/2) {
+    uint64_t w = 0;
+    std::memcpy(&w, x+pos, BITS/2);
+    for (int j=0; j<4; j++) { y[i+j] = signExtend((w >> (j*BITS)) & mask, BITS); }
+  }
+  return i;
+}
+
+
+// Packing
+size_t sdr::pack(const Buffer<int16_t> &in, const Buffer<uint8_t> &out, int bits) {
+  if ((bits < 1) || (bits > 16)) { return 0; }
+  size_t N = in.size(), bytes = packedSize(N, bits);
+  if (out.size() < bytes) { return 0; }
+  const int16_t *x = reinterpret_cast<const int16_t *>(in.data());
+  uint8_t *y = reinterpret_cast<uint8_t *>(out.data());
+  int32_t hi = (1 << (bits-1))-1, lo = -(1 << (bits-1));
+  uint64_t mask = (uint64_t(1) << bits)-1;
+  size_t i = 0, pos = 0;
+  // 4 samples make bits/2 whole bytes, constant widths let the compiler
+  // turn the byte copies into plain stores
+  switch (bits) {
+    case 8:  i = packGroups<8>(x, y, N, pos); break;
+    case 10: i = packGroups<10>(x, y, N, pos); break;
+    case 12: i = packGroups<12>(x, y, N, pos); break;
+    case 14: i = packGroups<14>(x, y, N, pos); break;
+    case 16: i = packGroups<16>(x, y, N, pos); break;
+    default: break;
+  }
+  // remaining (or all odd-width) samples
+  BitWriter writer(y+pos);
+  for (; i<N; i++) {
+    int32_t v = std::min(hi, std::max(lo, int32_t(x[i])));
+    writer.put(uint64_t(v) & mask, bits);
+  }
+  writer.flush();
+  return bytes;
+}
+
+size_t sdr::unpack(const Buffer<uint8_t> &in, const Buffer<int16_t> &out, size_t N, int bits) {
+  if ((bits < 1) || (bits > 16) || (in.size() < packedSize(N, bits)) || (out.size() < N)) { return 0; }
+  const uint8_t *x = reinterpret_cast<const uint8_t *>(in.data());
+  int16_t *y = reinterpret_cast<int16_t *>(out.data());
+  size_t i = 0, pos = 0;
+#ifdef __SSSE3__
+  if (12 == bits) {
+    // 8 samples from 12 bytes: gather byte pairs [b0b1, b1b2, b3b4, ...]
+    // into 16-bit lanes, even samples are the low 12 bits, odd samples the
+    // high 12 bits of their lane
+    const __m128i shuf = _mm_setr_epi8(0,1, 1,2, 3,4, 4,5, 6,7, 7,8, 9,10, 10,11);
+    const __m128i even = _mm_setr_epi16(-1,0, -1,0, -1,0, -1,0);
+    size_t len = in.size();
+    for (; ((i+8)<=N) && ((pos+16)<=len); i+=8, pos+=12) {
+      __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(x+pos)), shuf);
+      __m128i e = _mm_srai_epi16(_mm_slli_epi16(v, 4), 4), o = _mm_srai_epi16(v, 4);
+      _mm_storeu_si128((__m128i *)(y+i), _mm_or_si128(_mm_and_si128(even, e), _mm_andnot_si128(even, o)));
+    }
+  }
+#endif
+  switch (bits) {
+    case 8:  i = unpackGroups<8>(x, y, N, i, pos); break;
+    case 10: i = unpackGroups<10>(x, y, N, i, pos); break;
+    case 12: i = unpackGroups<12>(x, y, N, i, pos); break;
+    case 14: i = unpackGroups<14>(x, y, N, i, pos); break;
+    case 16: i = unpackGroups<16>(x, y, N, i, pos); break;
+    default: break;
+  }
+  BitReader reader(x+pos, packedSize(N, bits)-pos);
+  for (; i<N; i++) {
+    reader.refill();
+    y[i] = signExtend(reader.get(bits), bits);
+  }
+  return N;
+}
+
+
+// Encoder
+// Constructor
+IQEncoder::IQEncoder(IQBlockHeader::Mode mode, size_t blockSize, size_t lanes, int bits)
+  : _mode(mode), _block_size(std::max(size_t(1), std::min(blockSize, size_t(0xffffffff)))),
+    _lanes(std::max(size_t(1), std::min(lanes, size_t(0xffff)))), _bits(std::max(1, std::min(16, bits))), _offset(0)
+{}
+
+// Destructor
+IQEncoder::~IQEncoder() {}
+
+// worst case payload of n values: all Rice codes escaped
+static inline size_t maxPayload(size_t n) {
+  return (n*(RICE_LIMIT+RICE_ESCAPE_BITS)+7)/8;
+}
+
+size_t IQEncoder::maxEncodedSize(size_t N) const {
+  size_t blocks = (N+_block_size-1)/_block_size;
+  return blocks*sizeof(IQBlockHeader) + maxPayload(N) + blocks;
+}
+
+size_t IQEncoder::encode(const Buffer<int16_t> &in, std::vector<uint8_t> &out) {
+  size_t start = out.size();
+  for (size_t i=0; i<in.size(); i+=_block_size) {
+    encodeBlock(in.sub(i, std::min(_block_size, in.size()-i)), out);
+  }
+  return out.size()-start;
+}
+
+void IQEncoder::encodeBlock(const Buffer<int16_t> &in, std::vector<uint8_t> &out) {
+  size_t n = in.size(), start = out.size();
+  const int16_t *x = reinterpret_cast<const int16_t *>(in.data());
+  IQBlockHeader header;
+  header.magic = IQ_BLOCK_MAGIC; header.mode = uint8_t(_mode); header.param = 0;
+  header.lanes = uint16_t(_lanes); header.samples = uint32_t(n); header.payload = 0;
+  header.offset = _offset;
+  out.resize(start + sizeof(IQBlockHeader) + std::max(maxPayload(n), 2*n));
+  uint8_t *payload = &out[start+sizeof(IQBlockHeader)];
+
+  if (IQBlockHeader::PACKED == _mode) {
+    header.param = uint8_t(_bits);
+    header.payload = uint32_t(pack(in, Buffer<uint8_t>(payload, packedSize(n, _bits)), _bits));
+  } else if (IQBlockHeader::DELTA_RICE == _mode) {
+    // Rice parameter from the mean of the zigzag mapped deltas
+    uint64_t sum = 0;
+    for (size_t i=0; i<n; i++) {
+      int32_t d = int32_t(x[i]) - ((i >= _lanes) ? int32_t(x[i-_lanes]) : 0);
+      sum += zigzag(d);
+    }
+    uint64_t mean = n ? sum/n : 0;
+    int k = 0;
+    while ((k < 15) && ((uint64_t(1) << (k+1)) <= mean)) { k++; }
+    BitWriter writer(payload);
+    for (size_t i=0; i<n; i++) {
+      int32_t d = int32_t(x[i]) - ((i >= _lanes) ? int32_t(x[i-_lanes]) : 0);
+      uint32_t z = zigzag(d), q = z >> k;
+      if (q < uint32_t(RICE_LIMIT)) {
+        writer.put((uint64_t(1) << q)-1, q+1);
+        writer.put(z & ((uint32_t(1) << k)-1), k);
+      } else {
+        writer.put((uint64_t(1) << RICE_LIMIT)-1, RICE_LIMIT);
+        writer.put(z, RICE_ESCAPE_BITS);
+      }
+    }
+    header.param = uint8_t(k);
+    header.payload = uint32_t(writer.flush());
+    // incompressible: store raw
+    if (header.payload >= 2*n) { header.mode = uint8_t(IQBlockHeader::RAW16); }
+  }
+  if (IQBlockHeader::RAW16 == header.mode) {
+    header.param = 0;
+    header.payload = uint32_t(2*n);
+    std::memcpy(payload, x, 2*n);
+  }
+  std::memcpy(&out[start], &header, sizeof(IQBlockHeader));
+  out.resize(start + sizeof(IQBlockHeader) + header.payload);
+  _offset += n;
+}
+
+
+// Decoder
+bool IQDecoder::header(const uint8_t *data, size_t len, IQBlockHeader &header) {
+  if (len < sizeof(IQBlockHeader)) { return false; }
+  std::memcpy(&header, data, sizeof(IQBlockHeader));
+  return (IQ_BLOCK_MAGIC == header.magic) && (header.mode <= IQBlockHeader::DELTA_RICE) &&
+      (0 < header.lanes) && ((len-sizeof(IQBlockHeader)) >= header.payload);
+}
+
+size_t IQDecoder::decodeBlock(const uint8_t *data, size_t len, const Buffer<int16_t> &out) {
+  IQBlockHeader h;
+  if ((! header(data, len, h)) || (out.size() < h.samples)) { return 0; }
+  const uint8_t *payload = data + sizeof(IQBlockHeader);
+  int16_t *y = reinterpret_cast<int16_t *>(out.data());
+  size_t n = h.samples;
+  if (IQBlockHeader::RAW16 == h.mode) {
+    if (h.payload < 2*n) { return 0; }
+    std::memcpy(y, payload, 2*n);
+  } else if (IQBlockHeader::PACKED == h.mode) {
+    return unpack(Buffer<uint8_t>(const_cast<uint8_t *>(payload), h.payload), out, n, h.param);
+  } else {
+    BitReader reader(payload, h.payload);
+    int k = h.param;
+    for (size_t i=0; i<n; i++) {
+      reader.refill();
+      // count the leading ones of the unary quotient
+      uint64_t ones = ~reader.bits();
+      int q = ones ? __builtin_ctzll(ones) : 64;
+      uint32_t z;
+      if (q >= RICE_LIMIT) {
+        if (reader.available() < (RICE_LIMIT+RICE_ESCAPE_BITS)) { return 0; }
+        reader.get(RICE_LIMIT);
+        z = uint32_t(reader.get(RICE_ESCAPE_BITS));
+      } else {
+        if (reader.available() < (q+1+k)) { return 0; }
+        reader.get(q+1);
+        z = (uint32_t(q) << k) | uint32_t(reader.get(k));
+      }
+      y[i] = int16_t(unzigzag(z) + ((i >= h.lanes) ? int32_t(y[i-h.lanes]) : 0));
+    }
+  }
+  return n;
+}
+
+size_t IQDecoder::decode(const uint8_t *data, size_t len, std::vector<int16_t> &out) {
+  size_t pos = 0;
+  IQBlockHeader h;
+  while (header(data+pos, len-pos, h)) {
+    size_t start = out.size();
+    out.resize(start + h.samples);
+    if (h.samples && (h.samples != decodeBlock(data+pos, len-pos, Buffer<int16_t>(&out[start], h.samples)))) {
+      out.resize(start);
+      break;
+    }
+    pos += sizeof(IQBlockHeader) + h.payload;
+  }
+  return pos;
+}
+
+
+// Block index
+// Constructor
+IQBlockIndex::IQBlockIndex(const uint8_t *data, size_t len)
+  : _data(data), _len(len), _entries()
+{
+  size_t pos = 0;
+  IQBlockHeader h;
+  while (IQDecoder::header(data+pos, len-pos, h)) {
+    Entry entry = {pos, h.offset, h.samples};
+    _entries.push_back(entry);
+    pos += sizeof(IQBlockHeader) + h.payload;
+  }
+}
+
+size_t IQBlockIndex::find(uint64_t offset) const {
+  // last block starting at or before the offset
+  size_t lo = 0, hi = _entries.size();
+  while (lo < hi) {
+    size_t mid = (lo+hi)/2;
+    if (_entries[mid].offset <= offset) { lo = mid+1; } else { hi = mid; }
+  }
+  if ((0 == lo) || (offset >= (_entries[lo-1].offset + _entries[lo-1].samples))) { return _entries.size(); }
+  return lo-1;
+}
+
+size_t IQBlockIndex::read(uint64_t offset, const Buffer<int16_t> &out, size_t N) const {
+  N = std::min(N, out.size());
+  size_t count = 0;
+  for (size_t b=find(offset); (b<_entries.size()) && (count<N); b++) {
+    const Entry &e = _entries[b];
+    if (e.offset != (offset+count) && (0 != count)) { break; } // gap in the stream
+    Buffer<int16_t> block(e.samples);
+    if (e.samples != IQDecoder::decodeBlock(_data+e.position, _len-e.position, block)) { break; }
+    size_t skip = size_t(offset+count-e.offset), n = std::min(size_t(e.samples)-skip, N-count);
+    std::memcpy(out.data()+count*sizeof(int16_t), block.data()+skip*sizeof(int16_t), n*sizeof(int16_t));
+    count += n;
+  }
+  return count;
+}
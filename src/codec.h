@@ -0,0 +1,160 @@
+#ifndef __SDR_CODEC_H__
+#define __SDR_CODEC_H__
+
+#include "buffer.h"
+#include <vector>
+
+namespace sdr {
+
+  // Compact storage of integer IQ samples.
+  //
+  // Samples are handled as int16 values (use Buffer<cint16>::as<int16_t>()
+  // for complex samples, I and Q interleaved). Three layers are provided:
+  //  - tight bit packing of 1..16 bit samples (e.g. 12-bit: 2 samples in 3
+  //    bytes, 10-bit: 4 samples in 5 bytes), pack() / unpack();
+  //  - lossless delta + Rice compression, deltas are taken per lane (I from
+  //    I, Q from Q), the Rice parameter adapts per block;
+  //  - a block format with a fixed header per block, each block decodes
+  //    independently, hence a BlockIndex allows random access by sample
+  //    offset.
+
+  // Returns the number of bytes of N packed samples with the given width
+  inline size_t packedSize(size_t N, int bits) { return (N*size_t(bits)+7)/8; }
+
+  // Packs the samples into bits-wide fields (little-endian bit order),
+  // values are saturated to the signed range of the width. Returns the number
+  // of bytes written or 0 if out is too small or bits is not in 1..16.
+  size_t pack(const Buffer<int16_t> &in, const Buffer<uint8_t> &out, int bits);
+
+  // Unpacks N samples (sign extended), returns the number of samples written
+  // or 0 if in or out are too small or bits is not in 1..16.
+  size_t unpack(const Buffer<uint8_t> &in, const Buffer<int16_t> &out, size_t N, int bits);
+
+
+  // Fixed header in front of every block
+  struct IQBlockHeader {
+    // block payload encoding
+    typedef enum {
+      RAW16 = 0,      // int16 samples
+      PACKED = 1,     // bit packed, param = width
+      DELTA_RICE = 2  // delta + Rice code, param = Rice parameter k
+    } Mode;
+
+    // identifies a block ("IQB1")
+    uint32_t magic;
+    // encoding (Mode)
+    uint8_t mode;
+    // encoding parameter
+    uint8_t param;
+    // number of interleaved lanes (2 for complex samples)
+    uint16_t lanes;
+    // number of int16 values in the block
+    uint32_t samples;
+    // payload size in bytes (following the header)
+    uint32_t payload;
+    // offset of the first value in the stream
+    uint64_t offset;
+  };
+
+
+  // Encodes a stream of int16 values into independent blocks
+  class IQEncoder {
+    public:
+      // Constructor with mode, number of values per block, number of
+      // interleaved lanes and sample width (PACKED mode)
+      IQEncoder(IQBlockHeader::Mode mode=IQBlockHeader::DELTA_RICE, size_t blockSize=16384,
+                size_t lanes=2, int bits=12);
+
+      // Destructor
+      virtual ~IQEncoder();
+
+      // Returns the stream offset of the next value
+      inline uint64_t offset() const { return _offset; }
+      // Returns the maximum encoded size of N values
+      size_t maxEncodedSize(size_t N) const;
+
+      // Encodes the values into blocks of at most blockSize values, appends
+      // them to out. Returns the number of bytes appended. A DELTA_RICE block
+      // that does not compress is stored as RAW16.
+      size_t encode(const Buffer<int16_t> &in, std::vector<uint8_t> &out);
+
+      // Restarts the stream offsets at 0
+      inline void reset() { _offset = 0; }
+
+    protected:
+      // encodes a single block at the end of out
+      void encodeBlock(const Buffer<int16_t> &in, std::vector<uint8_t> &out);
+
+    protected:
+      // encoding
+      IQBlockHeader::Mode _mode;
+      // values per block
+      size_t _block_size;
+      // interleaved lanes
+      size_t _lanes;
+      // sample width for PACKED
+      int _bits;
+      // stream offset of the next value
+      uint64_t _offset;
+  };
+
+
+  // Decodes blocks
+  class IQDecoder {
+    public:
+      // Reads the header of the block at data, returns false if there is no
+      // valid and complete block
+      static bool header(const uint8_t *data, size_t len, IQBlockHeader &header);
+
+      // Decodes the block at data into out, returns the number of values
+      // written or 0 on error (invalid block or out too small)
+      static size_t decodeBlock(const uint8_t *data, size_t len, const Buffer<int16_t> &out);
+
+      // Decodes all blocks, appends the values to out. Returns the number of
+      // bytes consumed (complete blocks only).
+      static size_t decode(const uint8_t *data, size_t len, std::vector<int16_t> &out);
+  };
+
+
+  // Index of the blocks of an encoded stream for random access
+  class IQBlockIndex {
+    public:
+      // An indexed block
+      struct Entry {
+        // byte offset of the block header
+        size_t position;
+        // stream offset of the first value
+        uint64_t offset;
+        // number of values
+        uint32_t samples;
+      };
+
+    public:
+      // Constructor, scans the block headers (payloads are skipped)
+      IQBlockIndex(const uint8_t *data, size_t len);
+
+      // Returns the number of blocks
+      inline size_t size() const { return _entries.size(); }
+      // Returns block i
+      inline const Entry &operator[] (size_t i) const { return _entries[i]; }
+
+      // Returns the index of the block containing the stream offset, or
+      // size() if it is not covered
+      size_t find(uint64_t offset) const;
+
+      // Decodes N values starting at the stream offset into out, returns the
+      // number of values written
+      size_t read(uint64_t offset, const Buffer<int16_t> &out, size_t N) const;
+
+    protected:
+      // encoded stream
+      const uint8_t *_data;
+      // its length
+      size_t _len;
+      // blocks
+      std::vector<Entry> _entries;
+  };
+
+}
+
+#endif
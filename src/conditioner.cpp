@@ -0,0 +1,137 @@
+#include "conditioner.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace sdr;
+
+// converts a time constant in samples into a per-chunk smoothing factor
+static float chunkAlpha(double time) {
+  if (time <= 0) { return 1; }
+  return float(1 - std::exp(-double(IQConditioner::CHUNK)/time));
+}
+
+// Constructor
+IQConditioner::IQConditioner(double dcTime, double iqTime)
+  : _dc_enabled(true), _iq_enabled(true), _agc_enabled(false),
+    _dc_alpha(chunkAlpha(dcTime)), _iq_alpha(chunkAlpha(iqTime)),
+    _attack(chunkAlpha(256)), _decay(chunkAlpha(16384)), _reference(1), _max_gain(1e4),
+    _gain(1), _gain_step(0)
+{
+  reset();
+}
+
+// Destructor
+IQConditioner::~IQConditioner() {}
+
+void IQConditioner::setDC(bool enable, double time) {
+  _dc_enabled = enable; _dc_alpha = chunkAlpha(time);
+}
+
+void IQConditioner::setIQ(bool enable, double time) {
+  _iq_enabled = enable; _iq_alpha = chunkAlpha(time);
+}
+
+void IQConditioner::setAGC(float reference, double attack, double decay, float maxGain) {
+  _agc_enabled = true; _reference = reference; _max_gain = maxGain;
+  _attack = chunkAlpha(attack); _decay = chunkAlpha(decay);
+}
+
+void IQConditioner::setGain(float gain) {
+  _agc_enabled = false; _gain = gain; _gain_step = 0;
+}
+
+void IQConditioner::reset() {
+  _dc = 0; _ii = _qq = 1; _iq = 0; _p = 0; _s = 1; _level = 0;
+  if (_agc_enabled) { _gain = 1; }
+  _gain_step = 0; _primed = false; _count = 0;
+  _sum_i = _sum_q = _sum_ii = _sum_qq = _sum_iq = _sum_pow = 0;
+}
+
+bool IQConditioner::process(const Buffer< std::complex<float> > &in, const Buffer< std::complex<float> > &out) {
+  if (out.size() < in.size()) { return false; }
+  const float *x = reinterpret_cast<const float *>(in.data());
+  float *y = reinterpret_cast<float *>(out.data());
+  size_t N = in.size();
+  while (N) {
+    // process up to the end of the current chunk
+    size_t n = std::min(N, CHUNK-_count);
+    processSegment(x, y, n);
+    x += 2*n; y += 2*n; N -= n;
+    if (CHUNK == (_count += n)) { update(); }
+  }
+  return true;
+}
+
+void IQConditioner::processSegment(const float *x, float *y, size_t n) {
+  float dI = _dc_enabled ? _dc.real() : 0, dQ = _dc_enabled ? _dc.imag() : 0;
+  float s = _iq_enabled ? _s : 1, sp = _iq_enabled ? -_s*_p : 0;
+  float g = _gain, step = _gain_step;
+  float si = 0, sq = 0, sii = 0, sqq = 0, siq = 0, spow = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  // two samples [I0,Q0,I1,Q1] per vector
+  __m128 dc = _mm_setr_ps(dI, dQ, dI, dQ), a = _mm_setr_ps(1, s, 1, s), b = _mm_setr_ps(0, sp, 0, sp);
+  __m128 gv = _mm_setr_ps(g, g, g+step, g+step), gstep = _mm_set1_ps(2*step);
+  __m128 sum = _mm_setzero_ps(), sq2 = _mm_setzero_ps(), cross = _mm_setzero_ps(), pow2 = _mm_setzero_ps();
+  for (; (i+2)<=n; i+=2) {
+    __m128 xv = _mm_loadu_ps(x+2*i);
+    __m128 v = _mm_sub_ps(xv, dc);
+    __m128 sw = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2,3,0,1));
+    sum = _mm_add_ps(sum, xv);
+    sq2 = _mm_add_ps(sq2, _mm_mul_ps(v, v));
+    cross = _mm_add_ps(cross, _mm_mul_ps(v, sw));
+    __m128 c = _mm_add_ps(_mm_mul_ps(v, a), _mm_mul_ps(sw, b));
+    pow2 = _mm_add_ps(pow2, _mm_mul_ps(c, c));
+    _mm_storeu_ps(y+2*i, _mm_mul_ps(c, gv));
+    gv = _mm_add_ps(gv, gstep);
+  }
+  float l[4];
+  _mm_storeu_ps(l, sum);   si += l[0]+l[2];  sq += l[1]+l[3];
+  _mm_storeu_ps(l, sq2);   sii += l[0]+l[2]; sqq += l[1]+l[3];
+  _mm_storeu_ps(l, cross); siq += l[0]+l[2];
+  _mm_storeu_ps(l, pow2);  spow += l[0]+l[1]+l[2]+l[3];
+  g += i*step;
+#endif
+  for (; i<n; i++, g+=step) {
+    float xi = x[2*i], xq = x[2*i+1];
+    float vi = xi-dI, vq = xq-dQ;
+    si += xi; sq += xq; sii += vi*vi; sqq += vq*vq; siq += vi*vq;
+    float ci = vi, cq = s*vq + sp*vi;
+    spow += ci*ci + cq*cq;
+    y[2*i] = g*ci; y[2*i+1] = g*cq;
+  }
+  _gain = g;
+  _sum_i += si; _sum_q += sq; _sum_ii += sii; _sum_qq += sqq; _sum_iq += siq; _sum_pow += spow;
+}
+
+void IQConditioner::update() {
+  double m = double(CHUNK);
+  // DC estimate
+  std::complex<float> mean(_sum_i/m, _sum_q/m);
+  _dc = _primed ? (_dc + _dc_alpha*(mean-_dc)) : mean;
+  // IQ moments and correction parameters
+  double ii = _sum_ii/m, qq = _sum_qq/m, iq = _sum_iq/m;
+  if (_primed) {
+    _ii += _iq_alpha*(ii-_ii); _qq += _iq_alpha*(qq-_qq); _iq += _iq_alpha*(iq-_iq);
+  } else {
+    _ii = ii; _qq = qq; _iq = iq;
+  }
+  if (_ii > 0) {
+    double q1 = _qq - _iq*_iq/_ii;
+    _p = _iq/_ii;
+    _s = (q1 > 0) ? std::sqrt(_ii/q1) : 1;
+  }
+  // AGC
+  if (_agc_enabled) {
+    double level = _sum_pow/m;
+    if (! _primed) { _level = level; }
+    else { _level += ((level > _level) ? _attack : _decay)*(level-_level); }
+    float target = (_level > 0) ? std::min(_max_gain, float(_reference/std::sqrt(_level))) : _max_gain;
+    if (_primed) { _gain_step = (target-_gain)/CHUNK; }
+    else { _gain = target; _gain_step = 0; }
+  }
+  _primed = true;
+  _count = 0;
+  _sum_i = _sum_q = _sum_ii = _sum_qq = _sum_iq = _sum_pow = 0;
+}
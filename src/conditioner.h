@@ -0,0 +1,92 @@
+#ifndef __SDR_CONDITIONER_H__
+#define __SDR_CONDITIONER_H__
+
+#include "buffer.h"
+
+namespace sdr {
+
+  // Front-end conditioning of complex float samples: DC removal, IQ
+  // gain/phase imbalance correction and automatic gain control (AGC) in a
+  // single pass over the block.
+  //
+  // The estimates (DC offset, IQ moments, signal level) are accumulated while
+  // the samples are corrected and updated once per chunk of CHUNK samples.
+  // The AGC gain ramps linearly to its new value over the following chunk.
+  // Updating per chunk instead of per sample keeps the per-sample work free of
+  // recursions, hence it can be vectorized (SSE if available). All state,
+  // including partially accumulated chunks, carries across blocks.
+  //
+  // IQ correction orthogonalizes Q against I and equalizes their powers:
+  //   I' = I,  Q' = s*(Q - p*I),  p = E[IQ]/E[I^2],  s = sqrt(E[I^2]/E[(Q-pI)^2])
+  class IQConditioner {
+    public:
+      // number of samples between estimate updates
+      static const size_t CHUNK = 64;
+
+    public:
+      // Constructor. Time constants are given in samples.
+      IQConditioner(double dcTime=4096, double iqTime=65536);
+
+      // Destructor
+      virtual ~IQConditioner();
+
+      // Enables/disables DC removal with the given time constant
+      void setDC(bool enable, double time=4096);
+      // Enables/disables IQ imbalance correction with the given time constant
+      void setIQ(bool enable, double time=65536);
+      // Enables AGC with target RMS level, attack and decay time constants
+      // (in samples) and maximum gain
+      void setAGC(float reference=1, double attack=256, double decay=16384, float maxGain=1e4);
+      // Disables AGC and applies the fixed gain
+      void setGain(float gain);
+
+      // Returns the current DC estimate
+      inline std::complex<float> dc() const { return _dc; }
+      // Returns the current phase coupling estimate p
+      inline float phaseCorrection() const { return _p; }
+      // Returns the current Q scaling s
+      inline float gainCorrection() const { return _s; }
+      // Returns the current AGC gain
+      inline float gain() const { return _gain; }
+
+      // Conditions the block in into out (may be the same buffer). Returns
+      // false if out is smaller than in.
+      bool process(const Buffer< std::complex<float> > &in, const Buffer< std::complex<float> > &out);
+
+      // Resets all estimates
+      void reset();
+
+    protected:
+      // processes n samples of the current chunk
+      void processSegment(const float *x, float *y, size_t n);
+      // updates the estimates at the end of a chunk
+      void update();
+
+    protected:
+      // enable flags
+      bool _dc_enabled, _iq_enabled, _agc_enabled;
+      // per-chunk smoothing factors
+      float _dc_alpha, _iq_alpha, _attack, _decay;
+      // AGC target level and maximum gain
+      float _reference, _max_gain;
+      // current DC estimate
+      std::complex<float> _dc;
+      // smoothed IQ moments E[I^2], E[Q^2], E[IQ]
+      double _ii, _qq, _iq;
+      // IQ correction parameters
+      float _p, _s;
+      // smoothed signal power after correction
+      double _level;
+      // current gain and gain increment per sample
+      float _gain, _gain_step;
+      // set once the first chunk initialized the estimates
+      bool _primed;
+      // samples accumulated in the current chunk
+      size_t _count;
+      // chunk accumulators: sum of inputs, moments and output power
+      double _sum_i, _sum_q, _sum_ii, _sum_qq, _sum_iq, _sum_pow;
+  };
+
+}
+
+#endif
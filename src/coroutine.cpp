@@ -0,0 +1,130 @@
+#include "coroutine.h"
+#include <chrono>
+
+using namespace sdr;
+
+// executor running in this thread
+static thread_local Executor *_current_executor = 0;
+
+// Constructor
+Executor::Executor()
+  : _runnable(), _resuming(), _rings(), _waiting(), _changed(), _pending(0), _notified(false)
+{}
+
+// Destructor
+Executor::~Executor() {
+  for (size_t i=0; i<_runnable.size(); i++) { _runnable[i].destroy(); }
+  for (auto it=_rings.begin(); it!=_rings.end(); it++) {
+    for (size_t i=0; i<it->second.waiters.size(); i++) { it->second.waiters[i].handle.destroy(); }
+  }
+  for (size_t i=0; i<_waiting.size(); i++) { _waiting[i].handle.destroy(); }
+  _runnable.clear();
+  _rings.clear();
+  _waiting.clear();
+}
+
+Executor *Executor::current() {
+  return _current_executor;
+}
+
+void Executor::spawn(Task task) {
+  std::coroutine_handle<> handle = task.release();
+  if (! handle) { return; }
+  _runnable.push_back(handle);
+  _pending++;
+}
+
+void Executor::wait(std::coroutine_handle<> handle, const void *condition, bool (*check)(const void *),
+                    const void *source) {
+  Waiter waiter = {handle, condition, check};
+  if (source) { _rings[source].waiters.push_back(waiter); }
+  else { _waiting.push_back(waiter); }
+}
+
+void Executor::schedule(std::coroutine_handle<> handle) {
+  _runnable.push_back(handle);
+}
+
+void Executor::changed(const void *ring) {
+  auto it = _rings.find(ring);
+  if ((it == _rings.end()) || it->second.changed) { return; }
+  it->second.changed = true;
+  _changed.push_back(ring);
+}
+
+void Executor::wake(std::vector<Waiter> &waiters) {
+  for (size_t i=0; i<waiters.size();) {
+    if (waiters[i].check(waiters[i].condition)) {
+      _runnable.push_back(waiters[i].handle);
+      waiters[i] = waiters.back();
+      waiters.pop_back();
+    } else {
+      i++;
+    }
+  }
+}
+
+size_t Executor::step() {
+  return round(true);
+}
+
+size_t Executor::round(bool all) {
+  // move waiters with satisfied conditions to the runnable list: on all
+  // rings (changes from outside are not reported) or on the changed ones
+  if (all) {
+    for (auto it=_rings.begin(); it!=_rings.end(); it++) {
+      it->second.changed = false;
+      wake(it->second.waiters);
+    }
+  } else {
+    for (size_t i=0; i<_changed.size(); i++) {
+      Ring &ring = _rings[_changed[i]];
+      ring.changed = false;
+      wake(ring.waiters);
+    }
+  }
+  _changed.clear();
+  wake(_waiting);
+  // resume them, coroutines suspending again add themselves to the lists,
+  // the rings they change are reported to changed()
+  _resuming.swap(_runnable);
+  Executor *previous = _current_executor;
+  RingObserver *observer = RingObserver::current();
+  _current_executor = this;
+  RingObserver::current() = this;
+  for (size_t i=0; i<_resuming.size(); i++) {
+    _resuming[i].resume();
+    if (_resuming[i].done()) {
+      _resuming[i].destroy();
+      _pending--;
+    }
+  }
+  _current_executor = previous;
+  RingObserver::current() = observer;
+  size_t n = _resuming.size();
+  _resuming.clear();
+  return n;
+}
+
+size_t Executor::run() {
+  size_t total = 0, n = round(true);
+  while (0 < n) { total += n; n = round(false); }
+  return total;
+}
+
+size_t Executor::wait(unsigned timeout) {
+  size_t n = run();
+  if (0 < n) { return n; }
+  {
+    std::unique_lock<std::mutex> guard(_notify_lock);
+    _notify.wait_for(guard, std::chrono::milliseconds(timeout), [this]() { return _notified; });
+    _notified = false;
+  }
+  return run();
+}
+
+void Executor::notify() {
+  std::lock_guard<std::mutex> guard(_notify_lock);
+  _notified = true;
+  _notify.notify_one();
+}
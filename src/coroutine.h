@@ -0,0 +1,238 @@
+#ifndef __SDR_COROUTINE_H__
+#define __SDR_COROUTINE_H__
+
+#if __cplusplus < 202002L
+#error "coroutine.h requires C++20 (-std=c++20)"
+#endif
+
+#include "buffer.h"
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <inttypes.h>
+
+namespace sdr {
+
+  // Streaming stages as C++20 coroutines.
+  //
+  // A stage is a coroutine returning Task. It waits for data or space by
+  // awaiting the conditions of the ring buffers, e.g.
+  //
+  //   Task stage(CircularBuffer<float> &in, CircularBuffer<float> &out) {
+  //     Buffer<float> block(256);
+  //     for (;;) {
+  //       co_await in.readable(256);
+  //       co_await out.writable(256);
+  //       in.pull(block, 256); ... out.push(block);
+  //     }
+  //   }
+  //
+  // Stages are spawned on an Executor which resumes them in its own thread
+  // once their condition holds. Any object with a "bool holds() const"
+  // method can be awaited (FillCondition, BroadcastBuffer::Condition).
+  // An executor is single-threaded, several executors may run in different
+  // threads, each with its own set of stages.
+  //
+  // Waiting stages are indexed by the ring of their condition (its
+  // "const void *source() const" method). While resuming stages, the
+  // executor is the RingObserver of its thread, hence a round only checks
+  // the stages waiting on rings that were changed in the previous round.
+  // Conditions without a source are checked every round. Changes made
+  // outside of the executor are picked up by the first round of step(),
+  // run() and wait(), other threads call notify() to end a wait().
+
+  class Executor;
+
+  // Coroutine handle of a stage, owned by the executor once spawned
+  class Task {
+    public:
+      // Promise type of the coroutine
+      struct promise_type {
+        inline Task get_return_object() {
+          return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        // do not run until spawned
+        inline std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+        // keep the frame until the executor destroys it
+        inline std::suspend_always final_suspend() noexcept { return std::suspend_always(); }
+        inline void return_void() {}
+        inline void unhandled_exception() { std::terminate(); }
+      };
+
+      // Constructor from handle
+      explicit Task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+      // Move constructor
+      Task(Task &&other) noexcept : _handle(other._handle) { other._handle = nullptr; }
+      // Tasks cannot be copied
+      Task(const Task &other) = delete;
+      // Destructor, destroys the coroutine if it was never spawned
+      ~Task() { if (_handle) { _handle.destroy(); } }
+
+      // Releases the handle
+      inline std::coroutine_handle<> release() {
+        std::coroutine_handle<> handle = _handle;
+        _handle = nullptr;
+        return handle;
+      }
+
+    protected:
+      // coroutine handle
+      std::coroutine_handle<promise_type> _handle;
+  };
+
+
+  // Single-threaded executor of coroutine stages
+  class Executor: public RingObserver {
+    public:
+      // Constructor
+      Executor();
+
+      // Destructor, destroys all remaining stages
+      virtual ~Executor();
+
+      // Adds a stage, it is started with the next step()
+      void spawn(Task task);
+
+      // Runs one round: resumes all stages whose condition holds, returns the
+      // number of resumed stages
+      size_t step();
+
+      // Runs rounds until no stage can make progress, returns the total number
+      // of resumptions. Call again once new data was pushed from outside.
+      size_t run();
+
+      // Runs the stages, if none could make progress blocks until notify()
+      // was called or the timeout (in ms) expired and runs them again.
+      // Returns the total number of resumptions.
+      size_t wait(unsigned timeout);
+
+      // Ends a wait(), may be called from any thread (e.g. after pushing
+      // data for the stages)
+      void notify();
+
+      // Returns the number of stages that have not finished yet
+      inline size_t pending() const { return _pending; }
+
+      // Returns the executor running in the current thread (0 if none)
+      static Executor *current();
+
+    public:
+      // Parks the coroutine until check(condition) holds, the condition
+      // depends on the ring source (0 if unknown)
+      void wait(std::coroutine_handle<> handle, const void *condition, bool (*check)(const void *),
+                const void *source);
+      // Resumes the coroutine in the next round
+      void schedule(std::coroutine_handle<> handle);
+
+      // Marks the waiters on ring for the next round (RingObserver)
+      virtual void changed(const void *ring);
+
+    protected:
+      // A suspended coroutine and its condition
+      struct Waiter {
+        std::coroutine_handle<> handle;
+        const void *condition;
+        bool (*check)(const void *);
+      };
+
+      // The coroutines waiting on a ring
+      struct Ring {
+        Ring() : waiters(), changed(false) {}
+        // waiting coroutines
+        std::vector<Waiter> waiters;
+        // true if the ring changed since the last round
+        bool changed;
+      };
+
+      // runs one round, checks all waiters or those on changed rings only
+      size_t round(bool all);
+      // moves the waiters whose condition holds to the runnable list
+      void wake(std::vector<Waiter> &waiters);
+
+    protected:
+      // coroutines to resume in the next round
+      std::vector< std::coroutine_handle<> > _runnable;
+      // coroutines being resumed in the current round
+      std::vector< std::coroutine_handle<> > _resuming;
+      // coroutines waiting for their condition, by ring
+      std::unordered_map<const void *, Ring> _rings;
+      // coroutines waiting for a condition without a ring
+      std::vector<Waiter> _waiting;
+      // rings changed since the last round
+      std::vector<const void *> _changed;
+      // number of unfinished coroutines
+      size_t _pending;
+      // wake-up of wait()
+      std::mutex _notify_lock;
+      std::condition_variable _notify;
+      // true if notify() was called since the last wait()
+      bool _notified;
+  };
+
+
+  // Awaiter for conditions
+  template <class Condition>
+  class ConditionAwaiter {
+    public:
+      // Constructor from condition
+      ConditionAwaiter(const Condition &condition) : _condition(condition) {}
+
+      // do not suspend if the condition already holds
+      inline bool await_ready() const { return _condition.holds(); }
+
+      // park the coroutine at the current executor
+      inline bool await_suspend(std::coroutine_handle<> handle) {
+        Executor *executor = Executor::current();
+        if (0 == executor) { return false; } // not run by an executor: do not suspend
+        executor->wait(handle, this, &ConditionAwaiter::check, source());
+        return true;
+      }
+
+      inline void await_resume() const {}
+
+    protected:
+      // returns the ring of the condition (0 if it has none)
+      inline const void *source() const {
+        if constexpr (requires { _condition.source(); }) { return _condition.source(); }
+        else { return nullptr; }
+      }
+      // checks the condition of the awaiter
+      static bool check(const void *self) {
+        return reinterpret_cast<const ConditionAwaiter *>(self)->_condition.holds();
+      }
+
+    protected:
+      // the condition
+      Condition _condition;
+  };
+
+  // Makes every condition awaitable
+  template <class Condition>
+  inline auto operator co_await(const Condition &condition)
+    -> decltype(condition.holds(), ConditionAwaiter<Condition>(condition))
+  {
+    return ConditionAwaiter<Condition>(condition);
+  }
+
+  // Awaitable that lets the other stages run before resuming
+  class Yield {
+    public:
+      inline bool await_ready() const { return false; }
+      inline bool await_suspend(std::coroutine_handle<> handle) {
+        Executor *executor = Executor::current();
+        if (0 == executor) { return false; }
+        executor->schedule(handle);
+        return true;
+      }
+      inline void await_resume() const {}
+  };
+
+  // Returns an awaitable yielding to the other stages
+  inline Yield yield() { return Yield(); }
+
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "correlator.h"
+
+using namespace sdr;
+
+// Constructor
+PreambleCorrelator::PreambleCorrelator(const Buffer< std::complex<float> > &preamble, float threshold, size_t fftSize,
+                                       size_t resync)
+  : _length(std::max(size_t(1), preamble.size())), _energy(0), _threshold(threshold),
+    _forward(FFT::nextPow2(std::max(fftSize, 4*_length))),
+    _inverse(_forward.size(), true), _spectrum(_forward.size()), _work(_forward.size()), _corr(_forward.size()),
+    _resync(uint64_t(std::max(size_t(1), resync))*_length)
+{
+  size_t F = _forward.size();
+  // spectrum of the zero padded preamble
+  for (size_t i=0; i<F; i++) { _work[i] = (i < preamble.size()) ? preamble[i] : std::complex<float>(0); }
+  for (size_t i=0; i<preamble.size(); i++) { _energy += std::norm(preamble[i]); }
+  _forward.execute(_work, _spectrum);
+  // conjugate and include the 1/F of the inverse transform
+  for (size_t i=0; i<F; i++) { _spectrum[i] = std::conj(_spectrum[i])/float(F); }
+  reset();
+}
+
+// Destructor
+PreambleCorrelator::~PreambleCorrelator() {}
+
+void PreambleCorrelator::reset() {
+  _fill = 0; _base = 0; _consumed = 0; _history = 0; _since_resync = 0; _active = false; _dead_until = 0;
+  _candidate.offset = 0; _candidate.metric = 0; _candidate.correlation = 0;
+}
+
+size_t PreambleCorrelator::process(const Buffer< std::complex<float> > &in, std::vector<Event> &events) {
+  size_t count = events.size(), F = _forward.size(), offset = 0;
+  while (offset < in.size()) {
+    // fill the work buffer
+    size_t n = std::min(F-_fill, in.size()-offset);
+    std::memcpy(_work.data()+_fill*sizeof(std::complex<float>), in.data()+offset*sizeof(std::complex<float>),
+                n*sizeof(std::complex<float>));
+    _fill += n; offset += n;
+    if (F == _fill) { correlate(events, F-_length+1); }
+  }
+  _consumed += in.size();
+  return events.size()-count;
+}
+
+size_t PreambleCorrelator::flush(std::vector<Event> &events) {
+  size_t count = events.size(), F = _forward.size(), L = _length;
+  if (_fill >= L) {
+    // zero padded, the windows reaching into the padding are not scanned
+    std::memset(_work.data()+_fill*sizeof(std::complex<float>), 0, (F-_fill)*sizeof(std::complex<float>));
+    correlate(events, _fill-L+1);
+  }
+  if (_active) { events.push_back(_candidate); }
+  reset();
+  return events.size()-count;
+}
+
+void PreambleCorrelator::correlate(std::vector<Event> &events, size_t count) {
+  size_t F = _forward.size(), L = _length, B = F-L+1;
+  // circular cross-correlation, the first B values do not wrap
+  _forward.execute(_work, _corr);
+  float *c = reinterpret_cast<float *>(_corr.data());
+  const float *p = reinterpret_cast<const float *>(_spectrum.data());
+  for (size_t i=0; i<2*F; i+=2) {
+    float re = c[i]*p[i] - c[i+1]*p[i+1], im = c[i]*p[i+1] + c[i+1]*p[i];
+    c[i] = re; c[i+1] = im;
+  }
+  _inverse.execute(_corr, _corr);
+
+  // energy of the first window: the L-1 samples of history are known from
+  // the previous block, it is recomputed in the first block and after every
+  // resync interval (bounds the drift of the running sum)
+  double energy = _history;
+  if ((0 == _base) || (_since_resync >= _resync)) {
+    energy = 0;
+    for (size_t k=0; k<L; k++) { energy += std::norm(_work[k]); }
+    _since_resync = 0;
+  } else {
+    energy += std::norm(_work[L-1]);
+  }
+  _since_resync += count;
+  for (size_t j=0; j<count; j++) {
+    uint64_t n = _base+j;
+    // report the candidate once no larger value followed within L samples
+    if (_active && (n >= (_candidate.offset+L))) {
+      events.push_back(_candidate);
+      _active = false;
+      _dead_until = _candidate.offset+L;
+    }
+    // compare before dividing, most values are below the threshold
+    // (bounded by 1, rounding may exceed it for vanishing input)
+    double norm = _energy*energy, power = std::norm(_corr[j]);
+    if ((norm > 1e-30) && (n >= _dead_until) && (power >= _threshold*norm)) {
+      float metric = std::min(1.f, float(power/norm));
+      if ((metric >= _threshold) && ((! _active) || (metric > _candidate.metric))) {
+        _candidate.offset = n; _candidate.metric = metric; _candidate.correlation = _corr[j];
+        _active = true;
+      }
+    }
+    if ((j+1) < count) { energy += std::norm(_work[j+L]) - std::norm(_work[j]); }
+  }
+  // energy of the history kept for the next block
+  _history = energy - std::norm(_work[B-1]);
+
+  // keep the last L-1 samples
+  std::memmove(_work.data(), _work.data()+B*sizeof(std::complex<float>), (L-1)*sizeof(std::complex<float>));
+  _fill = L-1;
+  _base += B;
+}
+
+Buffer< std::complex<float> >
+PreambleCorrelator::span(const Buffer< std::complex<float> > &block, uint64_t blockOffset, const Event &event, size_t N) {
+  if ((event.offset < blockOffset) || ((event.offset+N) > (blockOffset+block.size()))) {
+    return Buffer< std::complex<float> >();
+  }
+  return block.sub(size_t(event.offset-blockOffset), N);
+}
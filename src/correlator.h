@@ -0,0 +1,122 @@
+#ifndef __SDR_CORRELATOR_H__
+#define __SDR_CORRELATOR_H__
+
+#include "buffer.h"
+#include "fft.h"
+#include <vector>
+
+namespace sdr {
+
+  // Streaming preamble correlator and burst detector.
+  //
+  // The cross-correlation r[n] = sum_k x[n+k]*conj(p[k]) with the preamble p
+  // of length L is computed block-wise by FFT (overlap-save): every FFT of
+  // size F covers L-1 samples of the previous block and F-L+1 new samples
+  // and yields F-L+1 correlation values, i.e. O(log F) per sample instead
+  // of O(L). The correlation is normalized by the preamble energy and a
+  // running energy estimate of the input window,
+  //   m[n] = |r[n]|^2 / (Ep * sum_k |x[n+k]|^2)  in [0, 1],
+  // hence the threshold does not depend on the signal level. The window
+  // energy is a running sum, to bound its floating point drift it is
+  // recomputed from the window every resync*L samples.
+  //
+  // A detection is the maximum of m above the threshold within L samples.
+  // It is reported once no larger value followed within L samples, the
+  // events carry the absolute sample offset of the preamble start within
+  // the stream (see span() to extract it as a view). At the end of the
+  // stream, flush() reports the detections still pending.
+  class PreambleCorrelator {
+    public:
+      // A detected preamble
+      struct Event {
+        // absolute offset of the first preamble sample in the stream
+        uint64_t offset;
+        // normalized correlation (0..1)
+        float metric;
+        // correlation value (phase and amplitude of the preamble)
+        std::complex<float> correlation;
+      };
+
+    public:
+      // Constructor with preamble, detection threshold (normalized, 0..1),
+      // FFT size (0: choose automatically, at least 2*L) and resync interval
+      // of the window energy (in preamble lengths)
+      PreambleCorrelator(const Buffer< std::complex<float> > &preamble, float threshold=0.5, size_t fftSize=0,
+                         size_t resync=16);
+
+      // Destructor
+      virtual ~PreambleCorrelator();
+
+      // Returns the preamble length
+      inline size_t length() const { return _length; }
+      // Returns the FFT size
+      inline size_t fftSize() const { return _forward.size(); }
+      // Returns the total number of samples processed
+      inline uint64_t consumed() const { return _consumed; }
+      // Returns the detection threshold
+      inline float threshold() const { return _threshold; }
+      // Sets the detection threshold
+      inline void setThreshold(float threshold) { _threshold = threshold; }
+
+      // Processes a block of samples, appends detections to events. Returns
+      // the number of new events. Detections are reported with a delay of
+      // at most F+L samples.
+      size_t process(const Buffer< std::complex<float> > &in, std::vector<Event> &events);
+
+      // Ends the stream: correlates the buffered samples (windows entirely
+      // within the stream only), appends the pending detection to events
+      // and resets (offsets restart at 0). Returns the number of new events.
+      size_t flush(std::vector<Event> &events);
+
+      // Returns the span of N samples starting at the event as a view into
+      // block, whose first sample has the absolute offset blockOffset. Returns
+      // an empty buffer if the span is not entirely within block.
+      static Buffer< std::complex<float> > span(const Buffer< std::complex<float> > &block, uint64_t blockOffset,
+                                                const Event &event, size_t N);
+
+      // Clears the state, offsets restart at 0
+      void reset();
+
+    protected:
+      // correlates the full work buffer and scans the first count outputs
+      // (at most F-L+1)
+      void correlate(std::vector<Event> &events, size_t count);
+
+    protected:
+      // preamble length
+      size_t _length;
+      // preamble energy
+      double _energy;
+      // detection threshold
+      float _threshold;
+      // forward and inverse transforms
+      FFT _forward, _inverse;
+      // conjugate spectrum of the preamble, scaled by 1/F
+      Buffer< std::complex<float> > _spectrum;
+      // input window (L-1 samples of history and new samples)
+      Buffer< std::complex<float> > _work;
+      // spectrum / correlation of the current window
+      Buffer< std::complex<float> > _corr;
+      // number of samples in the work buffer
+      size_t _fill;
+      // absolute offset of the first sample in the work buffer
+      uint64_t _base;
+      // energy of the L-1 samples of history (running sum)
+      double _history;
+      // samples between exact recomputations of the energy
+      uint64_t _resync;
+      // samples since the last recomputation
+      uint64_t _since_resync;
+      // total number of samples processed
+      uint64_t _consumed;
+      // current peak candidate
+      Event _candidate;
+      // true if there is a candidate
+      bool _active;
+      // no detections before this offset (after a detection)
+      uint64_t _dead_until;
+  };
+
+}
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef __SDR_EXPRESSION_H__
+#define __SDR_EXPRESSION_H__
+
+#include "buffer.h"
+#include <type_traits>
+#include <utility>
+
+namespace sdr {
+
+  // Lazy element-wise arithmetic on buffers.
+  //
+  // Arithmetic operators and the functions conj(), abs(), real() and imag()
+  // applied to Buffer<T> do not compute anything, they build an expression.
+  // The expression is evaluated in a single pass by eval(), hence a chain like
+  //   eval(out, gain*a*b + offset)
+  // reads every sample of a and b exactly once and writes out once.
+  //
+  // Expressions only hold pointers to the buffer data, the buffers must
+  // outlive the expression (i.e. evaluate them immediately).
+
+  // Element-wise operations, complex multiplication, division and abs are
+  // written out to keep the loops vectorizable (no NaN/overflow handling
+  // calls as in the std::complex operators).
+  namespace expr {
+    // Addition
+    struct Add {
+      template <class A, class B>
+      static inline auto apply(const A &a, const B &b) -> decltype(a+b) { return a+b; }
+    };
+
+    // Subtraction
+    struct Sub {
+      template <class A, class B>
+      static inline auto apply(const A &a, const B &b) -> decltype(a-b) { return a-b; }
+    };
+
+    // Multiplication
+    template <class A, class B>
+    inline auto mul(const A &a, const B &b) -> decltype(a*b) { return a*b; }
+    template <class T>
+    inline std::complex<T> mul(const std::complex<T> &a, const std::complex<T> &b) {
+      return std::complex<T>(a.real()*b.real()-a.imag()*b.imag(),
+                             a.real()*b.imag()+a.imag()*b.real());
+    }
+    struct Mul {
+      template <class A, class B>
+      static inline auto apply(const A &a, const B &b) -> decltype(mul(a,b)) { return mul(a,b); }
+    };
+
+    // Division
+    template <class A, class B>
+    inline auto div(const A &a, const B &b) -> decltype(a/b) { return a/b; }
+    template <class T>
+    inline std::complex<T> div(const std::complex<T> &a, const std::complex<T> &b) {
+      T s = T(1)/(b.real()*b.real()+b.imag()*b.imag());
+      return std::complex<T>((a.real()*b.real()+a.imag()*b.imag())*s,
+                             (a.imag()*b.real()-a.real()*b.imag())*s);
+    }
+    struct Div {
+      template <class A, class B>
+      static inline auto apply(const A &a, const B &b) -> decltype(div(a,b)) { return div(a,b); }
+    };
+
+    // Negation
+    struct Neg {
+      template <class A>
+      static inline A apply(const A &a) { return -a; }
+    };
+
+    // Complex conjugate (identity for real values)
+    struct Conj {
+      template <class A>
+      static inline A apply(const A &a) { return a; }
+      template <class T>
+      static inline std::complex<T> apply(const std::complex<T> &a) {
+        return std::complex<T>(a.real(), -a.imag());
+      }
+    };
+
+    // Absolute value
+    struct Abs {
+      template <class A>
+      static inline A apply(const A &a) { return (a < A(0)) ? -a : a; }
+      template <class T>
+      static inline T apply(const std::complex<T> &a) {
+        return std::sqrt(a.real()*a.real()+a.imag()*a.imag());
+      }
+    };
+
+    // Real part
+    struct Real {
+      template <class A>
+      static inline A apply(const A &a) { return a; }
+      template <class T>
+      static inline T apply(const std::complex<T> &a) { return a.real(); }
+    };
+
+    // Imaginary part (zero for real values)
+    struct Imag {
+      template <class A>
+      static inline A apply(const A &) { return A(0); }
+      template <class T>
+      static inline T apply(const std::complex<T> &a) { return a.imag(); }
+    };
+  }
+
+
+  // Base class of all expressions (CRTP)
+  template <class E>
+  class BufferExpr {
+    public:
+      // Returns the actual expression
+      inline const E &self() const { return static_cast<const E &>(*this); }
+  };
+
+  // Leaf expression referencing the data of a buffer
+  template <class T>
+  class BufferTerm: public BufferExpr< BufferTerm<T> > {
+    public:
+      typedef T value_type;
+
+      // Constructor from buffer
+      BufferTerm(const Buffer<T> &buffer)
+        : _data(reinterpret_cast<const T *>(buffer.data())), _size(buffer.size())
+      {}
+
+      // Element access
+      inline T operator[] (size_t i) const { return _data[i]; }
+      // Number of elements
+      inline size_t size() const { return _size; }
+      // Returns true if the expression can be evaluated into N elements
+      inline bool conforms(size_t N) const { return N == _size; }
+
+    protected:
+      // pointer to the data
+      const T *_data;
+      // number of elements
+      size_t _size;
+  };
+
+  // Leaf expression holding a scalar
+  template <class S>
+  class ScalarTerm: public BufferExpr< ScalarTerm<S> > {
+    public:
+      typedef S value_type;
+
+      // Constructor from value
+      ScalarTerm(const S &value) : _value(value) {}
+
+      // Element access (same value for every index)
+      inline S operator[] (size_t) const { return _value; }
+      // A scalar has no size
+      inline size_t size() const { return 0; }
+      // A scalar conforms to any size
+      inline bool conforms(size_t) const { return true; }
+
+    protected:
+      // value
+      S _value;
+  };
+
+  // Element-wise binary operation
+  template <class Op, class L, class R>
+  class BinaryExpr: public BufferExpr< BinaryExpr<Op, L, R> > {
+    public:
+      typedef decltype(Op::apply(std::declval<typename L::value_type>(),
+                                 std::declval<typename R::value_type>())) value_type;
+
+      // Constructor from operands
+      BinaryExpr(const L &lhs, const R &rhs) : _lhs(lhs), _rhs(rhs) {}
+
+      // Element access
+      inline value_type operator[] (size_t i) const { return Op::apply(_lhs[i], _rhs[i]); }
+      // Number of elements
+      inline size_t size() const { return _lhs.size() ? _lhs.size() : _rhs.size(); }
+      // Returns true if all operands can be evaluated into N elements
+      inline bool conforms(size_t N) const { return _lhs.conforms(N) && _rhs.conforms(N); }
+
+    protected:
+      // left hand side operand
+      L _lhs;
+      // right hand side operand
+      R _rhs;
+  };
+
+  // Element-wise unary operation
+  template <class Op, class A>
+  class UnaryExpr: public BufferExpr< UnaryExpr<Op, A> > {
+    public:
+      typedef decltype(Op::apply(std::declval<typename A::value_type>())) value_type;
+
+      // Constructor from operand
+      UnaryExpr(const A &arg) : _arg(arg) {}
+
+      // Element access
+      inline value_type operator[] (size_t i) const { return Op::apply(_arg[i]); }
+      // Number of elements
+      inline size_t size() const { return _arg.size(); }
+      // Returns true if the operand can be evaluated into N elements
+      inline bool conforms(size_t N) const { return _arg.conforms(N); }
+
+    protected:
+      // operand
+      A _arg;
+  };
+
+
+  namespace expr {
+    // Returns true for buffers and expressions
+    template <class X>
+    struct is_operand {
+      static const bool value = std::is_base_of<BufferExpr<X>, X>::value;
+    };
+    template <class T>
+    struct is_operand< Buffer<T> > { static const bool value = true; };
+
+    // Scalars take the (real) value type of the expression they are combined
+    // with, hence "buffer of complex<float> * 2.0" stays complex<float>.
+    // Integer expressions keep the promoted type of the scalar instead, e.g.
+    // "buffer of int16_t * 2.5" is evaluated in double and converted once on
+    // assignment. Complex integer expressions reject non-integral scalars.
+    template <class S, class V, bool integral=std::is_integral<V>::value>
+    struct scalar_cast { typedef V type; };
+    template <class S, class V>
+    struct scalar_cast< S, V, true > { typedef decltype(V()*S()) type; };
+    template <class S, class T>
+    struct scalar_cast< S, std::complex<T>, false > {
+      static_assert(std::is_integral<S>::value || (! std::is_integral<T>::value),
+                    "non-integral scalar combined with a complex integer expression");
+      typedef T type;
+    };
+    template <class S, class T>
+    struct scalar_cast< std::complex<S>, std::complex<T>, false > {
+      static_assert(std::is_integral<S>::value || (! std::is_integral<T>::value),
+                    "non-integral scalar combined with a complex integer expression");
+      typedef std::complex<T> type;
+    };
+    template <class S, class T, bool integral>
+    struct scalar_cast< std::complex<S>, T, integral > {
+      static_assert(std::is_integral<S>::value || (! integral),
+                    "non-integral complex scalar combined with an integer expression");
+      typedef std::complex<T> type;
+    };
+
+    // Maps an operand to its expression type
+    template <class X, class Other, bool isOperand=is_operand<X>::value>
+    struct term { typedef X type; static inline const X &make(const X &x) { return x; } };
+    template <class T, class Other>
+    struct term< Buffer<T>, Other, true > {
+      typedef BufferTerm<T> type;
+      static inline type make(const Buffer<T> &x) { return type(x); }
+    };
+    template <class S, class Other>
+    struct term< S, Other, false > {
+      typedef typename term<Other, S>::type other_type;
+      typedef ScalarTerm<typename scalar_cast<S, typename other_type::value_type>::type> type;
+      static inline type make(const S &x) { return type(typename type::value_type(x)); }
+    };
+
+    // Result type of a binary operation, defined only if at least one operand
+    // is a buffer or an expression
+    template <class Op, class L, class R,
+              bool enable=(is_operand<L>::value || is_operand<R>::value)>
+    struct binary {};
+    template <class Op, class L, class R>
+    struct binary<Op, L, R, true> {
+      typedef BinaryExpr<Op, typename term<L,R>::type, typename term<R,L>::type> type;
+    };
+
+    // Result type of a unary operation, defined only for buffers and expressions
+    template <class Op, class A, bool enable=is_operand<A>::value>
+    struct unary {};
+    template <class Op, class A>
+    struct unary<Op, A, true> {
+      typedef UnaryExpr<Op, typename term<A,A>::type> type;
+    };
+
+    template <class Op, class L, class R>
+    inline typename binary<Op,L,R>::type make_binary(const L &lhs, const R &rhs) {
+      return typename binary<Op,L,R>::type(term<L,R>::make(lhs), term<R,L>::make(rhs));
+    }
+  }
+
+
+  // OPERATORS
+  // Element-wise sum
+  template <class L, class R>
+  inline typename expr::binary<expr::Add,L,R>::type operator+ (const L &lhs, const R &rhs) {
+    return expr::make_binary<expr::Add>(lhs, rhs);
+  }
+
+  // Element-wise difference
+  template <class L, class R>
+  inline typename expr::binary<expr::Sub,L,R>::type operator- (const L &lhs, const R &rhs) {
+    return expr::make_binary<expr::Sub>(lhs, rhs);
+  }
+
+  // Element-wise product
+  template <class L, class R>
+  inline typename expr::binary<expr::Mul,L,R>::type operator* (const L &lhs, const R &rhs) {
+    return expr::make_binary<expr::Mul>(lhs, rhs);
+  }
+
+  // Element-wise division
+  template <class L, class R>
+  inline typename expr::binary<expr::Div,L,R>::type operator/ (const L &lhs, const R &rhs) {
+    return expr::make_binary<expr::Div>(lhs, rhs);
+  }
+
+  // Element-wise negation
+  template <class A>
+  inline typename expr::unary<expr::Neg,A>::type operator- (const A &arg) {
+    return typename expr::unary<expr::Neg,A>::type(expr::term<A,A>::make(arg));
+  }
+
+  // Element-wise complex conjugate
+  template <class A>
+  inline typename expr::unary<expr::Conj,A>::type conj(const A &arg) {
+    return typename expr::unary<expr::Conj,A>::type(expr::term<A,A>::make(arg));
+  }
+
+  // Element-wise absolute value
+  template <class A>
+  inline typename expr::unary<expr::Abs,A>::type abs(const A &arg) {
+    return typename expr::unary<expr::Abs,A>::type(expr::term<A,A>::make(arg));
+  }
+
+  // Element-wise real part
+  template <class A>
+  inline typename expr::unary<expr::Real,A>::type real(const A &arg) {
+    return typename expr::unary<expr::Real,A>::type(expr::term<A,A>::make(arg));
+  }
+
+  // Element-wise imaginary part
+  template <class A>
+  inline typename expr::unary<expr::Imag,A>::type imag(const A &arg) {
+    return typename expr::unary<expr::Imag,A>::type(expr::term<A,A>::make(arg));
+  }
+
+
+  // EVALUATION
+  // Evaluates the expression in a single pass into the given destination
+  // buffer or view. Returns false if the sizes of the operands do not match
+  // the size of the destination. The destination may be one of the operands.
+  template <class T, class E>
+  inline bool eval(const Buffer<T> &dest, const BufferExpr<E> &expression) {
+    const E &e = expression.self();
+    size_t N = dest.size();
+    if (! e.conforms(N)) { return false; }
+    T *out = reinterpret_cast<T *>(dest.data());
+    for (size_t i=0; i<N; i++)
+      out[i] = T(e[i]);
+    return true;
+  }
+
+  // Evaluates the expression into a newly allocated buffer
+  template <class E>
+  inline Buffer<typename E::value_type> eval(const BufferExpr<E> &expression) {
+    Buffer<typename E::value_type> result(expression.self().size());
+    eval(result, expression);
+    return result;
+  }
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "fft.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace sdr;
+
+// Constructor
+FFT::FFT(size_t N, bool inverse)
+  : _size(nextPow2(std::max(size_t(2), N))), _inverse(inverse), _twiddle(_size-1), _reverse(_size)
+{
+  // twiddles of the stage with butterfly span 2*half at offset half-1
+  double sign = inverse ? 1 : -1;
+  for (size_t half=1; half<_size; half<<=1) {
+    for (size_t k=0; k<half; k++) {
+      double phi = sign*M_PI*double(k)/half;
+      _twiddle[half-1+k] = std::complex<float>(std::cos(phi), std::sin(phi));
+    }
+  }
+  size_t bits = 0;
+  while ((size_t(1) << bits) < _size) { bits++; }
+  for (size_t i=0; i<_size; i++) {
+    uint32_t r = 0;
+    for (size_t b=0; b<bits; b++) { r |= ((i >> b) & 1) << (bits-1-b); }
+    _reverse[i] = r;
+  }
+}
+
+// Destructor
+FFT::~FFT() {}
+
+size_t FFT::nextPow2(size_t N) {
+  size_t M = 1;
+  while (M < N) { M <<= 1; }
+  return M;
+}
+
+bool FFT::execute(const Buffer< std::complex<float> > &in, const Buffer< std::complex<float> > &out) const {
+  if ((in.size() < _size) || (out.size() < _size)) { return false; }
+  const std::complex<float> *x = reinterpret_cast<const std::complex<float> *>(in.data());
+  float *y = reinterpret_cast<float *>(out.data());
+  // bit-reversal permutation (swap pairs if in place)
+  if (in.data() == out.data()) {
+    std::complex<float> *z = reinterpret_cast<std::complex<float> *>(out.data());
+    for (size_t i=0; i<_size; i++) {
+      if (i < _reverse[i]) { std::swap(z[i], z[_reverse[i]]); }
+    }
+  } else {
+    std::complex<float> *z = reinterpret_cast<std::complex<float> *>(out.data());
+    for (size_t i=0; i<_size; i++) { z[_reverse[i]] = x[i]; }
+  }
+  // first stage without multiplications
+  for (size_t i=0; i<2*_size; i+=4) {
+    float ar = y[i], ai = y[i+1], br = y[i+2], bi = y[i+3];
+    y[i] = ar+br; y[i+1] = ai+bi; y[i+2] = ar-br; y[i+3] = ai-bi;
+  }
+  // butterflies, real arithmetic on interleaved [re,im] pairs, the
+  // twiddles of a stage are contiguous
+  for (size_t half=2; half<_size; half<<=1) {
+    const float *w = reinterpret_cast<const float *>(&_twiddle[half-1]);
+    for (size_t start=0; start<_size; start+=2*half) {
+      float *a = y+2*start, *b = y+2*(start+half);
+      size_t k = 0;
+#ifdef __SSE2__
+      // two butterflies at a time (half is even), same operations as below
+      const __m128 sign = _mm_set_ps(1.f, -1.f, 1.f, -1.f);
+      for (; (k+2)<=half; k+=2) {
+        __m128 wv = _mm_loadu_ps(w+2*k), bv = _mm_loadu_ps(b+2*k), av = _mm_loadu_ps(a+2*k);
+        __m128 wr = _mm_shuffle_ps(wv, wv, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 wi = _mm_mul_ps(_mm_shuffle_ps(wv, wv, _MM_SHUFFLE(3, 3, 1, 1)), sign);
+        __m128 bs = _mm_shuffle_ps(bv, bv, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 t = _mm_add_ps(_mm_mul_ps(bv, wr), _mm_mul_ps(bs, wi));
+        _mm_storeu_ps(a+2*k, _mm_add_ps(av, t));
+        _mm_storeu_ps(b+2*k, _mm_sub_ps(av, t));
+      }
+#endif
+      for (; k<half; k++) {
+        float wr = w[2*k], wi = w[2*k+1];
+        float br = b[2*k]*wr - b[2*k+1]*wi, bi = b[2*k]*wi + b[2*k+1]*wr;
+        float ar = a[2*k], ai = a[2*k+1];
+        a[2*k] = ar+br; a[2*k+1] = ai+bi;
+        b[2*k] = ar-br; b[2*k+1] = ai-bi;
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,49 @@
+#ifndef __SDR_FFT_H__
+#define __SDR_FFT_H__
+
+#include "buffer.h"
+#include <vector>
+
+namespace sdr {
+
+  // In-place iterative radix-2 FFT of complex float samples.
+  //
+  // The twiddle factors and the bit-reversal permutation are computed once
+  // by the constructor, execute() does not allocate. The butterflies use
+  // SSE2 if available and plain C++ otherwise. The transform is not
+  // normalized, i.e. a forward transform followed by an inverse transform
+  // scales the input by N.
+  class FFT {
+    public:
+      // Constructor with size N (a power of two) and direction
+      FFT(size_t N, bool inverse=false);
+
+      // Destructor
+      virtual ~FFT();
+
+      // Returns the size of the transform
+      inline size_t size() const { return _size; }
+      // Returns true for the inverse transform
+      inline bool inverse() const { return _inverse; }
+
+      // Transforms in into out (may be the same buffer). Returns false if in
+      // or out are smaller than the transform.
+      bool execute(const Buffer< std::complex<float> > &in, const Buffer< std::complex<float> > &out) const;
+
+      // Returns the smallest power of two >= N
+      static size_t nextPow2(size_t N);
+
+    protected:
+      // size of the transform
+      size_t _size;
+      // direction
+      bool _inverse;
+      // twiddle factors exp(-+pi*i*k/half) of all stages, stage by stage
+      std::vector< std::complex<float> > _twiddle;
+      // bit-reversal permutation
+      std::vector<uint32_t> _reverse;
+  };
+
+}
+
+#endif
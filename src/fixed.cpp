@@ -0,0 +1,278 @@
+#include "fixed.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace sdr;
+
+// Scaling
+bool sdr::scale(const Buffer<cint16> &in, const Buffer<cint16> &out, int16_t gain) {
+  if (out.size() < in.size()) { return false; }
+  const int16_t *x = reinterpret_cast<const int16_t *>(in.data());
+  int16_t *y = reinterpret_cast<int16_t *>(out.data());
+  size_t N = 2*in.size(), i = 0;
+#ifdef __SSE2__
+  // (x*gain + 2^14) >> 15 via the high and low halves of the 32-bit product
+  __m128i g = _mm_set1_epi16(gain), r = _mm_set1_epi32(1<<14);
+  for (; (i+8)<=N; i+=8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(x+i));
+    __m128i lo = _mm_mullo_epi16(v, g), hi = _mm_mulhi_epi16(v, g);
+    __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), r), 15);
+    __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), r), 15);
+    _mm_storeu_si128((__m128i *)(y+i), _mm_packs_epi32(p0, p1));
+  }
+#endif
+  for (; i<N; i++) { y[i] = roundQ15(int32_t(x[i])*gain); }
+  return true;
+}
+
+// Magnitude
+bool sdr::magnitude(const Buffer<cint16> &in, const Buffer<int16_t> &out) {
+  if (out.size() < in.size()) { return false; }
+  const int16_t *x = reinterpret_cast<const int16_t *>(in.data());
+  int16_t *y = reinterpret_cast<int16_t *>(out.data());
+  size_t N = in.size(), i = 0;
+#ifdef __SSE2__
+  // pmaddwd of a sample with itself gives I^2+Q^2, which only overflows
+  // (wraps to negative) for I=Q=-32768
+  __m128 wrap = _mm_set1_ps(4294967296.f);
+  for (; (i+8)<=N; i+=8) {
+    __m128i v0 = _mm_loadu_si128((const __m128i *)(x+2*i));
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(x+2*i+8));
+    __m128 p0 = _mm_cvtepi32_ps(_mm_madd_epi16(v0, v0));
+    __m128 p1 = _mm_cvtepi32_ps(_mm_madd_epi16(v1, v1));
+    p0 = _mm_add_ps(p0, _mm_and_ps(_mm_cmplt_ps(p0, _mm_setzero_ps()), wrap));
+    p1 = _mm_add_ps(p1, _mm_and_ps(_mm_cmplt_ps(p1, _mm_setzero_ps()), wrap));
+    __m128i m0 = _mm_cvtps_epi32(_mm_sqrt_ps(p0)), m1 = _mm_cvtps_epi32(_mm_sqrt_ps(p1));
+    _mm_storeu_si128((__m128i *)(y+i), _mm_packs_epi32(m0, m1));
+  }
+#endif
+  // same rounding as the SSE path: float power and root, rounded to even
+  for (; i<N; i++) {
+    float p = float(uint32_t(int32_t(x[2*i])*x[2*i]) + uint32_t(int32_t(x[2*i+1])*x[2*i+1]));
+    y[i] = saturate16(int32_t(std::lrint(std::sqrt(p))));
+  }
+  return true;
+}
+
+// Power
+bool sdr::power(const Buffer<cint16> &in, const Buffer<uint32_t> &out) {
+  if (out.size() < in.size()) { return false; }
+  const int16_t *x = reinterpret_cast<const int16_t *>(in.data());
+  uint32_t *y = reinterpret_cast<uint32_t *>(out.data());
+  size_t N = in.size(), i = 0;
+#ifdef __SSE2__
+  // unsigned reinterpretation of pmaddwd is exact (max 2^31)
+  for (; (i+4)<=N; i+=4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(x+2*i));
+    _mm_storeu_si128((__m128i *)(y+i), _mm_madd_epi16(v, v));
+  }
+#endif
+  for (; i<N; i++) {
+    y[i] = uint32_t(int32_t(x[2*i])*x[2*i]) + uint32_t(int32_t(x[2*i+1])*x[2*i+1]);
+  }
+  return true;
+}
+
+// Conversion
+bool sdr::toFloat(const Buffer<cint16> &in, const Buffer< std::complex<float> > &out, float scale) {
+  if (out.size() < in.size()) { return false; }
+  const int16_t *x = reinterpret_cast<const int16_t *>(in.data());
+  float *y = reinterpret_cast<float *>(out.data());
+  size_t N = 2*in.size();
+  for (size_t i=0; i<N; i++) { y[i] = scale*x[i]; }
+  return true;
+}
+
+bool sdr::fromFloat(const Buffer< std::complex<float> > &in, const Buffer<cint16> &out, float scale) {
+  if (out.size() < in.size()) { return false; }
+  const float *x = reinterpret_cast<const float *>(in.data());
+  int16_t *y = reinterpret_cast<int16_t *>(out.data());
+  size_t N = 2*in.size();
+  for (size_t i=0; i<N; i++) {
+    float v = std::floor(scale*x[i]+0.5f);
+    y[i] = int16_t((v > 32767.f) ? 32767.f : ((v < -32768.f) ? -32768.f : v));
+  }
+  return true;
+}
+
+
+// Mixer
+// Constructor
+FixedMixer::FixedMixer(double frequency, int16_t gain)
+  : _table(size_t(1) << TABLE_BITS), _phase(0), _increment(0), _osc()
+{
+  for (size_t i=0; i<_table.size(); i++) {
+    double phi = 2*M_PI*double(i)/_table.size();
+    _table[i] = cint16(toQ15(std::cos(phi)*gain/32768.), toQ15(std::sin(phi)*gain/32768.));
+  }
+  setFrequency(frequency);
+}
+
+// Copy constructor
+FixedMixer::FixedMixer(const FixedMixer &other)
+  : _table(other._table), _phase(other._phase), _increment(other._increment), _osc()
+{}
+
+// Destructor
+FixedMixer::~FixedMixer() {}
+
+FixedMixer &FixedMixer::operator = (const FixedMixer &other) {
+  _table = other._table;
+  _phase = other._phase;
+  _increment = other._increment;
+  _osc = Buffer<cint16>();
+  return *this;
+}
+
+void FixedMixer::setFrequency(double frequency) {
+  _increment = uint32_t(int64_t(std::floor(frequency*4294967296.+0.5)));
+}
+
+bool FixedMixer::process(const Buffer<cint16> &in, const Buffer<cint16> &out) {
+  if (out.size() < in.size()) { return false; }
+  size_t N = in.size();
+  if (_osc.size() < N) { _osc = Buffer<cint16>(N); }
+  // oscillator values from the table
+  for (size_t i=0; i<N; i++, _phase += _increment) {
+    _osc[i] = _table[_phase >> (32-TABLE_BITS)];
+  }
+  const int16_t *x = reinterpret_cast<const int16_t *>(in.data());
+  const int16_t *o = reinterpret_cast<const int16_t *>(_osc.data());
+  int16_t *y = reinterpret_cast<int16_t *>(out.data());
+  size_t i = 0;
+#ifdef __SSE2__
+  // (a+jb)(c+jd): real part = pmaddwd([a,b],[c,-d]), imag = pmaddwd([a,b],[d,c])
+  __m128i r = _mm_set1_epi32(1<<14), odd = _mm_set_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+  for (; (i+4)<=N; i+=4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(x+2*i));
+    __m128i c = _mm_loadu_si128((const __m128i *)(o+2*i));
+    // [c,-d] by saturating negation of the odd lanes, [d,c] by swapping pairs
+    __m128i neg = _mm_subs_epi16(_mm_setzero_si128(), c);
+    __m128i cr = _mm_or_si128(_mm_and_si128(odd, neg), _mm_andnot_si128(odd, c));
+    __m128i ci = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1));
+    __m128i re = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(v, cr), r), 15);
+    __m128i im = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(v, ci), r), 15);
+    _mm_storeu_si128((__m128i *)(y+2*i),
+                     _mm_packs_epi32(_mm_unpacklo_epi32(re, im), _mm_unpackhi_epi32(re, im)));
+  }
+#endif
+  for (; i<N; i++) {
+    int32_t a = x[2*i], b = x[2*i+1], c = o[2*i], d = o[2*i+1];
+    y[2*i]   = roundQ15(a*c - b*d);
+    y[2*i+1] = roundQ15(a*d + b*c);
+  }
+  return true;
+}
+
+
+// FIR filter
+// Constructor
+FixedFIR::FixedFIR(const std::vector<float> &taps, size_t decimation)
+  : _ntaps(std::max(size_t(1), taps.size())), _npadded(4*((_ntaps+3)/4)), _decimation(std::max(size_t(1), decimation)),
+    _skip(0), _wide(false), _taps(2*_npadded), _work()
+{
+  // reversed taps r[j] = h[npadded-1-j] (zero padded at the oldest end),
+  // expanded per group of 4 as [r0,r1,r0,r1,r2,r3,r2,r3] to match the
+  // shuffled sample layout [I0,I1,Q0,Q1,I2,I3,Q2,Q3]
+  std::vector<int16_t> rev(_npadded, 0);
+  int64_t sum = 0;
+  for (size_t j=0; j<taps.size(); j++) {
+    rev[_npadded-1-j] = toQ15(taps[j]);
+    sum += std::abs(int32_t(rev[_npadded-1-j]));
+  }
+  // |acc| <= 32768*sum, plus the rounding offset, must fit into int32
+  _wide = ((sum*32768 + (1<<14)) > INT32_MAX);
+  for (size_t j=0; j<_npadded; j+=4) {
+    int16_t *t = &_taps[2*j];
+    t[0] = rev[j];   t[1] = rev[j+1]; t[2] = rev[j];   t[3] = rev[j+1];
+    t[4] = rev[j+2]; t[5] = rev[j+3]; t[6] = rev[j+2]; t[7] = rev[j+3];
+  }
+  reset();
+}
+
+// Copy constructor
+FixedFIR::FixedFIR(const FixedFIR &other)
+  : _ntaps(other._ntaps), _npadded(other._npadded), _decimation(other._decimation),
+    _skip(other._skip), _wide(other._wide), _taps(other._taps), _work(other.copyHistory(other._npadded-1))
+{}
+
+// Destructor
+FixedFIR::~FixedFIR() {}
+
+FixedFIR &FixedFIR::operator = (const FixedFIR &other) {
+  if (this == &other) { return *this; }
+  _ntaps = other._ntaps; _npadded = other._npadded; _decimation = other._decimation;
+  _skip = other._skip; _wide = other._wide; _taps = other._taps;
+  _work = other.copyHistory(other._npadded-1);
+  return *this;
+}
+
+Buffer<cint16> FixedFIR::copyHistory(size_t N) const {
+  Buffer<cint16> work(N);
+  std::memcpy(work.data(), _work.data(), N*sizeof(cint16));
+  return work;
+}
+
+void FixedFIR::reset() {
+  _skip = 0;
+  _work = Buffer<cint16>(_npadded-1);
+  for (size_t i=0; i<_work.size(); i++) { _work[i] = cint16(0, 0); }
+}
+
+size_t FixedFIR::process(const Buffer<cint16> &in, const Buffer<cint16> &out) {
+  size_t N = in.size(), H = _npadded-1;
+  if (out.size() < maxOutputs(N)) { return 0; }
+  // append block to history
+  if (_work.size() < (H+N)) {
+    Buffer<cint16> work(H+N);
+    std::memcpy(work.data(), _work.data(), H*sizeof(cint16));
+    _work = std::move(work);
+  }
+  std::memcpy(_work.data()+H*sizeof(cint16), in.data(), N*sizeof(cint16));
+
+  const int16_t *x = reinterpret_cast<const int16_t *>(_work.data());
+  int16_t *y = reinterpret_cast<int16_t *>(out.data());
+  size_t count = 0, n = _skip;
+  for (; n<N; n+=_decimation, count++) {
+    // window of npadded samples ending at the current input sample
+    const int16_t *w = x+2*n;
+    if (_wide) {
+      // 64-bit accumulation, saturated on output
+      int64_t wideI = 0, wideQ = 0;
+      for (size_t j=0; j<_npadded; j+=2) {
+        const int16_t *t = &_taps[2*(j & ~size_t(3)) + 4*((j/2)%2)];
+        wideI += int64_t(w[2*j])*t[0] + int64_t(w[2*j+2])*t[1];
+        wideQ += int64_t(w[2*j+1])*t[0] + int64_t(w[2*j+3])*t[1];
+      }
+      wideI = (wideI + (1<<14)) >> 15; wideQ = (wideQ + (1<<14)) >> 15;
+      y[2*count] = int16_t(std::max(int64_t(-32768), std::min(int64_t(32767), wideI)));
+      y[2*count+1] = int16_t(std::max(int64_t(-32768), std::min(int64_t(32767), wideQ)));
+      continue;
+    }
+    int32_t accI = 0, accQ = 0;
+    size_t j = 0;
+#ifdef __SSE2__
+    __m128i acc = _mm_setzero_si128();
+    for (; j<_npadded; j+=4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(w+2*j));
+      v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3,1,2,0)), _MM_SHUFFLE(3,1,2,0));
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(v, _mm_loadu_si128((const __m128i *)(&_taps[2*j]))));
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    accI = lanes[0]+lanes[2]; accQ = lanes[1]+lanes[3];
+#endif
+    for (; j<_npadded; j+=2) {
+      const int16_t *t = &_taps[2*(j & ~size_t(3)) + 4*((j/2)%2)];
+      accI += int32_t(w[2*j])*t[0] + int32_t(w[2*j+2])*t[1];
+      accQ += int32_t(w[2*j+1])*t[0] + int32_t(w[2*j+3])*t[1];
+    }
+    y[2*count] = roundQ15(accI);
+    y[2*count+1] = roundQ15(accQ);
+  }
+  _skip = n-N;
+  // keep history
+  std::memmove(_work.data(), _work.data()+N*sizeof(cint16), H*sizeof(cint16));
+  return count;
+}
@@ -0,0 +1,161 @@
+#ifndef __SDR_FIXED_H__
+#define __SDR_FIXED_H__
+
+#include "buffer.h"
+#include <vector>
+
+namespace sdr {
+
+  // Fixed-point processing of complex int16 samples.
+  //
+  // Samples stay in std::complex<int16_t> through the chain, halving the
+  // memory traffic compared to complex<float>. Coefficients (taps, oscillator
+  // values, gains) are in Q15 format, i.e. the integer value divided by 2^15.
+  // All results are rounded and saturated to the int16 range. The kernels use
+  // SSE2 (pmaddwd) if available and plain C++ otherwise. Conversion to float
+  // is only needed at the end of the chain (toFloat()).
+
+  // complex int16 sample
+  typedef std::complex<int16_t> cint16;
+
+  // Saturates a 32-bit value to the int16 range
+  inline int16_t saturate16(int32_t x) {
+    return int16_t((x > 32767) ? 32767 : ((x < -32768) ? -32768 : x));
+  }
+
+  // Converts a floating point value to Q15 (rounded and saturated)
+  inline int16_t toQ15(double x) {
+    return saturate16(int32_t(std::floor(x*32768.+0.5)));
+  }
+
+  // Rounds and scales a Q15 product sum back to int16 (saturated)
+  inline int16_t roundQ15(int32_t acc) {
+    return saturate16((acc + (1<<14)) >> 15);
+  }
+
+  // Multiplies every sample with the Q15 gain (saturated). in and out may be
+  // the same buffer. Returns false if out is smaller than in.
+  bool scale(const Buffer<cint16> &in, const Buffer<cint16> &out, int16_t gain);
+
+  // Computes the magnitude |x| of every sample (saturated to 32767).
+  // Returns false if out is smaller than in.
+  bool magnitude(const Buffer<cint16> &in, const Buffer<int16_t> &out);
+
+  // Computes the power I^2+Q^2 of every sample. Returns false if out is
+  // smaller than in.
+  bool power(const Buffer<cint16> &in, const Buffer<uint32_t> &out);
+
+  // Converts to complex float, multiplying by the given scale (default: full
+  // scale maps to 1). Returns false if out is smaller than in.
+  bool toFloat(const Buffer<cint16> &in, const Buffer< std::complex<float> > &out,
+               float scale=1./32768);
+
+  // Converts from complex float, multiplying by the given scale (default: 1
+  // maps to full scale), rounded and saturated. Returns false if out is
+  // smaller than in.
+  bool fromFloat(const Buffer< std::complex<float> > &in, const Buffer<cint16> &out,
+                 float scale=32768);
+
+
+  // Mixes a complex int16 stream with a table-driven Q15 oscillator
+  // (frequency shift), the phase continues across blocks.
+  class FixedMixer {
+    public:
+      // Constructor with frequency shift relative to the sample rate
+      // (-0.5 to 0.5) and optional Q15 gain applied with the oscillator
+      FixedMixer(double frequency, int16_t gain=32767);
+
+      // Copy constructor, the copy continues at the same phase with its own
+      // scratch buffer
+      FixedMixer(const FixedMixer &other);
+
+      // Destructor
+      virtual ~FixedMixer();
+
+      // Assignment operator (see copy constructor)
+      FixedMixer &operator = (const FixedMixer &other);
+
+      // Sets the frequency shift (relative to the sample rate)
+      void setFrequency(double frequency);
+
+      // Mixes in into out (may be the same buffer), returns false if out is
+      // smaller than in
+      bool process(const Buffer<cint16> &in, const Buffer<cint16> &out);
+
+    protected:
+      // number of bits of the oscillator table index
+      static const int TABLE_BITS = 12;
+      // oscillator table (Q15)
+      std::vector<cint16> _table;
+      // phase accumulator (full circle = 2^32)
+      uint32_t _phase;
+      // phase increment per sample
+      uint32_t _increment;
+      // oscillator values of the current block (scratch, not shared by copies)
+      Buffer<cint16> _osc;
+  };
+
+
+  // FIR filter with real Q15 taps and optional decimation on complex int16
+  // samples. The filter history and decimation phase carry across blocks.
+  // The outputs are saturated. If the sum of the absolute tap values
+  // exceeds 2, the 32-bit accumulator of the pmaddwd kernel could overflow,
+  // such filters accumulate in 64 bits instead (plain C++, slower). With a
+  // sum of at most 1 the outputs never saturate.
+  class FixedFIR {
+    public:
+      // Constructor with (floating point) taps and decimation factor, no
+      // taps give a single zero tap
+      FixedFIR(const std::vector<float> &taps, size_t decimation=1);
+
+      // Copy constructor, the copy continues with a copy of the history
+      FixedFIR(const FixedFIR &other);
+
+      // Destructor
+      virtual ~FixedFIR();
+
+      // Assignment operator (see copy constructor)
+      FixedFIR &operator = (const FixedFIR &other);
+
+      // Returns the number of taps
+      inline size_t numTaps() const { return _ntaps; }
+      // Returns the decimation factor
+      inline size_t decimation() const { return _decimation; }
+      // Returns the maximum number of outputs for an input block of N samples
+      inline size_t maxOutputs(size_t N) const { return N/_decimation + 1; }
+      // Returns true if the filter accumulates in 64 bits (see above)
+      inline bool wide() const { return _wide; }
+
+      // Filters (and decimates) the input block, returns the number of
+      // samples written into out or 0 if out may be too small
+      // (see maxOutputs()).
+      size_t process(const Buffer<cint16> &in, const Buffer<cint16> &out);
+
+      // Clears the filter history
+      void reset();
+
+    protected:
+      // number of taps
+      size_t _ntaps;
+      // number of taps padded to a multiple of 4
+      size_t _npadded;
+      // decimation factor
+      size_t _decimation;
+      // samples to skip until the next output
+      size_t _skip;
+      // true if the 32-bit accumulator could overflow
+      bool _wide;
+      // reversed Q15 taps, expanded for the pmaddwd kernel
+      std::vector<int16_t> _taps;
+      // history (npadded-1 samples) followed by the current block (not
+      // shared by copies)
+      Buffer<cint16> _work;
+
+    protected:
+      // returns a deep copy of the first N samples of the work buffer
+      Buffer<cint16> copyHistory(size_t N) const;
+  };
+
+}
+
+#endif
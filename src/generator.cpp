@@ -0,0 +1,341 @@
+#include "generator.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace sdr;
+
+// standard deviation of the sum of four uniform bytes
+static const float BYTE_SUM_SIGMA = std::sqrt(4*(256.f*256.f-1)/12);
+
+// converts cycles (per sample) to fixed point, the full circle is 2^64
+static uint64_t toFixed(double cycles) {
+  double d = (cycles - std::floor(cycles + 0.5))*18446744073709551616.;
+  if (d >= 9223372036854775808.) { d -= 18446744073709551616.; }
+  return uint64_t(int64_t(d));
+}
+
+// converts fixed point to cycles in [-0.5, 0.5)
+static double toCycles(uint64_t fixed) {
+  return double(int64_t(fixed))/18446744073709551616.;
+}
+
+#ifdef __SSE2__
+// 32-bit multiplication (low half) of four lanes
+static inline __m128i mullo(__m128i a, __m128i b) {
+#ifdef __SSE4_1__
+  return _mm_mullo_epi32(a, b);
+#else
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+#endif
+}
+
+// CounterRNG::hash() of four lanes
+static inline __m128i hash4(__m128i x) {
+  const __m128i m1 = _mm_set1_epi32(0x7feb352d), m2 = _mm_set1_epi32(int32_t(0x846ca68bU));
+  x = mullo(_mm_xor_si128(x, _mm_srli_epi32(x, 16)), m1);
+  x = mullo(_mm_xor_si128(x, _mm_srli_epi32(x, 15)), m2);
+  return _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+}
+#endif
+
+#ifdef __AVX2__
+// CounterRNG::hash() of eight lanes
+static inline __m256i hash8(__m256i x) {
+  const __m256i m1 = _mm256_set1_epi32(0x7feb352d), m2 = _mm256_set1_epi32(int32_t(0x846ca68bU));
+  x = _mm256_mullo_epi32(_mm256_xor_si256(x, _mm256_srli_epi32(x, 16)), m1);
+  x = _mm256_mullo_epi32(_mm256_xor_si256(x, _mm256_srli_epi32(x, 15)), m2);
+  return _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+}
+#endif
+
+// Calls kernel(counter, N, key) for the runs of 2^32 words within N words
+// from n, counter is the low half of the first word
+template <class Kernel>
+static void forEachRun(const CounterRNG &rng, uint64_t n, size_t N, Kernel kernel) {
+  while (N) {
+    uint32_t lo = uint32_t(n);
+    size_t M = size_t(std::min(uint64_t(N), (uint64_t(1) << 32) - lo));
+    kernel(lo, M, rng.key(uint32_t(n >> 32)));
+    n += M; N -= M;
+  }
+}
+
+// words n, n+1, ...
+static void randomWords(const CounterRNG &rng, uint64_t n, uint32_t *y, size_t N) {
+  forEachRun(rng, n, N, [&y](uint32_t lo, size_t M, CounterRNG::Key k) {
+    uint32_t x = lo*k.mul + k.add;
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i v = _mm_set_epi32(int32_t(x+3*k.mul), int32_t(x+2*k.mul), int32_t(x+k.mul), int32_t(x));
+    __m128i step = _mm_set1_epi32(int32_t(4*k.mul));
+    for (; (i+4)<=M; i+=4, x+=4*k.mul) {
+      _mm_storeu_si128((__m128i *)(y+i), hash4(v));
+      v = _mm_add_epi32(v, step);
+    }
+#endif
+    for (; i<M; i++, x+=k.mul) { y[i] = CounterRNG::hash(x); }
+    y += M;
+  });
+}
+
+// Gaussian values of words n, n+1, ...
+static void gaussianWords(const CounterRNG &rng, uint64_t n, float *y, size_t N, float sigma) {
+  const float scale = sigma/BYTE_SUM_SIGMA;
+  forEachRun(rng, n, N, [&y, scale](uint32_t lo, size_t M, CounterRNG::Key k) {
+    uint32_t x = lo*k.mul + k.add;
+    size_t i = 0;
+#ifdef __AVX2__
+    {
+      __m256i v = _mm256_add_epi32(_mm256_set1_epi32(int32_t(x)),
+                                   _mm256_mullo_epi32(_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_epi32(int32_t(k.mul))));
+      __m256i step = _mm256_set1_epi32(int32_t(8*k.mul));
+      __m256i bytes = _mm256_set1_epi32(0x00ff00ff), low = _mm256_set1_epi32(0xffff), mean = _mm256_set1_epi32(510);
+      __m256 s = _mm256_set1_ps(scale);
+      for (; (i+8)<=M; i+=8, x+=8*k.mul) {
+        __m256i h = hash8(v);
+        __m256i b = _mm256_add_epi32(_mm256_and_si256(h, bytes), _mm256_and_si256(_mm256_srli_epi32(h, 8), bytes));
+        __m256i t = _mm256_sub_epi32(_mm256_add_epi32(_mm256_and_si256(b, low), _mm256_srli_epi32(b, 16)), mean);
+        _mm256_storeu_ps(y+i, _mm256_mul_ps(_mm256_cvtepi32_ps(t), s));
+        v = _mm256_add_epi32(v, step);
+      }
+    }
+#endif
+#ifdef __SSE2__
+    __m128i v = _mm_set_epi32(int32_t(x+3*k.mul), int32_t(x+2*k.mul), int32_t(x+k.mul), int32_t(x));
+    __m128i step = _mm_set1_epi32(int32_t(4*k.mul));
+    __m128i bytes = _mm_set1_epi32(0x00ff00ff), low = _mm_set1_epi32(0xffff), mean = _mm_set1_epi32(510);
+    __m128 s = _mm_set1_ps(scale);
+    for (; (i+4)<=M; i+=4, x+=4*k.mul) {
+      __m128i h = hash4(v);
+      // pairwise byte sums in the 16-bit halves, then the sum of the halves
+      __m128i b = _mm_add_epi32(_mm_and_si128(h, bytes), _mm_and_si128(_mm_srli_epi32(h, 8), bytes));
+      __m128i t = _mm_sub_epi32(_mm_add_epi32(_mm_and_si128(b, low), _mm_srli_epi32(b, 16)), mean);
+      _mm_storeu_ps(y+i, _mm_mul_ps(_mm_cvtepi32_ps(t), s));
+      v = _mm_add_epi32(v, step);
+    }
+#endif
+    for (; i<M; i++, x+=k.mul) {
+      uint32_t h = CounterRNG::hash(x);
+      uint32_t b = (h & 0x00ff00ff) + ((h >> 8) & 0x00ff00ff);
+      y[i] = float(int32_t((b & 0xffff) + (b >> 16)) - 510)*scale;
+    }
+    y += M;
+  });
+}
+
+// Adds start times the rotations to N complex samples (interleaved)
+static void rotate(float *y, size_t N, std::complex<float> start, const std::complex<float> *rotation) {
+  const float *r = reinterpret_cast<const float *>(rotation);
+  size_t i = 0;
+#ifdef __SSE2__
+  // (a+jb)(c+jd) = [a*c - b*d, a*d + b*c]: a*[c,d] + (b*[d,c] with the real part negated)
+  __m128 a = _mm_set1_ps(start.real()), b = _mm_set1_ps(start.imag());
+  __m128 neg = _mm_set_ps(0.f, -0.f, 0.f, -0.f);
+  for (; (i+2)<=N; i+=2) {
+    __m128 c = _mm_loadu_ps(r+2*i);
+    __m128 d = _mm_shuffle_ps(c, c, _MM_SHUFFLE(2,3,0,1));
+    __m128 t = _mm_add_ps(_mm_mul_ps(a, c), _mm_xor_ps(_mm_mul_ps(b, d), neg));
+    _mm_storeu_ps(y+2*i, _mm_add_ps(_mm_loadu_ps(y+2*i), t));
+  }
+  // the last sample on the same path, keeping the results independent of the block split
+  if (i < N) {
+    __m128 c = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(r+2*i));
+    __m128 d = _mm_shuffle_ps(c, c, _MM_SHUFFLE(2,3,0,1));
+    __m128 t = _mm_add_ps(_mm_mul_ps(a, c), _mm_xor_ps(_mm_mul_ps(b, d), neg));
+    _mm_storel_pi((__m64 *)(y+2*i), _mm_add_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(y+2*i)), t));
+  }
+#else
+  float a = start.real(), b = start.imag();
+  for (; i<N; i++) {
+    y[2*i]   += a*r[2*i] - b*r[2*i+1];
+    y[2*i+1] += a*r[2*i+1] + b*r[2*i];
+  }
+#endif
+}
+
+// Converts N floats to int16, multiplied by scale, rounded (to even) and saturated
+static void toInt16(const float *x, int16_t *y, size_t N, float scale) {
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128 s = _mm_set1_ps(scale), lo = _mm_set1_ps(-32768.f), hi = _mm_set1_ps(32767.f);
+  for (; (i+8)<=N; i+=8) {
+    __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(x+i), s), lo), hi);
+    __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(x+i+4), s), lo), hi);
+    _mm_storeu_si128((__m128i *)(y+i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+  }
+#endif
+  for (; i<N; i++) {
+    float v = std::min(std::max(x[i]*scale, -32768.f), 32767.f);
+    y[i] = int16_t(std::lrint(v));
+  }
+}
+
+
+// Random numbers
+void CounterRNG::fill(uint64_t n, const Buffer<uint32_t> &out) const {
+  randomWords(*this, n, reinterpret_cast<uint32_t *>(out.data()), out.size());
+}
+
+void CounterRNG::gaussian(uint64_t n, const Buffer<float> &out, float sigma) const {
+  gaussianWords(*this, n, reinterpret_cast<float *>(out.data()), out.size(), sigma);
+}
+
+
+// Generator
+// Constructor
+SignalGenerator::SignalGenerator(uint64_t seed)
+  : _rng(seed), _components(), _coarse(size_t(1) << TABLE_BITS), _fine(size_t(1) << TABLE_BITS),
+    _noise(0), _relative(false), _position(0)
+{
+  // the fine table covers one step of the coarse table
+  for (size_t i=0; i<_coarse.size(); i++) {
+    double phi = 2*M_PI*double(i)/_coarse.size();
+    _coarse[i] = std::complex<float>(std::cos(phi), std::sin(phi));
+    phi /= _fine.size();
+    _fine[i] = std::complex<float>(std::cos(phi), std::sin(phi));
+  }
+}
+
+// Destructor
+SignalGenerator::~SignalGenerator() {}
+
+double SignalGenerator::signalPower() const {
+  double power = 0;
+  for (size_t i=0; i<_components.size(); i++) { power += _components[i].amplitude*_components[i].amplitude; }
+  return power;
+}
+
+double SignalGenerator::noisePower() const {
+  return _relative ? signalPower()/std::pow(10., _noise/10) : _noise;
+}
+
+void SignalGenerator::addTone(double frequency, double amplitude, double phase) {
+  Component c;
+  c.type = TONE; c.amplitude = amplitude; c.phase = toFixed(phase/(2*M_PI));
+  c.increment = toFixed(frequency); c.rate = 0; c.period = 1; c.bits = 0;
+  double w = 2*M_PI*toCycles(c.increment);
+  for (size_t k=0; k<SEGMENT; k++) {
+    c.rotation.push_back(std::complex<float>(amplitude*std::cos(w*k), amplitude*std::sin(w*k)));
+  }
+  _components.push_back(c);
+}
+
+void SignalGenerator::addChirp(double f0, double f1, size_t period, double amplitude) {
+  Component c;
+  c.type = CHIRP; c.amplitude = amplitude; c.phase = 0;
+  c.period = std::max(size_t(1), period);
+  c.increment = toFixed(f0); c.rate = toFixed((f1-f0)/c.period); c.bits = 0;
+  _components.push_back(c);
+}
+
+void SignalGenerator::addCarrier(double frequency, size_t samplesPerSymbol, int bits, double amplitude) {
+  addTone(frequency, amplitude);
+  Component &c = _components.back();
+  c.type = CARRIER;
+  c.period = std::max(size_t(1), samplesPerSymbol);
+  c.bits = std::min(4, std::max(1, bits));
+  // an independent symbol stream per carrier
+  c.symbols = CounterRNG(_rng.seed() ^ (uint64_t(_components.size()) << 56));
+}
+
+void SignalGenerator::setSNR(double snr) {
+  _noise = snr; _relative = true;
+}
+
+void SignalGenerator::setNoise(double power) {
+  _noise = std::max(0., power); _relative = false;
+}
+
+void SignalGenerator::clear() {
+  _components.clear();
+  setNoise(0);
+}
+
+uint64_t SignalGenerator::phaseAt(const Component &c, uint64_t n) const {
+  if (CHIRP != c.type) { return c.phase + n*c.increment; }
+  // whole sweeps, then the partial sweep
+  uint64_t q = n/c.period, m = n%c.period;
+  uint64_t sweep = c.period*c.increment + c.rate*(c.period*(c.period-1)/2);
+  return c.phase + q*sweep + m*c.increment + c.rate*(m*(m-1)/2);
+}
+
+void SignalGenerator::addRotating(const Component &c, float *out, size_t N, uint64_t position) const {
+  // symbols: current index and end, the symbol key is cached per run of 2^32
+  const bool carrier = (CARRIER == c.type);
+  uint64_t symbol = carrier ? position/c.period : 0, symbolEnd = (symbol+1)*c.period;
+  CounterRNG::Key key = c.symbols.key(uint32_t(symbol >> 32));
+  for (size_t i=0; i<N;) {
+    // segments start at multiples of SEGMENT and at symbol boundaries
+    uint64_t n = position+i, start = n & ~uint64_t(SEGMENT-1), end = start + SEGMENT;
+    uint64_t symbolPhase = 0;
+    if (carrier) {
+      if (n == symbolEnd) {
+        symbol++; symbolEnd += c.period;
+        if (0 == uint32_t(symbol)) { key = c.symbols.key(uint32_t(symbol >> 32)); }
+      }
+      start = std::max(start, symbolEnd - c.period);
+      end = std::min(end, symbolEnd);
+      uint32_t word = CounterRNG::hash(uint32_t(symbol)*key.mul + key.add);
+      symbolPhase = uint64_t(word >> (32-c.bits)) << (64-c.bits);
+    }
+    size_t M = size_t(std::min(end-n, uint64_t(N-i)));
+    rotate(out+2*i, M, oscillator(phaseAt(c, start) + symbolPhase), &c.rotation[n-start]);
+    i += M;
+  }
+}
+
+void SignalGenerator::addSweep(const Component &c, float *out, size_t N, uint64_t position) const {
+  uint64_t phase = phaseAt(c, position), m = position%c.period, increment = c.increment + m*c.rate;
+  float a = float(c.amplitude);
+  for (size_t i=0; i<N; i++) {
+    std::complex<float> v = oscillator(phase);
+    out[2*i] += a*v.real();
+    out[2*i+1] += a*v.imag();
+    phase += increment; increment += c.rate;
+    if (++m == c.period) { m = 0; increment = c.increment; }
+  }
+}
+
+void SignalGenerator::render(float *out, size_t N, uint64_t position) const {
+  double noise = noisePower();
+  if (0 < noise) { gaussianWords(_rng, 2*position, out, 2*N, float(std::sqrt(noise/2))); }
+  else { std::memset(out, 0, 2*N*sizeof(float)); }
+  for (size_t j=0; j<_components.size(); j++) {
+    const Component &c = _components[j];
+    if (CHIRP == c.type) { addSweep(c, out, N, position); }
+    else { addRotating(c, out, N, position); }
+  }
+}
+
+void SignalGenerator::generate(const Buffer< std::complex<float> > &out) {
+  float *y = reinterpret_cast<float *>(out.data());
+  for (size_t i=0; i<out.size(); i+=CHUNK) {
+    render(y+2*i, std::min(size_t(CHUNK), out.size()-i), _position+i);
+  }
+  _position += out.size();
+}
+
+void SignalGenerator::generate(const Buffer<cint16> &out, float scale) {
+  // chunk on the stack, copies of the generator may run in parallel
+  float x[2*CHUNK];
+  int16_t *y = reinterpret_cast<int16_t *>(out.data());
+  for (size_t i=0; i<out.size(); i+=CHUNK) {
+    size_t N = std::min(size_t(CHUNK), out.size()-i);
+    render(x, N, _position+i);
+    toInt16(x, y+2*i, 2*N, scale);
+  }
+  _position += out.size();
+}
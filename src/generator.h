@@ -0,0 +1,201 @@
+#ifndef __SDR_GENERATOR_H__
+#define __SDR_GENERATOR_H__
+
+#include "buffer.h"
+#include "fixed.h"
+#include <vector>
+
+namespace sdr {
+
+  // Synthetic test signals for benchmarks and soak tests.
+  //
+  // A SignalGenerator sums tones, linear chirps and PSK-modulated carriers
+  // and adds noise at a given SNR. Every sample is a function of the seed,
+  // the configuration and its position in the stream only: the output does
+  // not depend on how the stream is split into blocks, and seek() jumps to
+  // any position directly. Oscillators are table-driven (a coarse and a
+  // fine table give the exact phase at the start of every segment of
+  // SEGMENT samples, a table of per-sample rotations continues it), the
+  // noise comes from a counter-based random number generator. The kernels
+  // use SSE2 if available and plain C++ otherwise, both give identical
+  // results unless the compiler fuses multiply-adds (e.g. with -mfma).
+
+  // Counter-based random numbers: word n of the stream is a hash of n and
+  // the seed, hence any word is computed independently of the others (and
+  // blocks of words in parallel). Within each run of 2^32 words, the counter
+  // is mapped through an odd multiplier and an offset derived from the seed
+  // and the run (a bijection), followed by a 32-bit integer hash.
+  class CounterRNG {
+    public:
+      // Per-run counter mapping
+      struct Key {
+        uint32_t mul, add;
+      };
+
+    public:
+      // Constructor with seed
+      CounterRNG(uint64_t seed=0) : _seed(seed) {}
+
+      // Destructor
+      virtual ~CounterRNG() {}
+
+      // Inline helper functions
+      // returns the seed
+      inline uint64_t seed() const { return _seed; }
+      // returns the counter mapping of run (counter >> 32)
+      inline Key key(uint32_t run) const {
+        uint64_t z = _seed + (uint64_t(run)+1)*0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        Key k = { uint32_t(z) | 1, uint32_t(z >> 32) };
+        return k;
+      }
+      // returns the 32-bit hash of x (a bijection)
+      static inline uint32_t hash(uint32_t x) {
+        x ^= x >> 16; x *= 0x7feb352dU;
+        x ^= x >> 15; x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+      }
+      // returns word n
+      inline uint32_t operator()(uint64_t n) const {
+        Key k = key(uint32_t(n >> 32));
+        return hash(uint32_t(n)*k.mul + k.add);
+      }
+
+      // Fills out with words n, n+1, ...
+      void fill(uint64_t n, const Buffer<uint32_t> &out) const;
+
+      // Fills out with normally distributed values of standard deviation
+      // sigma from words n, n+1, ... (one word per value). Each value is the
+      // centered sum of the four bytes of its word, hence the distribution is
+      // truncated at +-3.45 sigma.
+      void gaussian(uint64_t n, const Buffer<float> &out, float sigma) const;
+
+    protected:
+      // seed
+      uint64_t _seed;
+  };
+
+
+  // Sums tones, chirps and modulated carriers plus noise, see above.
+  // Frequencies are relative to the sample rate (-0.5 to 0.5), the power of
+  // a component is its amplitude squared, the noise power is per complex
+  // sample (split evenly between I and Q).
+  class SignalGenerator {
+    public:
+      // Constructor with seed (of the noise and the symbols)
+      SignalGenerator(uint64_t seed=0);
+
+      // Destructor
+      virtual ~SignalGenerator();
+
+      // Inline helper functions
+      // returns the seed
+      inline uint64_t seed() const { return _rng.seed(); }
+      // returns the position in the stream (index of the next sample)
+      inline uint64_t position() const { return _position; }
+      // sets the position in the stream
+      inline void seek(uint64_t position) { _position = position; }
+      // returns the number of signal components
+      inline size_t components() const { return _components.size(); }
+
+      // Returns the signal power (sum of the component powers)
+      double signalPower() const;
+      // Returns the noise power
+      double noisePower() const;
+
+      // Adds a tone with frequency, amplitude and initial phase (rad)
+      void addTone(double frequency, double amplitude=1, double phase=0);
+      // Adds a linear chirp from f0 to f1 over period samples, repeated
+      // with continuous phase (sawtooth sweep)
+      void addChirp(double f0, double f1, size_t period, double amplitude=1);
+      // Adds a carrier with M-PSK modulation by random symbols with
+      // rectangular pulses: bits per symbol 1 (BPSK) to 4 (16-PSK)
+      void addCarrier(double frequency, size_t samplesPerSymbol, int bits=2, double amplitude=1);
+      // Sets the noise power relative to the signal power (SNR in dB),
+      // follows later changes of the components
+      void setSNR(double snr);
+      // Sets the noise power (0 disables the noise)
+      void setNoise(double power);
+      // Removes all components and the noise
+      void clear();
+
+      // Fills out with the next samples. Copies of a generator share no
+      // state, hence they can render (e.g. after seek()) in parallel.
+      void generate(const Buffer< std::complex<float> > &out);
+      // Fills out with the next samples multiplied by scale (default: 1 maps
+      // to full scale), rounded and saturated
+      void generate(const Buffer<cint16> &out, float scale=32768);
+
+    protected:
+      // Component types
+      typedef enum {
+        TONE, CHIRP, CARRIER
+      } Type;
+
+      // A signal component. Phases are fixed point, the full circle is 2^64.
+      struct Component {
+        // component type
+        Type type;
+        // amplitude
+        double amplitude;
+        // phase at sample 0
+        uint64_t phase;
+        // phase increment per sample (at the start of a sweep)
+        uint64_t increment;
+        // change of the increment per sample (chirp)
+        uint64_t rate;
+        // sweep period (chirp) or samples per symbol (carrier)
+        uint64_t period;
+        // bits per symbol (carrier)
+        int bits;
+        // symbol source (carrier)
+        CounterRNG symbols;
+        // amplitude times the rotation by k samples, k < SEGMENT (tone, carrier)
+        std::vector< std::complex<float> > rotation;
+      };
+
+      // number of bits of the coarse and the fine oscillator table index
+      static const int TABLE_BITS = 11;
+      // maximum number of samples computed from one oscillator phase
+      static const size_t SEGMENT = 64;
+      // number of samples rendered at a time
+      static const size_t CHUNK = 1024;
+
+      // returns the oscillator value at the given phase (rounded to the
+      // resolution of the fine table)
+      inline std::complex<float> oscillator(uint64_t phase) const {
+        phase += uint64_t(1) << (63-2*TABLE_BITS);
+        const std::complex<float> &c = _coarse[phase >> (64-TABLE_BITS)];
+        const std::complex<float> &f = _fine[(phase >> (64-2*TABLE_BITS)) & ((uint64_t(1) << TABLE_BITS)-1)];
+        return std::complex<float>(c.real()*f.real() - c.imag()*f.imag(), c.real()*f.imag() + c.imag()*f.real());
+      }
+      // returns the phase of the component at sample n
+      uint64_t phaseAt(const Component &c, uint64_t n) const;
+      // adds a tone or carrier to N samples from position
+      void addRotating(const Component &c, float *out, size_t N, uint64_t position) const;
+      // adds a chirp to N samples from position
+      void addSweep(const Component &c, float *out, size_t N, uint64_t position) const;
+      // renders N <= CHUNK samples from position
+      void render(float *out, size_t N, uint64_t position) const;
+
+    protected:
+      // noise and symbol source
+      CounterRNG _rng;
+      // signal components
+      std::vector<Component> _components;
+      // coarse and fine oscillator tables
+      std::vector< std::complex<float> > _coarse, _fine;
+      // noise power (absolute) or SNR in dB (relative)
+      double _noise;
+      // true if _noise is an SNR
+      bool _relative;
+      // next sample
+      uint64_t _position;
+  };
+
+}
+
+#endif
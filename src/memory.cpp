@@ -0,0 +1,90 @@
+#include "memory.h"
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+
+using namespace sdr;
+
+// formats a byte count
+static std::string bytes(int64_t n) {
+  std::stringstream s;
+  int64_t a = (n < 0) ? -n : n;
+  if (a >= (int64_t(1) << 30)) { s << double(n)/(1 << 30) << " GiB"; }
+  else if (a >= (int64_t(1) << 20)) { s << double(n)/(1 << 20) << " MiB"; }
+  else if (a >= (int64_t(1) << 10)) { s << double(n)/(1 << 10) << " KiB"; }
+  else { s << n << " B"; }
+  return s.str();
+}
+
+
+// Reports
+void sdr::logMemoryStats(const MemoryStats &stats, LogLevel level) {
+  LogMessage msg(level);
+  msg << "Memory: " << bytes(stats.live) << " live in " << stats.count() << " buffers, peak "
+      << bytes(stats.peak) << ", " << stats.allocations << " allocations";
+  for (size_t i=0; i<stats.tags.size(); i++) {
+    if (stats.tag_allocations[i]) {
+      msg << "; " << stats.tags[i] << ": " << bytes(stats.tag_live[i]) << " (" << stats.tag_allocations[i] << ")";
+    }
+  }
+  Logger::get().log(msg);
+}
+
+int64_t sdr::logMemoryLeaks(const MemoryStats &stats) {
+  if (0 == stats.count()) { return stats.live; }
+  LogMessage msg(LOG_WARNING);
+  msg << "Memory: " << stats.count() << " buffers (" << bytes(stats.live) << ") not released";
+  for (size_t i=0; i<stats.tags.size(); i++) {
+    if (stats.tag_live[i]) { msg << "; " << stats.tags[i] << ": " << bytes(stats.tag_live[i]); }
+  }
+  // sizes of the remaining buffers
+  msg << "; sizes:";
+  for (size_t k=0; k<MemoryStats::CLASSES; k++) {
+    if (stats.classCount(k)) {
+      msg << " " << stats.classCount(k) << "x<=" << bytes(int64_t(1) << k);
+    }
+  }
+  Logger::get().log(msg);
+  return stats.live;
+}
+
+
+// Periodic reporter
+struct MemoryReporter::Thread {
+  std::thread thread;
+  std::mutex lock;
+  std::condition_variable wakeup;
+  bool stop;
+};
+
+// Constructor
+MemoryReporter::MemoryReporter(int interval, LogLevel level, bool leakReport)
+  : _interval(interval), _level(level), _leak_report(leakReport),
+    _baseline(MemoryTracker::snapshot().live), _thread(new Thread())
+{
+  _thread->stop = false;
+  if (0 < _interval) { _thread->thread = std::thread(&MemoryReporter::run, this); }
+}
+
+// Destructor
+MemoryReporter::~MemoryReporter() {
+  {
+    std::lock_guard<std::mutex> guard(_thread->lock);
+    _thread->stop = true;
+  }
+  _thread->wakeup.notify_all();
+  if (_thread->thread.joinable()) { _thread->thread.join(); }
+  delete _thread;
+  if (! _leak_report) { return; }
+  MemoryStats stats = MemoryTracker::snapshot();
+  if (stats.live > _baseline) { logMemoryLeaks(stats); }
+}
+
+void MemoryReporter::run() {
+  std::unique_lock<std::mutex> guard(_thread->lock);
+  while (! _thread->wakeup.wait_for(guard, std::chrono::milliseconds(_interval), [this]() { return _thread->stop; })) {
+    guard.unlock();
+    logMemoryStats(MemoryTracker::snapshot(), _level);
+    guard.lock();
+  }
+}
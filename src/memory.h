@@ -0,0 +1,348 @@
+#ifndef __SDR_MEMORY_H__
+#define __SDR_MEMORY_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "logger.h"
+
+namespace sdr {
+
+  // Accounting of the storage allocated by RawBuffer.
+  //
+  // Every allocation and release of buffer storage is counted in per-thread
+  // counters: bytes, number of allocations by size class (powers of two) and
+  // by allocation tag. The counters are only written by their thread without
+  // atomic read-modify-write operations and are summed up lazily when a
+  // snapshot is taken. Threads fold their counters into a global total when
+  // they exit.
+  //
+  // The peak of the live bytes is tracked through a global counter that
+  // threads update once their pending change exceeds FLUSH bytes, hence the
+  // peak may be underestimated by up to FLUSH bytes per thread.
+  //
+  // Allocations are tagged by a MemoryTag in scope on the allocating thread,
+  // e.g. { MemoryTag tag("fft"); ... }. The reporting through the Logger is
+  // in memory.cpp. Define SDR_NO_MEMORY_TRACKING to compile the counting
+  // out of RawBuffer, threads then never set up their counters and the
+  // snapshots stay empty.
+
+  // Aggregated counters
+  struct MemoryStats {
+    // Number of size classes, class k holds sizes in (2^(k-1), 2^k]
+    static const size_t CLASSES = 40;
+    // Maximum number of tags (tag 0 is untagged)
+    static const size_t MAX_TAGS = 32;
+
+    // Constructor, all counters zero
+    MemoryStats() : live(0), peak(0), allocations(0), releases(0) {
+      for (size_t i=0; i<CLASSES; i++) { class_allocations[i] = class_releases[i] = 0; }
+      for (size_t i=0; i<MAX_TAGS; i++) { tag_live[i] = 0; tag_allocations[i] = 0; }
+    }
+
+    // Inline helper functions
+    // returns the number of live allocations
+    inline uint64_t count() const { return allocations-releases; }
+    // returns the number of live allocations of size class k
+    inline uint64_t classCount(size_t k) const { return class_allocations[k]-class_releases[k]; }
+
+    // live bytes
+    int64_t live;
+    // peak of the live bytes
+    int64_t peak;
+    // number of allocations
+    uint64_t allocations;
+    // number of releases
+    uint64_t releases;
+    // allocations by size class
+    uint64_t class_allocations[CLASSES];
+    // releases by size class
+    uint64_t class_releases[CLASSES];
+    // live bytes by tag
+    int64_t tag_live[MAX_TAGS];
+    // allocations by tag
+    uint64_t tag_allocations[MAX_TAGS];
+    // tag names (index = tag)
+    std::vector<std::string> tags;
+  };
+
+
+  // Collects the counters of all threads
+  class MemoryTracker {
+    public:
+      // pending bytes of a thread before the global counter is updated
+      static const int64_t FLUSH = 1 << 20;
+
+    protected:
+      // Counters of a thread (or the retired threads)
+      struct Counters {
+        Counters(bool isShared) : shared(isShared), pending(0), tag(0) {
+          for (size_t i=0; i<MemoryStats::CLASSES; i++) { class_allocations[i].store(0); class_releases[i].store(0); }
+          for (size_t i=0; i<MemoryStats::MAX_TAGS; i++) { tag_live[i].store(0); tag_allocations[i].store(0); }
+        }
+        // adds n to a counter, atomically if it is written by several threads
+        static inline void add(std::atomic<int64_t> &c, int64_t n, bool shared) {
+          if (shared) { c.fetch_add(n, std::memory_order_relaxed); }
+          else { c.store(c.load(std::memory_order_relaxed)+n, std::memory_order_relaxed); }
+        }
+        // true for the counters of the retired threads
+        bool shared;
+        // change of the live bytes not yet in the global counter
+        int64_t pending;
+        // current tag of the thread
+        int tag;
+        std::atomic<int64_t> class_allocations[MemoryStats::CLASSES], class_releases[MemoryStats::CLASSES];
+        std::atomic<int64_t> tag_live[MemoryStats::MAX_TAGS], tag_allocations[MemoryStats::MAX_TAGS];
+      };
+
+      // Registered threads, tag names and global counters
+      struct Registry {
+        Registry() : retired(true), tags(1, "untagged") { live.store(0); peak.store(0); }
+        std::mutex lock;
+        std::vector<Counters *> threads;
+        // counters of exited threads, also used by a thread after its exit
+        Counters retired;
+        std::vector<std::string> tags;
+        // live bytes as flushed by the threads
+        std::atomic<int64_t> live;
+        // peak of the live bytes
+        std::atomic<int64_t> peak;
+      };
+
+      // Registers the counters of a thread and folds them into the retired
+      // counters when the thread exits
+      struct ThreadGuard {
+        ThreadGuard() : counters(false) {
+          Registry &reg = registry();
+          std::lock_guard<std::mutex> guard(reg.lock);
+          reg.threads.push_back(&counters);
+          current() = &counters;
+        }
+        ~ThreadGuard() {
+          Registry &reg = registry();
+          std::lock_guard<std::mutex> guard(reg.lock);
+          merge(reg.retired, counters);
+          reg.retired.tag = 0;
+          for (size_t i=0; i<reg.threads.size(); i++) {
+            if (reg.threads[i] == &counters) { reg.threads.erase(reg.threads.begin()+i); break; }
+          }
+          // late releases of this thread (e.g. static buffers at exit)
+          current() = &reg.retired;
+        }
+        Counters counters;
+      };
+
+    public:
+      // Returns the size class of N bytes
+      static inline size_t sizeClass(size_t N) {
+        size_t k = (N <= 1) ? 0 : size_t(64-__builtin_clzll(uint64_t(N-1)));
+        return std::min(k, MemoryStats::CLASSES-1);
+      }
+
+      // Returns the tag of the allocations of the calling thread
+      static inline int tag() {
+#ifdef SDR_NO_MEMORY_TRACKING
+        return 0;
+#else
+        return local().tag;
+#endif
+      }
+      // Sets the tag of the allocations of the calling thread, returns the
+      // previous one
+      static inline int setTag(int tag) {
+#ifdef SDR_NO_MEMORY_TRACKING
+        (void)tag;
+        return 0;
+#else
+        Counters &c = local();
+        int previous = c.tag;
+        c.tag = ((0 <= tag) && (size_t(tag) < MemoryStats::MAX_TAGS)) ? tag : 0;
+        return previous;
+#endif
+      }
+
+      // Returns the id of the named tag, registers new names (0 if there are
+      // too many tags)
+      static int tagId(const std::string &name) {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        for (size_t i=0; i<reg.tags.size(); i++) { if (reg.tags[i] == name) { return int(i); } }
+        if (reg.tags.size() >= MemoryStats::MAX_TAGS) { return 0; }
+        reg.tags.push_back(name);
+        return int(reg.tags.size()-1);
+      }
+
+      // Counts an allocation of N bytes, returns the tag of the allocation
+      static inline int allocated(size_t N) {
+#ifdef SDR_NO_MEMORY_TRACKING
+        (void)N;
+        return 0;
+#else
+        Counters &c = local();
+        bool shared = c.shared;
+        int tag = c.tag;
+        Counters::add(c.class_allocations[sizeClass(N)], 1, shared);
+        Counters::add(c.tag_live[tag], int64_t(N), shared);
+        Counters::add(c.tag_allocations[tag], 1, shared);
+        track(c, int64_t(N));
+        return tag;
+#endif
+      }
+
+      // Counts the release of N bytes allocated with the given tag
+      static inline void released(size_t N, int tag) {
+#ifdef SDR_NO_MEMORY_TRACKING
+        (void)N; (void)tag;
+#else
+        Counters &c = local();
+        bool shared = c.shared;
+        Counters::add(c.class_releases[sizeClass(N)], 1, shared);
+        Counters::add(c.tag_live[tag], -int64_t(N), shared);
+        track(c, -int64_t(N));
+#endif
+      }
+
+      // Sums up the counters of all threads
+      static MemoryStats snapshot() {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        MemoryStats stats;
+        add(stats, reg.retired);
+        for (size_t i=0; i<reg.threads.size(); i++) { add(stats, *reg.threads[i]); }
+        // the exact value may exceed the flushed peak
+        int64_t peak = reg.peak.load(std::memory_order_relaxed);
+        while ((stats.live > peak) && (! reg.peak.compare_exchange_weak(peak, stats.live))) {}
+        stats.peak = std::max(peak, stats.live);
+        stats.tags = reg.tags;
+        return stats;
+      }
+
+      // Restarts the peak at the current live bytes
+      static void resetPeak() {
+        registry().peak.store(snapshot().live, std::memory_order_relaxed);
+      }
+
+    protected:
+      // returns the global registry
+      static inline Registry &registry() {
+        static Registry reg;
+        return reg;
+      }
+      // returns the counters used by the calling thread
+      static inline Counters *&current() {
+        static thread_local Counters *counters = 0;
+        return counters;
+      }
+      // returns the counters of the calling thread, registers them on first use
+      static inline Counters &local() {
+        Counters *c = current();
+        if (c) { return *c; }
+        static thread_local ThreadGuard guard;
+        return *current();
+      }
+      // accumulates a change of the live bytes, updates the global counter
+      // once it exceeds FLUSH (shared counters update it right away)
+      static inline void track(Counters &c, int64_t n) {
+        if (c.shared) { update(n); return; }
+        c.pending += n;
+        if ((c.pending >= FLUSH) || (c.pending <= -FLUSH)) { flush(c); }
+      }
+      // moves the pending change into the global counter
+      static inline void flush(Counters &c) {
+        update(c.pending);
+        c.pending = 0;
+      }
+      // updates the global counter and the peak
+      static void update(int64_t n) {
+        Registry &reg = registry();
+        int64_t live = reg.live.fetch_add(n, std::memory_order_relaxed) + n;
+        int64_t peak = reg.peak.load(std::memory_order_relaxed);
+        while ((live > peak) && (! reg.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))) {}
+      }
+      // adds the counters to the stats
+      static void add(MemoryStats &stats, const Counters &c) {
+        // totals are the sums over the size classes and tags
+        for (size_t i=0; i<MemoryStats::CLASSES; i++) {
+          uint64_t a = uint64_t(c.class_allocations[i].load(std::memory_order_relaxed));
+          uint64_t r = uint64_t(c.class_releases[i].load(std::memory_order_relaxed));
+          stats.class_allocations[i] += a; stats.allocations += a;
+          stats.class_releases[i] += r; stats.releases += r;
+        }
+        for (size_t i=0; i<MemoryStats::MAX_TAGS; i++) {
+          int64_t live = c.tag_live[i].load(std::memory_order_relaxed);
+          stats.tag_live[i] += live; stats.live += live;
+          stats.tag_allocations[i] += uint64_t(c.tag_allocations[i].load(std::memory_order_relaxed));
+        }
+      }
+      // adds the counters of an exiting thread to the retired ones
+      static void merge(Counters &dest, Counters &src) {
+        for (size_t i=0; i<MemoryStats::CLASSES; i++) {
+          Counters::add(dest.class_allocations[i], src.class_allocations[i].load(), true);
+          Counters::add(dest.class_releases[i], src.class_releases[i].load(), true);
+        }
+        for (size_t i=0; i<MemoryStats::MAX_TAGS; i++) {
+          Counters::add(dest.tag_live[i], src.tag_live[i].load(), true);
+          Counters::add(dest.tag_allocations[i], src.tag_allocations[i].load(), true);
+        }
+        flush(src);
+      }
+  };
+
+
+  // Tags the buffer allocations of the calling thread while in scope
+  class MemoryTag {
+    public:
+      // Constructor with the tag name (e.g. "ring", "block", "fft")
+      MemoryTag(const std::string &name) : _previous(MemoryTracker::setTag(MemoryTracker::tagId(name))) {}
+      // Constructor with a tag id (see MemoryTracker::tagId())
+      MemoryTag(int id) : _previous(MemoryTracker::setTag(id)) {}
+      // Destructor, restores the previous tag
+      virtual ~MemoryTag() { MemoryTracker::setTag(_previous); }
+
+    protected:
+      // tag before this one
+      int _previous;
+  };
+
+
+  // Logs the memory statistics (live and peak bytes, by tag and size class)
+  void logMemoryStats(const MemoryStats &stats, LogLevel level=LOG_INFO);
+
+  // Logs the live allocations as leaks (warning), returns the live bytes
+  int64_t logMemoryLeaks(const MemoryStats &stats);
+
+  // Logs the memory statistics periodically from a background thread, and
+  // optionally a leak report when destroyed (create it at the beginning of
+  // main, after the buffers that are meant to live forever).
+  class MemoryReporter {
+    public:
+      // Constructor with the reporting interval in ms (0: no periodic reports)
+      // and the log level of the reports
+      MemoryReporter(int interval, LogLevel level=LOG_INFO, bool leakReport=true);
+      // Destructor, stops the reports and logs the leaks
+      virtual ~MemoryReporter();
+
+    protected:
+      // reporting thread
+      void run();
+
+    protected:
+      // interval in ms
+      int _interval;
+      // log level
+      LogLevel _level;
+      // log leaks at destruction
+      bool _leak_report;
+      // live bytes at construction, leaks are reported if more is live
+      int64_t _baseline;
+      // implementation (thread and wakeup)
+      struct Thread;
+      Thread *_thread;
+  };
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef __SDR_MULTIBUFFER_H__
+#define __SDR_MULTIBUFFER_H__
+
+#include "buffer.h"
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sdr {
+
+  // De-interleaves n samples of C channels, in[s*C+c] -> out[c*stride+s]
+  template <class T>
+  inline void deinterleave(const T *in, size_t C, T *out, size_t stride, size_t n) {
+    for (size_t c=0; c<C; c++) {
+      T *lane = out + c*stride;
+      for (size_t s=0; s<n; s++) { lane[s] = in[s*C+c]; }
+    }
+  }
+
+  // De-interleaves complex float samples, two samples of a channel at a time
+  // with two 64-bit loads into one vector (no gather)
+  template <>
+  inline void deinterleave< std::complex<float> >(const std::complex<float> *in, size_t C,
+                                                   std::complex<float> *out, size_t stride, size_t n) {
+    const float *x = reinterpret_cast<const float *>(in);
+#ifdef __SSE2__
+    if (2 == C) {
+      // [a0,b0], [a1,b1] -> [a0,a1], [b0,b1] for both channels at once
+      float *a = reinterpret_cast<float *>(out), *b = reinterpret_cast<float *>(out + stride);
+      size_t s = 0;
+      for (; (s+2)<=n; s+=2) {
+        __m128 v0 = _mm_loadu_ps(x+4*s), v1 = _mm_loadu_ps(x+4*s+4);
+        _mm_storeu_ps(a+2*s, _mm_movelh_ps(v0, v1));
+        _mm_storeu_ps(b+2*s, _mm_movehl_ps(v1, v0));
+      }
+      for (; s<n; s++) {
+        a[2*s] = x[4*s]; a[2*s+1] = x[4*s+1]; b[2*s] = x[4*s+2]; b[2*s+1] = x[4*s+3];
+      }
+      return;
+    }
+#endif
+    for (size_t c=0; c<C; c++) {
+      float *lane = reinterpret_cast<float *>(out + c*stride);
+      size_t s = 0;
+#ifdef __SSE2__
+      for (; (s+2)<=n; s+=2) {
+        __m128 v = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(x+2*(s*C+c)));
+        v = _mm_loadh_pi(v, (const __m64 *)(x+2*((s+1)*C+c)));
+        _mm_storeu_ps(lane+2*s, v);
+      }
+#endif
+      for (; s<n; s++) { lane[2*s] = x[2*(s*C+c)]; lane[2*s+1] = x[2*(s*C+c)+1]; }
+    }
+  }
+
+  // Interleaves n samples of C channels, in[c*stride+s] -> out[s*C+c]
+  template <class T>
+  inline void interleave(const T *in, size_t stride, size_t C, T *out, size_t n) {
+    for (size_t c=0; c<C; c++) {
+      const T *lane = in + c*stride;
+      for (size_t s=0; s<n; s++) { out[s*C+c] = lane[s]; }
+    }
+  }
+
+  // acc[s] += w*x[s]
+  template <class T>
+  inline void multiplyAdd(T *acc, const T *x, const T &w, size_t n) {
+    for (size_t s=0; s<n; s++) { acc[s] += w*x[s]; }
+  }
+
+  // Complex multiply-add written out on the real and imaginary parts,
+  // avoiding the NaN handling of the std::complex multiplication
+  template <class T>
+  inline void multiplyAdd(std::complex<T> *acc, const std::complex<T> *x, const std::complex<T> &w, size_t n) {
+    T *a = reinterpret_cast<T *>(acc);
+    const T *v = reinterpret_cast<const T *>(x);
+    T wr = w.real(), wi = w.imag();
+    for (size_t s=0; s<n; s++) {
+      T vr = v[2*s], vi = v[2*s+1];
+      a[2*s] += wr*vr - wi*vi;
+      a[2*s+1] += wr*vi + wi*vr;
+    }
+  }
+
+  // Returns sum |x[s]|^2
+  template <class T>
+  inline double sumSquares(const T *x, size_t n) {
+    double sum = 0;
+    for (size_t s=0; s<n; s++) { sum += double(x[s])*double(x[s]); }
+    return sum;
+  }
+
+  // Sum of squares of complex samples over the real and imaginary parts
+  template <class T>
+  inline double sumSquares(const std::complex<T> *x, size_t n) {
+    return sumSquares(reinterpret_cast<const T *>(x), 2*n);
+  }
+
+
+  // Multi-channel buffer in structure-of-arrays layout.
+  //
+  // The samples of every channel are stored contiguously in their own lane.
+  // Lanes start at 64-byte boundaries, hence operations along the samples
+  // of a channel vectorize without gather instructions. All lanes share one
+  // reference counted storage, channel(c) returns a Buffer view of a lane.
+  template <class T>
+  class MultiBuffer {
+    public:
+      // lane alignment in bytes
+      static const size_t ALIGN = 64;
+
+    public:
+      // Empty constructor
+      MultiBuffer() : _storage(), _channels(0), _size(0), _stride(0), _offset(0) {}
+
+      // Constructor with number of channels and samples per channel
+      MultiBuffer(size_t channels, size_t N)
+        : _storage(), _channels(channels), _size(N), _stride(0), _offset(0)
+      {
+        // lane stride rounded up to the alignment
+        size_t align = std::max(size_t(1), ALIGN/sizeof(T));
+        _stride = ((N+align-1)/align)*align;
+        _storage = Buffer<T>(_channels*_stride + align);
+        // first lane at the next aligned address
+        size_t mis = (size_t(_storage.data()) % ALIGN)/sizeof(T);
+        _offset = mis ? (align-mis) : 0;
+      }
+
+      // Destructor
+      virtual ~MultiBuffer() {}
+
+      // Inline helper functions
+      // returns the number of channels
+      inline size_t channels() const { return _channels; }
+      // returns the number of samples per channel
+      inline size_t size() const { return _size; }
+      // returns the distance between lanes in samples
+      inline size_t stride() const { return _stride; }
+      // returns the first sample of channel c
+      inline T *lane(size_t c) const {
+        return reinterpret_cast<T *>(_storage.data()) + _offset + c*_stride;
+      }
+      // returns a view of channel c
+      inline Buffer<T> channel(size_t c) const { return _storage.sub(_offset+c*_stride, _size); }
+      // returns a view of channel c
+      inline Buffer<T> operator[] (size_t c) const { return channel(c); }
+
+      // De-interleaves the input (sample-major, channels interleaved) into
+      // the lanes, returns the number of samples per channel written
+      size_t deinterleave(const Buffer<T> &in) {
+        size_t n = _channels ? std::min(_size, in.size()/_channels) : 0;
+        sdr::deinterleave(reinterpret_cast<const T *>(in.data()), _channels, lane(0), _stride, n);
+        return n;
+      }
+
+      // Interleaves the lanes into out, returns the number of samples per
+      // channel written
+      size_t interleave(const Buffer<T> &out) const {
+        size_t n = _channels ? std::min(_size, out.size()/_channels) : 0;
+        sdr::interleave(lane(0), _stride, _channels, reinterpret_cast<T *>(out.data()), n);
+        return n;
+      }
+
+      // Combines the channels with the given weights, out[s] = sum_c w[c]*x_c[s].
+      // Returns false if out is too small or the number of weights does not
+      // match.
+      bool beamform(const std::vector<T> &weights, const Buffer<T> &out) const {
+        if ((out.size() < _size) || (weights.size() != _channels)) { return false; }
+        T *y = reinterpret_cast<T *>(out.data());
+        for (size_t s=0; s<_size; s++) { y[s] = T(0); }
+        // one channel at a time: contiguous loads and stores
+        for (size_t c=0; c<_channels; c++) { multiplyAdd(y, lane(c), weights[c], _size); }
+        return true;
+      }
+
+      // Returns the L2 norm of every channel
+      std::vector<double> norms() const {
+        std::vector<double> result(_channels, 0);
+        for (size_t c=0; c<_channels; c++) { result[c] = std::sqrt(sumSquares(lane(c), _size)); }
+        return result;
+      }
+
+    protected:
+      // storage of all lanes
+      Buffer<T> _storage;
+      // number of channels
+      size_t _channels;
+      // samples per channel
+      size_t _size;
+      // lane stride in samples
+      size_t _stride;
+      // offset of the first (aligned) lane in samples
+      size_t _offset;
+  };
+
+
+  // Multi-channel ring buffer in structure-of-arrays layout. All channels
+  // share the read and write cursors, interleaved input is de-interleaved
+  // directly into the lanes of the ring.
+  template <class T>
+  class MultiCircularBuffer {
+    public:
+      // Empty constructor
+      MultiCircularBuffer() : _lanes(), _put(0), _take(0), _stored(0) {}
+
+      // Constructor with number of channels and capacity per channel
+      MultiCircularBuffer(size_t channels, size_t N) : _lanes(channels, N), _put(0), _take(0), _stored(0) {}
+
+      // Destructor
+      virtual ~MultiCircularBuffer() {}
+
+      // Inline helper functions
+      // returns the number of channels
+      inline size_t channels() const { return _lanes.channels(); }
+      // returns the capacity per channel
+      inline size_t size() const { return _lanes.size(); }
+      // returns the number of samples stored per channel
+      inline size_t stored() const { return _stored; }
+      // returns the number of free samples per channel
+      inline size_t free() const { return size()-_stored; }
+      // returns sample i (relative to the oldest) of channel c
+      inline T &at(size_t c, size_t i) {
+        size_t j = _take+i;
+        if (j >= size()) { j -= size(); }
+        return _lanes.lane(c)[j];
+      }
+
+      // Pushes interleaved samples (in.size() must be a multiple of the
+      // number of channels), returns false if there is not enough space
+      bool pushInterleaved(const Buffer<T> &in) {
+        size_t C = channels(), n = C ? in.size()/C : 0;
+        if ((0 == C) || (n*C != in.size()) || (n > free())) { return false; }
+        if (0 == n) { return true; }
+        const T *x = reinterpret_cast<const T *>(in.data());
+        // up to the end of the lanes, then from the beginning
+        size_t first = std::min(n, size()-_put);
+        sdr::deinterleave(x, C, _lanes.lane(0)+_put, _lanes.stride(), first);
+        sdr::deinterleave(x+first*C, C, _lanes.lane(0), _lanes.stride(), n-first);
+        _put = (_put+n) % size();
+        _stored += n;
+        return true;
+      }
+
+      // Pushes the samples of a multi-channel block, returns false if the
+      // channel count does not match or there is not enough space
+      bool push(const MultiBuffer<T> &block) {
+        size_t n = block.size();
+        if ((block.channels() != channels()) || (n > free())) { return false; }
+        if (0 == n) { return true; }
+        size_t first = std::min(n, size()-_put);
+        for (size_t c=0; c<channels(); c++) {
+          std::memcpy(_lanes.lane(c)+_put, block.lane(c), first*sizeof(T));
+          std::memcpy(_lanes.lane(c), block.lane(c)+first, (n-first)*sizeof(T));
+        }
+        _put = (_put+n) % size();
+        _stored += n;
+        return true;
+      }
+
+      // Pulls N samples per channel into dest, returns false if the channel
+      // count does not match, dest is too small or less than N are stored
+      bool pull(const MultiBuffer<T> &dest, size_t N) {
+        if ((dest.channels() != channels()) || (dest.size() < N) || (N > _stored)) { return false; }
+        size_t first = std::min(N, size()-_take);
+        for (size_t c=0; c<channels(); c++) {
+          std::memcpy(dest.lane(c), _lanes.lane(c)+_take, first*sizeof(T));
+          std::memcpy(dest.lane(c)+first, _lanes.lane(c), (N-first)*sizeof(T));
+        }
+        drop(N);
+        return true;
+      }
+
+      // Drops N samples per channel
+      inline void drop(size_t N) {
+        N = std::min(N, _stored);
+        if (0 == N) { return; }
+        _take = (_take+N) % size();
+        _stored -= N;
+      }
+
+      // Returns views of the N oldest samples of channel c: the first part
+      // up to the end of the lane and the wrapped part (possibly empty)
+      inline std::pair< Buffer<T>, Buffer<T> > peek(size_t c, size_t N) const {
+        N = std::min(N, _stored);
+        size_t first = std::min(N, size()-_take);
+        Buffer<T> lane = _lanes.channel(c);
+        return std::make_pair(lane.sub(_take, first), lane.sub(0, N-first));
+      }
+
+    protected:
+      // lanes of the ring
+      MultiBuffer<T> _lanes;
+      // write index
+      size_t _put;
+      // read index
+      size_t _take;
+      // samples stored per channel
+      size_t _stored;
+  };
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+#include "offline.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace sdr;
+
+// Constructor
+MappedFile::MappedFile(const std::string &path)
+  : _data(0), _size(0)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) { return; }
+  struct stat st;
+  if ((0 == fstat(fd, &st)) && (0 < st.st_size)) {
+    void *ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED != ptr) {
+      _data = (char *)ptr;
+      _size = st.st_size;
+      // chunks are read sequentially by every thread
+      madvise(_data, _size, MADV_SEQUENTIAL);
+    }
+  }
+  // the mapping stays valid after closing the file
+  ::close(fd);
+}
+
+// Destructor
+MappedFile::~MappedFile() {
+  if (_data) { munmap(_data, _size); }
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this == &other) { return *this; }
+  if (_data) { munmap(_data, _size); }
+  _data = other._data; _size = other._size;
+  other._data = 0; other._size = 0;
+  return *this;
+}
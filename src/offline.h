@@ -0,0 +1,233 @@
+#ifndef __SDR_OFFLINE_H__
+#define __SDR_OFFLINE_H__
+
+#include "buffer.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string>
+
+namespace sdr {
+
+  // A read-only memory mapping of a recording. The samples are accessed as
+  // zero-copy Buffer views into the mapping (without reference counting),
+  // hence the MappedFile must outlive all views. The pages are mapped
+  // read-only, writing into a view faults. A MappedFile owns its mapping,
+  // it can be moved but not copied.
+  class MappedFile {
+    public:
+      // Constructor, maps the file (see isOpen())
+      MappedFile(const std::string &path);
+      // Move constructor, takes over the mapping
+      MappedFile(MappedFile &&other) noexcept : _data(other._data), _size(other._size) {
+        other._data = 0; other._size = 0;
+      }
+      // Mappings cannot be copied
+      MappedFile(const MappedFile &other) = delete;
+
+      // Destructor, unmaps the file
+      virtual ~MappedFile();
+
+      // Move assignment, unmaps the current file and takes over the mapping
+      MappedFile &operator=(MappedFile &&other) noexcept;
+      // Mappings cannot be copied
+      MappedFile &operator=(const MappedFile &other) = delete;
+
+      // Returns true if the file is mapped
+      inline bool isOpen() const { return 0 != _data; }
+      // Returns the size of the file in bytes
+      inline size_t bytes() const { return _size; }
+      // Returns the number of complete samples of type T
+      template <class T>
+      inline size_t count() const { return _size/sizeof(T); }
+
+      // Returns a view of N samples of type T starting at sample offset. The
+      // view is clipped to the end of the file.
+      template <class T>
+      Buffer<T> view(size_t offset, size_t N) const {
+        if (offset >= count<T>()) { return Buffer<T>(); }
+        N = std::min(N, count<T>()-offset);
+        return Buffer<T>(reinterpret_cast<T *>(_data)+offset, N);
+      }
+
+      // Returns a view of all samples of type T
+      template <class T>
+      inline Buffer<T> view() const { return view<T>(0, count<T>()); }
+
+    protected:
+      // start of the mapping
+      char *_data;
+      // size of the file
+      size_t _size;
+  };
+
+
+  // A processing chain run on a chunk of an offline recording. It follows
+  // the conventions of the block filters (e.g. FixedFIR, CICDecimator): the
+  // state carries across calls of process(), which returns the number of
+  // output samples written.
+  template <class In, class Out>
+  class ChunkChain {
+    public:
+      // Destructor
+      virtual ~ChunkChain() {}
+
+      // Needs to be implemented by sub-classes: returns a new chain with the
+      // same configuration and a cleared state (owned by the caller)
+      virtual ChunkChain *clone() const = 0;
+
+      // Needs to be implemented by sub-classes: returns the maximum number of
+      // outputs for an input block of N samples
+      virtual size_t maxOutputs(size_t N) const = 0;
+
+      // Needs to be implemented by sub-classes: processes a block, returns
+      // the number of samples written into out
+      virtual size_t process(const Buffer<In> &in, const Buffer<Out> &out) = 0;
+  };
+
+
+  // Processes a recording in parallel chunks.
+  //
+  // The input is split into chunks of equal length. Every chunk is processed
+  // by its own clone of the chain on a pool of threads. To bring the state
+  // of the clone into the steady state, it first processes the warm-up
+  // region of the preceding samples and discards those outputs. The results
+  // are delivered to the sink in chunk order. At most 2 chunks per thread
+  // are in flight, bounding the memory held by pending results.
+  //
+  // The results equal a sequential run if the chain's memory is shorter than
+  // the warm-up (e.g. FIR taps, CIC order*rate*delay) and chunk length and
+  // warm-up are multiples of the total decimation (see alignment), keeping
+  // the decimation phase.
+  template <class In, class Out>
+  class ChunkedProcessor {
+    public:
+      // Receives the output of a chunk, called in chunk order from any thread
+      typedef std::function<void(size_t chunk, const Buffer<Out> &out)> Sink;
+
+    public:
+      // Constructor with prototype chain, chunk length and warm-up in
+      // samples, both rounded up to a multiple of alignment, number of
+      // threads (0: hardware concurrency) and the block size in which a
+      // chunk is fed into the chain
+      ChunkedProcessor(const ChunkChain<In, Out> &prototype, size_t chunk, size_t warmup,
+                       size_t alignment=1, size_t threads=0, size_t block=65536)
+        : _prototype(prototype), _alignment(std::max(size_t(1), alignment)),
+          _chunk(roundUp(std::max(size_t(1), chunk))), _warmup(roundUp(warmup)),
+          _threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+          _block(std::max(size_t(1), block))
+      {}
+
+      // Destructor
+      virtual ~ChunkedProcessor() {}
+
+      // Inline helper functions
+      // returns the chunk length
+      inline size_t chunk() const { return _chunk; }
+      // returns the warm-up length
+      inline size_t warmup() const { return _warmup; }
+      // returns the number of threads
+      inline size_t threads() const { return _threads; }
+      // returns the number of chunks for an input of N samples
+      inline size_t numChunks(size_t N) const { return (N+_chunk-1)/_chunk; }
+
+      // Processes the input, the outputs of all chunks are passed to the
+      // sink in order. Returns the total number of output samples.
+      size_t run(const Buffer<In> &input, const Sink &sink) {
+        size_t chunks = numChunks(input.size()), window = 2*_threads;
+        std::atomic<size_t> next(0);
+        std::mutex lock;
+        std::condition_variable cond;
+        std::map< size_t, Buffer<Out> > ready;
+        size_t delivered = 0, total = 0;
+
+        auto worker = [&]() {
+          for (;;) {
+            size_t c = next.fetch_add(1);
+            if (c >= chunks) { return; }
+            {
+              // bound the number of chunks in flight
+              std::unique_lock<std::mutex> guard(lock);
+              cond.wait(guard, [&]() { return c < (delivered+window); });
+            }
+            Buffer<Out> out = processChunk(input, c);
+            std::unique_lock<std::mutex> guard(lock);
+            ready[c] = out;
+            // deliver consecutive results; the sink is called under the lock,
+            // hence in order and never concurrently
+            while (ready.size() && (ready.begin()->first == delivered)) {
+              total += ready.begin()->second.size();
+              sink(delivered, ready.begin()->second);
+              ready.erase(ready.begin());
+              delivered++;
+            }
+            cond.notify_all();
+          }
+        };
+
+        std::vector<std::thread> pool;
+        for (size_t i=1; i<_threads; i++) { pool.push_back(std::thread(worker)); }
+        worker();
+        for (size_t i=0; i<pool.size(); i++) { pool[i].join(); }
+        return total;
+      }
+
+      // Processes the input and returns the stitched output
+      Buffer<Out> run(const Buffer<In> &input) {
+        std::vector< Buffer<Out> > parts;
+        size_t total = run(input, [&parts](size_t, const Buffer<Out> &out) { parts.push_back(out); });
+        Buffer<Out> result(total);
+        size_t offset = 0;
+        for (size_t i=0; i<parts.size(); i++) {
+          std::memcpy(result.data()+offset*sizeof(Out), parts[i].data(), parts[i].size()*sizeof(Out));
+          offset += parts[i].size();
+        }
+        return result;
+      }
+
+    protected:
+      // processes chunk c with a fresh clone of the chain
+      Buffer<Out> processChunk(const Buffer<In> &input, size_t c) {
+        size_t start = c*_chunk, len = std::min(_chunk, input.size()-start);
+        size_t warm = std::min(_warmup, start);
+        ChunkChain<In, Out> *chain = _prototype.clone();
+        // warm-up, outputs discarded
+        Buffer<Out> scratch(chain->maxOutputs(std::min(_block, std::max(warm, size_t(1)))));
+        for (size_t o=0; o<warm; o+=_block) {
+          chain->process(input.sub(start-warm+o, std::min(_block, warm-o)), scratch);
+        }
+        // chunk body, fed block-wise
+        Buffer<Out> out(chain->maxOutputs(len) + len/_block + 1);
+        size_t count = 0;
+        for (size_t o=0; o<len; o+=_block) {
+          size_t n = std::min(_block, len-o);
+          count += chain->process(input.sub(start+o, n), out.sub(count, out.size()-count));
+        }
+        delete chain;
+        return out.head(count);
+      }
+
+      // rounds up to a multiple of the alignment
+      inline size_t roundUp(size_t n) const { return ((n+_alignment-1)/_alignment)*_alignment; }
+
+    protected:
+      // the prototype chain, cloned for every chunk
+      const ChunkChain<In, Out> &_prototype;
+      // chunk and warm-up alignment
+      size_t _alignment;
+      // chunk length
+      size_t _chunk;
+      // warm-up length
+      size_t _warmup;
+      // number of threads
+      size_t _threads;
+      // block size fed into the chain
+      size_t _block;
+  };
+
+}
+
+#endif
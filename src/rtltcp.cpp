@@ -0,0 +1,251 @@
+#include "rtltcp.h"
+#include "logger.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <chrono>
+
+using namespace sdr;
+
+// size of an I/Q sample pair in bytes
+static const size_t PAIR = 2;
+
+// monotonic time in ms
+static int64_t now() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// reads a big-endian 32-bit value
+static uint32_t readBE32(const uint8_t *p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+
+// Constructor
+RTLTcpSource::RTLTcpSource(const std::string &host, uint16_t port, CircularBuffer<uint8_t> &ring,
+                           int stallTimeout, int reconnectDelay)
+  : _host(host), _port(port), _ring(ring), _stall_timeout(stallTimeout), _reconnect_delay(reconnectDelay),
+    _epoll(epoll_create1(EPOLL_CLOEXEC)), _fd(-1), _state(DISCONNECTED), _retry_at(0), _last_data(0),
+    _header_len(0), _partial(0), _out(), _commands(), _tuner_type(0), _gain_count(0), _received(0),
+    _connections(0), _stalls(0), _ring_full(0)
+{}
+
+// Destructor
+RTLTcpSource::~RTLTcpSource() {
+  if (0 <= _fd) { ::close(_fd); }
+  if (0 <= _epoll) { ::close(_epoll); }
+}
+
+const char *RTLTcpSource::tunerName(uint32_t type) {
+  static const char *names[] = { "unknown", "E4000", "FC0012", "FC0013", "FC2580", "R820T", "R828D" };
+  return (type < (sizeof(names)/sizeof(names[0]))) ? names[type] : names[0];
+}
+
+bool RTLTcpSource::command(Command cmd, uint32_t value) {
+  _commands[uint8_t(cmd)] = value;
+  if (STREAMING != _state) { return false; }
+  queue(uint8_t(cmd), value);
+  flush();
+  return STREAMING == _state;
+}
+
+size_t RTLTcpSource::poll(int timeout) {
+  if (DISCONNECTED == _state) {
+    int64_t t = now();
+    if (t < _retry_at) {
+      // nothing is watched by epoll while disconnected: sleeps until the
+      // next attempt or the timeout
+      int wait = int(_retry_at-t);
+      if ((0 <= timeout) && (timeout < wait)) { wait = timeout; }
+      struct epoll_event ev;
+      epoll_wait(_epoll, &ev, 1, wait);
+      if (now() < _retry_at) { return 0; }
+    }
+    connect();
+    if (DISCONNECTED == _state) { return 0; }
+  }
+
+  if ((STREAMING == _state) && (_ring.bytesFree() <= _partial)) {
+    // a readable socket would wake epoll immediately, the consumer has to
+    // catch up first (this is not a stall of the server)
+    _ring_full++;
+    _last_data = now();
+    return 0;
+  }
+
+  size_t total = 0;
+  struct epoll_event ev;
+  if (0 < epoll_wait(_epoll, &ev, 1, timeout)) {
+    if (CONNECTING == _state) {
+      int err = 0; socklen_t len = sizeof(err);
+      if ((0 != getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len)) || err) {
+        drop(strerror(err ? err : errno));
+        return 0;
+      }
+      _state = HEADER;
+      watch(false);
+    }
+    if ((HEADER == _state) && (ev.events & (EPOLLIN|EPOLLHUP|EPOLLERR)) && readHeader()) {
+      _state = STREAMING;
+      _connections++;
+      LogMessage msg(LOG_INFO);
+      msg << "RTLTcpSource: connected to " << _host << ":" << _port << ", tuner "
+          << tunerName(_tuner_type) << ", " << _gain_count << " gain steps";
+      Logger::get().log(msg);
+      // restore the tuning of the previous connection
+      for (std::map<uint8_t, uint32_t>::const_iterator it=_commands.begin(); it!=_commands.end(); it++) {
+        queue(it->first, it->second);
+      }
+      flush();
+    }
+    if ((STREAMING == _state) && (ev.events & EPOLLOUT)) { flush(); }
+    if ((STREAMING == _state) && (ev.events & (EPOLLIN|EPOLLHUP|EPOLLERR))) { total = readData(); }
+  }
+
+  if ((DISCONNECTED != _state) && ((now()-_last_data) > _stall_timeout)) {
+    _stalls++;
+    drop("stream stalled");
+  }
+  return total;
+}
+
+void RTLTcpSource::disconnect() {
+  drop(0);
+}
+
+void RTLTcpSource::connect() {
+  _retry_at = now() + _reconnect_delay;
+  struct addrinfo hints, *addr = 0;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  std::string port = std::to_string(_port);
+  if ((0 != getaddrinfo(_host.c_str(), port.c_str(), &hints, &addr)) || (0 == addr)) {
+    LogMessage msg(LOG_WARNING);
+    msg << "RTLTcpSource: cannot resolve " << _host;
+    Logger::get().log(msg);
+    return;
+  }
+  _fd = socket(addr->ai_family, addr->ai_socktype|SOCK_NONBLOCK|SOCK_CLOEXEC, addr->ai_protocol);
+  if (0 > _fd) { freeaddrinfo(addr); return; }
+  // commands are small, send them right away
+  int one = 1;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  int res = ::connect(_fd, addr->ai_addr, addr->ai_addrlen);
+  freeaddrinfo(addr);
+  if ((0 != res) && (EINPROGRESS != errno)) { drop(strerror(errno)); return; }
+  // completion is signalled by EPOLLOUT
+  struct epoll_event ev;
+  ev.events = EPOLLOUT; ev.data.u64 = 0;
+  epoll_ctl(_epoll, EPOLL_CTL_ADD, _fd, &ev);
+  _state = CONNECTING;
+  _header_len = 0;
+  _partial = 0;
+  _out.clear();
+  _last_data = now();
+}
+
+void RTLTcpSource::drop(const char *reason) {
+  if (0 <= _fd) {
+    // closing removes the socket from epoll
+    ::close(_fd);
+    _fd = -1;
+  }
+  if (reason) {
+    LogMessage msg(LOG_WARNING);
+    msg << "RTLTcpSource: " << _host << ":" << _port << ": " << reason;
+    Logger::get().log(msg);
+  }
+  _state = DISCONNECTED;
+  // the bytes of an incomplete pair were never committed
+  _partial = 0;
+  _out.clear();
+  _retry_at = now() + _reconnect_delay;
+}
+
+bool RTLTcpSource::readHeader() {
+  ssize_t n = recv(_fd, _header+_header_len, sizeof(_header)-_header_len, 0);
+  if (0 == n) { drop("closed by server"); return false; }
+  if (0 > n) {
+    if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno)) { drop(strerror(errno)); }
+    return false;
+  }
+  _header_len += size_t(n);
+  _last_data = now();
+  if (_header_len < sizeof(_header)) { return false; }
+  if (0 != std::memcmp(_header, "RTL0", 4)) { drop("invalid header"); return false; }
+  _tuner_type = readBE32(_header+4);
+  _gain_count = readBE32(_header+8);
+  return true;
+}
+
+size_t RTLTcpSource::readData() {
+  size_t total = 0;
+  for (;;) {
+    // free space behind the partial pair, up to two spans
+    std::pair<RawBuffer, RawBuffer> spans = _ring.freeSpans();
+    struct iovec iov[2];
+    int count = 0;
+    size_t skip = _partial, requested = 0;
+    const RawBuffer *span[2] = { &spans.first, &spans.second };
+    for (int i=0; i<2; i++) {
+      size_t len = span[i]->bytesLen();
+      if (skip >= len) { skip -= len; continue; }
+      iov[count].iov_base = span[i]->data()+skip;
+      iov[count].iov_len = len-skip;
+      requested += len-skip;
+      skip = 0; count++;
+    }
+    if (0 == count) { _ring_full++; break; }
+
+    ssize_t n = readv(_fd, iov, count);
+    if (0 < n) {
+      // commit complete pairs only, keep the rest for the next read
+      size_t avail = _partial + size_t(n), pairs = avail - (avail % PAIR);
+      _ring.commit(pairs);
+      _partial = avail-pairs;
+      _received += pairs;
+      total += pairs;
+      _last_data = now();
+      // a short read drained the socket
+      if (size_t(n) < requested) { break; }
+      continue;
+    }
+    if (0 == n) { drop("closed by server"); break; }
+    if (EINTR == errno) { continue; }
+    if ((EAGAIN != errno) && (EWOULDBLOCK != errno)) { drop(strerror(errno)); }
+    break;
+  }
+  return total;
+}
+
+void RTLTcpSource::flush() {
+  if ((STREAMING != _state) || _out.empty()) { return; }
+  ssize_t n = send(_fd, _out.data(), _out.size(), MSG_NOSIGNAL);
+  if (0 < n) { _out.erase(_out.begin(), _out.begin()+n); }
+  else if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno)) {
+    drop(strerror(errno));
+    return;
+  }
+  // wait for space in the send buffer if something is left
+  watch(! _out.empty());
+}
+
+void RTLTcpSource::queue(uint8_t cmd, uint32_t value) {
+  uint8_t bytes[5] = { cmd, uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value) };
+  _out.insert(_out.end(), bytes, bytes+5);
+}
+
+void RTLTcpSource::watch(bool output) {
+  struct epoll_event ev;
+  ev.events = uint32_t(EPOLLIN) | (output ? uint32_t(EPOLLOUT) : 0);
+  ev.data.u64 = 0;
+  epoll_ctl(_epoll, EPOLL_CTL_MOD, _fd, &ev);
+}
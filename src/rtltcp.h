@@ -0,0 +1,178 @@
+#ifndef __SDR_RTLTCP_H__
+#define __SDR_RTLTCP_H__
+
+#include "buffer.h"
+#include <string>
+#include <map>
+#include <vector>
+
+namespace sdr {
+
+  // Network source for rtl_tcp servers.
+  //
+  // An rtl_tcp server sends a 12-byte header ("RTL0", tuner type and number
+  // of gain steps, big-endian) followed by an endless stream of interleaved
+  // unsigned 8-bit I/Q samples. The client tunes the device with 5-byte
+  // commands (command code and big-endian 32-bit argument).
+  //
+  // The socket is non-blocking and watched by epoll. When it is readable,
+  // poll() reads with readv() straight into the free spans of the ring (both
+  // sides of the wrap-around in one call) until the socket is drained or the
+  // ring is full, there is no intermediate buffer. Only complete I/Q pairs
+  // are committed to the ring. A closed connection or a stalled stream leads
+  // to a reconnect after a delay, the last value of every command is replayed
+  // to the new connection.
+  //
+  // The source is not thread-safe, call poll() from the thread consuming the
+  // ring.
+  class RTLTcpSource {
+    public:
+      // rtl_tcp commands
+      typedef enum {
+        SET_FREQUENCY = 0x01,       // Hz
+        SET_SAMPLE_RATE = 0x02,     // Hz
+        SET_GAIN_MODE = 0x03,       // 0: automatic, 1: manual
+        SET_GAIN = 0x04,            // tenth dB
+        SET_FREQ_CORRECTION = 0x05, // ppm
+        SET_IF_GAIN = 0x06,         // stage << 16 | tenth dB
+        SET_TEST_MODE = 0x07,       // 0/1
+        SET_AGC_MODE = 0x08,        // RTL2832 AGC, 0/1
+        SET_DIRECT_SAMPLING = 0x09, // 0: off, 1: I, 2: Q
+        SET_OFFSET_TUNING = 0x0a,   // 0/1
+        SET_RTL_XTAL = 0x0b,        // Hz
+        SET_TUNER_XTAL = 0x0c,      // Hz
+        SET_GAIN_BY_INDEX = 0x0d,   // index into the gain table
+        SET_BIAS_TEE = 0x0e         // 0/1
+      } Command;
+
+      // Connection state
+      typedef enum {
+        DISCONNECTED, // waiting for the next connection attempt
+        CONNECTING,   // connect in progress
+        HEADER,       // waiting for the header
+        STREAMING     // receiving samples
+      } State;
+
+    public:
+      // Constructor with server address, the ring receiving the samples, the
+      // time without data after which the stream is considered stalled and
+      // the delay between connection attempts (both in ms). The first
+      // connection attempt happens on the first poll().
+      RTLTcpSource(const std::string &host, uint16_t port, CircularBuffer<uint8_t> &ring,
+                   int stallTimeout=2000, int reconnectDelay=500);
+
+      // Destructor, closes the connection
+      virtual ~RTLTcpSource();
+
+      // Inline helper functions
+      // returns the connection state
+      inline State state() const { return _state; }
+      // returns true if samples are being received
+      inline bool isStreaming() const { return STREAMING == _state; }
+      // returns the tuner type reported by the server
+      inline uint32_t tunerType() const { return _tuner_type; }
+      // returns the number of gain steps reported by the server
+      inline uint32_t gainCount() const { return _gain_count; }
+      // returns the total number of bytes committed to the ring
+      inline uint64_t received() const { return _received; }
+      // returns the number of successful connections
+      inline size_t connections() const { return _connections; }
+      // returns the number of times the stream stalled (no data within the
+      // stall timeout, followed by a reconnect)
+      inline size_t stalls() const { return _stalls; }
+      // returns the number of reads that stopped because the ring was full
+      // (the server is throttled by TCP flow control)
+      inline size_t ringFull() const { return _ring_full; }
+
+      // Returns the name of a tuner type
+      static const char *tunerName(uint32_t type);
+
+      // Sends the command, the value is remembered and replayed after a
+      // reconnect. Returns false if there is no connection (the command is
+      // sent once connected).
+      bool command(Command cmd, uint32_t value);
+
+      // Tuning commands, see command()
+      inline bool setFrequency(uint32_t hz) { return command(SET_FREQUENCY, hz); }
+      inline bool setSampleRate(uint32_t hz) { return command(SET_SAMPLE_RATE, hz); }
+      inline bool setGainMode(bool manual) { return command(SET_GAIN_MODE, manual ? 1 : 0); }
+      inline bool setGain(int tenthDb) { return command(SET_GAIN, uint32_t(tenthDb)); }
+      inline bool setFreqCorrection(int ppm) { return command(SET_FREQ_CORRECTION, uint32_t(ppm)); }
+      inline bool setAGC(bool enable) { return command(SET_AGC_MODE, enable ? 1 : 0); }
+      inline bool setDirectSampling(int mode) { return command(SET_DIRECT_SAMPLING, uint32_t(mode)); }
+      inline bool setOffsetTuning(bool enable) { return command(SET_OFFSET_TUNING, enable ? 1 : 0); }
+      inline bool setBiasTee(bool enable) { return command(SET_BIAS_TEE, enable ? 1 : 0); }
+
+      // Waits up to timeout ms for the socket (<0: forever), handles
+      // (re)connects and reads all pending samples into the ring. Returns
+      // the number of bytes committed. Returns immediately if the ring is
+      // full.
+      size_t poll(int timeout);
+
+      // Closes the connection, the next poll() reconnects after the delay
+      void disconnect();
+
+    protected:
+      // starts a connection attempt
+      void connect();
+      // closes the connection and logs the reason
+      void drop(const char *reason);
+      // reads the header, returns true once complete and valid
+      bool readHeader();
+      // reads pending data into the ring, returns the bytes committed
+      size_t readData();
+      // sends queued commands
+      void flush();
+      // appends a command to the send queue
+      void queue(uint8_t cmd, uint32_t value);
+      // updates the events watched by epoll
+      void watch(bool output);
+
+    protected:
+      // server host name or address
+      std::string _host;
+      // server port
+      uint16_t _port;
+      // destination of the samples
+      CircularBuffer<uint8_t> &_ring;
+      // stall timeout in ms
+      int _stall_timeout;
+      // reconnect delay in ms
+      int _reconnect_delay;
+      // epoll instance
+      int _epoll;
+      // socket (-1 if disconnected)
+      int _fd;
+      // connection state
+      State _state;
+      // time of the next connection attempt (ms)
+      int64_t _retry_at;
+      // time of the last progress (ms)
+      int64_t _last_data;
+      // header received so far
+      uint8_t _header[12];
+      // header bytes received
+      size_t _header_len;
+      // bytes of an incomplete I/Q pair written behind the ring's write position
+      size_t _partial;
+      // commands not sent yet
+      std::vector<uint8_t> _out;
+      // last value of every command
+      std::map<uint8_t, uint32_t> _commands;
+      // tuner type
+      uint32_t _tuner_type;
+      // number of gain steps
+      uint32_t _gain_count;
+      // total bytes committed
+      uint64_t _received;
+      // successful connections
+      size_t _connections;
+      // stalled streams
+      size_t _stalls;
+      // reads stopped by a full ring
+      size_t _ring_full;
+  };
+
+}
+
+#endif
@@ -0,0 +1,246 @@
+#include "scheduler.h"
+#include "logger.h"
+#include <chrono>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace sdr;
+
+// Stage
+// Constructor
+Stage::Stage()
+  : _queued(false), _downstream(), _upstream()
+{}
+
+// Destructor
+Stage::~Stage() {}
+
+void Stage::connect(Stage *downstream) {
+  _downstream.push_back(downstream);
+  downstream->_upstream.push_back(this);
+}
+
+// Scheduler
+// Constructor
+Scheduler::Scheduler(size_t numWorkers, bool pin)
+  : _workers(), _stages(), _version(0), _running(false), _epoch(0), _sleepers(0), _stats_start(now())
+{
+  if (0 == numWorkers) { numWorkers = std::max(1u, std::thread::hardware_concurrency()); }
+  for (size_t i=0; i<numWorkers; i++) {
+    _workers.push_back(new Worker());
+  }
+  if (pin) {
+    unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i=0; i<numWorkers; i++) { _workers[i]->cpu = i % ncpu; }
+  }
+}
+
+// Destructor
+Scheduler::~Scheduler() {
+  stop();
+  for (size_t i=0; i<_workers.size(); i++) { delete _workers[i]; }
+  _workers.clear();
+}
+
+void Scheduler::add(Stage *stage) {
+  {
+    std::lock_guard<std::mutex> guard(_stages_lock);
+    _stages.push_back(stage);
+    _version++;
+  }
+  wake(true);
+}
+
+void Scheduler::setAffinity(const std::vector<int> &cpus) {
+  if (0 == cpus.size()) { return; }
+  for (size_t i=0; i<_workers.size(); i++) { _workers[i]->cpu = cpus[i % cpus.size()]; }
+}
+
+void Scheduler::start() {
+  if (_running.exchange(true)) { return; }
+  resetStats();
+  for (size_t i=0; i<_workers.size(); i++) {
+    _workers[i]->thread = std::thread(&Scheduler::run, this, i);
+#ifdef __linux__
+    if (0 <= _workers[i]->cpu) {
+      cpu_set_t set; CPU_ZERO(&set); CPU_SET(_workers[i]->cpu, &set);
+      if (pthread_setaffinity_np(_workers[i]->thread.native_handle(), sizeof(cpu_set_t), &set)) {
+        LogMessage msg(LOG_WARNING);
+        msg << "Scheduler: cannot bind worker " << i << " to CPU " << _workers[i]->cpu;
+        Logger::get().log(msg);
+      }
+    }
+#endif
+  }
+}
+
+void Scheduler::stop() {
+  if (! _running.exchange(false)) { return; }
+  notify();
+  for (size_t i=0; i<_workers.size(); i++) {
+    if (_workers[i]->thread.joinable()) { _workers[i]->thread.join(); }
+    // release stages left in the queues
+    std::lock_guard<std::mutex> guard(_workers[i]->lock);
+    for (size_t j=0; j<_workers[i]->queue.size(); j++) { _workers[i]->queue[j]->release(); }
+    _workers[i]->queue.clear();
+  }
+}
+
+void Scheduler::notify() {
+  wake(true);
+}
+
+void Scheduler::wake(bool all) {
+  // the epoch changes under the lock, hence a worker cannot miss it between
+  // checking it and going to sleep
+  std::lock_guard<std::mutex> guard(_idle_lock);
+  _epoch++;
+  if (all) { _idle.notify_all(); }
+  else { _idle.notify_one(); }
+}
+
+double Scheduler::utilization(size_t worker) const {
+  if (worker >= _workers.size()) { return 0; }
+  uint64_t period = now()-_stats_start.load();
+  if (0 == period) { return 0; }
+  return double(_workers[worker]->busy_ns.load())/period;
+}
+
+uint64_t Scheduler::processed(size_t worker) const {
+  if (worker >= _workers.size()) { return 0; }
+  return _workers[worker]->processed.load();
+}
+
+uint64_t Scheduler::stolen(size_t worker) const {
+  if (worker >= _workers.size()) { return 0; }
+  return _workers[worker]->stolen.load();
+}
+
+void Scheduler::resetStats() {
+  for (size_t i=0; i<_workers.size(); i++) {
+    _workers[i]->busy_ns = 0;
+    _workers[i]->processed = 0;
+    _workers[i]->stolen = 0;
+  }
+  _stats_start = now();
+}
+
+void Scheduler::logStats() const {
+  for (size_t i=0; i<_workers.size(); i++) {
+    LogMessage msg(LOG_INFO);
+    msg << "Scheduler: worker " << i << " utilization " << int(100*utilization(i)) << "%, "
+        << processed(i) << " processed, " << stolen(i) << " stolen";
+    Logger::get().log(msg);
+  }
+}
+
+void Scheduler::enqueue(size_t idx, Stage *stage) {
+  std::lock_guard<std::mutex> guard(_workers[idx]->lock);
+  _workers[idx]->queue.push_back(stage);
+}
+
+Stage *Scheduler::next(size_t idx) {
+  Worker *self = _workers[idx];
+  // own deque, newest first
+  {
+    std::lock_guard<std::mutex> guard(self->lock);
+    if (self->queue.size()) {
+      Stage *stage = self->queue.back();
+      self->queue.pop_back();
+      return stage;
+    }
+  }
+  // steal oldest from other workers
+  for (size_t i=1; i<_workers.size(); i++) {
+    Worker *victim = _workers[(idx+i) % _workers.size()];
+    std::lock_guard<std::mutex> guard(victim->lock);
+    if (victim->queue.size()) {
+      Stage *stage = victim->queue.front();
+      victim->queue.pop_front();
+      self->stolen++;
+      return stage;
+    }
+  }
+  // poll stages for readiness, starting at a worker specific offset (the
+  // snapshot is only updated if stages were added)
+  if (self->version != _version.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> guard(_stages_lock);
+    self->stages = _stages;
+    self->version = _version.load(std::memory_order_relaxed);
+  }
+  size_t N = self->stages.size();
+  for (size_t i=0; i<N; i++) {
+    Stage *stage = self->stages[(idx+i) % N];
+    if (stage->acquire()) {
+      if (stage->ready()) { return stage; }
+      stage->release();
+    }
+  }
+  return 0;
+}
+
+bool Scheduler::schedule(size_t idx, Stage *stage) {
+  if (! stage->acquire()) { return false; }
+  if (stage->ready()) { enqueue(idx, stage); return true; }
+  stage->release();
+  return false;
+}
+
+void Scheduler::run(size_t idx) {
+  Worker *self = _workers[idx];
+  unsigned backoff = MIN_BACKOFF;
+  while (_running.load(std::memory_order_acquire)) {
+    // stages queued after this point change the epoch
+    uint64_t epoch = _epoch.load(std::memory_order_acquire);
+    Stage *stage = next(idx);
+    if (0 == stage) {
+      // announce the sleeper, then look again: a worker queueing a stage
+      // after the second look sees the sleeper and wakes it up
+      _sleepers.fetch_add(1, std::memory_order_seq_cst);
+      stage = next(idx);
+      if (0 == stage) {
+        // nothing to do: wait for a queued stage or notification, poll
+        // again with increasing intervals
+        std::unique_lock<std::mutex> guard(_idle_lock);
+        if (_idle.wait_for(guard, std::chrono::microseconds(backoff), [this, epoch]() {
+              return (epoch != _epoch.load(std::memory_order_relaxed)) || (! isRunning()); })) {
+          backoff = MIN_BACKOFF;
+        } else {
+          backoff = std::min(2*backoff, unsigned(MAX_BACKOFF));
+        }
+      }
+      _sleepers.fetch_sub(1, std::memory_order_seq_cst);
+      if (0 == stage) { continue; }
+    }
+    backoff = MIN_BACKOFF;
+    // queued stages may have lost their readiness in the meantime
+    if (! stage->ready()) { stage->release(); continue; }
+    uint64_t start = now();
+    stage->process();
+    self->busy_ns += now()-start;
+    self->processed++;
+    stage->release();
+    // queue downstream stages on this worker, upstream stages (which may
+    // have space now), then the stage itself
+    bool queued = false;
+    for (size_t i=0; i<stage->_downstream.size(); i++) {
+      queued = schedule(idx, stage->_downstream[i]) || queued;
+    }
+    for (size_t i=0; i<stage->_upstream.size(); i++) {
+      queued = schedule(idx, stage->_upstream[i]) || queued;
+    }
+    queued = schedule(idx, stage) || queued;
+    if (queued && (_workers.size() > 1)) {
+      // pairs with the second look of a worker going to sleep
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (0 < _sleepers.load(std::memory_order_relaxed)) { wake(false); }
+    }
+  }
+}
+
+uint64_t Scheduler::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
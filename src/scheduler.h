@@ -0,0 +1,184 @@
+#ifndef __SDR_SCHEDULER_H__
+#define __SDR_SCHEDULER_H__
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <inttypes.h>
+
+namespace sdr {
+
+  // A processing stage executed by the Scheduler.
+  //
+  // A stage is ready if it has input available and space for its output.
+  // The scheduler guarantees that ready() and process() of a stage are never
+  // called by two workers at the same time, but a producer and its consumer
+  // may run concurrently. Buffers shared between stages must therefore be
+  // safe for one writer and one reader in different threads (e.g.
+  // BroadcastBuffer) or be protected by the stages themselves.
+  class Stage {
+    public:
+      // Constructor
+      Stage();
+
+      // Destructor
+      virtual ~Stage();
+
+      // Needs to be implemented by sub-classes: returns true if input is
+      // available and there is space for the output
+      virtual bool ready() const = 0;
+
+      // Needs to be implemented by sub-classes: processes one block
+      virtual void process() = 0;
+
+      // Registers a downstream stage, it is checked for readiness (and
+      // preferably run on the same worker) after this stage was processed,
+      // and this stage after the downstream stage was processed (it may have
+      // freed space)
+      void connect(Stage *downstream);
+
+    protected:
+      // marks the stage as queued or running, returns false if it already was
+      inline bool acquire() { return ! _queued.exchange(true, std::memory_order_acq_rel); }
+      // marks the stage as idle
+      inline void release() { _queued.store(false, std::memory_order_release); }
+
+    protected:
+      // true if the stage is queued or being processed
+      std::atomic<bool> _queued;
+      // downstream stages
+      std::vector<Stage *> _downstream;
+      // upstream stages
+      std::vector<Stage *> _upstream;
+
+      friend class Scheduler;
+  };
+
+
+  // Executes stages on a pool of worker threads.
+  //
+  // Each worker has its own deque of ready stage invocations. A worker takes
+  // the newest invocation from its own deque, steals the oldest from other
+  // workers if it has none and polls the registered stages for readiness if
+  // there is nothing to steal. The deques are std::deque behind a mutex per
+  // worker (not lock-free), which is only contended while stealing. After a stage was processed, the stage, its
+  // downstream and its upstream stages are queued on the same worker if they
+  // became ready. Idle workers sleep until a stage was queued or notify() was
+  // called, a worker queueing a stage only takes the wake-up lock if one of
+  // them sleeps. Stages that become ready by other means are found by polling with
+  // exponential backoff (MIN_BACKOFF to MAX_BACKOFF us), each worker scans
+  // its own snapshot of the stages without locking.
+  class Scheduler {
+    public:
+      // Constructor with number of workers (0: one per hardware thread). If
+      // pin is true, worker i is bound to CPU i (modulo number of CPUs).
+      Scheduler(size_t numWorkers=0, bool pin=false);
+
+      // Destructor, stops the workers
+      virtual ~Scheduler();
+
+      // Adds a stage (not owned by the scheduler), stages can be added while running
+      void add(Stage *stage);
+
+      // Binds the workers to the given CPUs (worker i to cpus[i % cpus.size()]),
+      // takes effect with the next start()
+      void setAffinity(const std::vector<int> &cpus);
+
+      // Starts the workers
+      void start();
+
+      // Stops the workers, returns once all of them finished
+      void stop();
+
+      // Returns true if the workers are running
+      inline bool isRunning() const { return _running.load(std::memory_order_acquire); }
+
+      // Wakes up idle workers, call after external data became available
+      void notify();
+
+      // STATISTICS
+      // Returns the number of workers
+      inline size_t numWorkers() const { return _workers.size(); }
+      // Returns the fraction of time the worker spent processing (0..1) since
+      // the start or the last call to resetStats()
+      double utilization(size_t worker) const;
+      // Returns the number of stage invocations processed by the worker
+      uint64_t processed(size_t worker) const;
+      // Returns the number of stage invocations stolen by the worker
+      uint64_t stolen(size_t worker) const;
+      // Resets the statistics
+      void resetStats();
+      // Reports the per-worker statistics through the Logger
+      void logStats() const;
+
+    protected:
+      // State of a worker
+      struct Worker {
+        Worker() : cpu(-1), busy_ns(0), processed(0), stolen(0), stages(), version(0) {}
+        // the thread
+        std::thread thread;
+        // deque of ready stages
+        std::deque<Stage *> queue;
+        // protects the deque
+        std::mutex lock;
+        // CPU to bind to (-1: none)
+        int cpu;
+        // time spent in Stage::process()
+        std::atomic<uint64_t> busy_ns;
+        // number of processed invocations
+        std::atomic<uint64_t> processed;
+        // number of stolen invocations
+        std::atomic<uint64_t> stolen;
+        // snapshot of the registered stages, polled without locking
+        std::vector<Stage *> stages;
+        // version of the snapshot
+        uint64_t version;
+      };
+
+      // shortest and longest poll interval of idle workers in us
+      static const unsigned MIN_BACKOFF = 500;
+      static const unsigned MAX_BACKOFF = 32000;
+
+      // main loop of a worker
+      void run(size_t idx);
+      // pushes the stage to the back of the worker's deque
+      void enqueue(size_t idx, Stage *stage);
+      // queues the stage on the worker if it is ready, returns true if queued
+      bool schedule(size_t idx, Stage *stage);
+      // wakes up idle workers (all or one)
+      void wake(bool all);
+      // takes a stage from the worker's deque, steals from other workers or
+      // polls the stages for readiness; returns 0 if none is ready
+      Stage *next(size_t idx);
+      // returns the current time in ns
+      static uint64_t now();
+
+    protected:
+      // workers
+      std::vector<Worker *> _workers;
+      // registered stages
+      std::vector<Stage *> _stages;
+      // protects the list of stages
+      std::mutex _stages_lock;
+      // incremented whenever the list of stages changes
+      std::atomic<uint64_t> _version;
+      // running flag
+      std::atomic<bool> _running;
+      // wake-up of idle workers
+      std::mutex _idle_lock;
+      std::condition_variable _idle;
+      // incremented (under _idle_lock) whenever stages were queued while
+      // workers sleep or notify() was called, idle workers wait for a change
+      std::atomic<uint64_t> _epoch;
+      // number of workers going to sleep or sleeping
+      std::atomic<size_t> _sleepers;
+      // start of the statistics period
+      std::atomic<uint64_t> _stats_start;
+  };
+
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "shmring.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+
+using namespace sdr;
+
+// identifies an initialized segment ("SDRR")
+static const uint32_t SHARED_RING_MAGIC = 0x52524453;
+static const uint32_t SHARED_RING_VERSION = 1;
+
+// rounds up to a multiple of the page size
+static size_t pageAlign(size_t n) {
+  size_t page = size_t(sysconf(_SC_PAGESIZE));
+  return ((n+page-1)/page)*page;
+}
+
+
+// Common mapping
+// Constructor
+SharedRing::SharedRing(const std::string &name)
+  : _name(name), _header_size(pageAlign(sizeof(SharedRingHeader))), _header(0), _data(0)
+{}
+
+// Destructor
+SharedRing::~SharedRing() {
+  if (_data) { munmap(_data, 2*_header->capacity); }
+  if (_header) { munmap(_header, _header_size); }
+}
+
+bool SharedRing::map(int fd, size_t capacity, bool writable) {
+  int prot = writable ? (PROT_READ|PROT_WRITE) : PROT_READ;
+  // the header is always writable (cursors, futex words)
+  void *header = mmap(0, _header_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if (MAP_FAILED == header) { return false; }
+  // reserve twice the capacity, then map the data region into both halves
+  char *data = (char *)mmap(0, 2*capacity, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == (void *)data) { munmap(header, _header_size); return false; }
+  if ((MAP_FAILED == mmap(data, capacity, prot, MAP_SHARED|MAP_FIXED, fd, _header_size)) ||
+      (MAP_FAILED == mmap(data+capacity, capacity, prot, MAP_SHARED|MAP_FIXED, fd, _header_size))) {
+    munmap(data, 2*capacity); munmap(header, _header_size);
+    return false;
+  }
+  _header = (SharedRingHeader *)header;
+  _data = data;
+  return true;
+}
+
+void SharedRing::wait(std::atomic<uint32_t> &word, uint32_t value, int timeout) {
+  struct timespec ts, *pts = 0;
+  if (0 <= timeout) {
+    ts.tv_sec = timeout/1000; ts.tv_nsec = long(timeout%1000)*1000000L;
+    pts = &ts;
+  }
+  // not FUTEX_PRIVATE: the word is shared between processes
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, value, pts, 0, 0);
+}
+
+void SharedRing::wake(std::atomic<uint32_t> &word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, 0, 0, 0);
+}
+
+
+// Writer
+// Constructor
+SharedCircularBuffer::SharedCircularBuffer(const std::string &name, size_t capacity, uint32_t format, size_t element)
+  : SharedRing(name), _reserved(0)
+{
+  capacity = pageAlign(std::max(size_t(1), capacity));
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_RDWR|O_CREAT|O_EXCL, 0600);
+  if (fd < 0) { return; }
+  if ((0 != ftruncate(fd, _header_size+capacity)) || (! map(fd, capacity, true))) {
+    ::close(fd); shm_unlink(name.c_str());
+    return;
+  }
+  ::close(fd);
+  // the segment is zero filled: cursors, counters and slots start at 0
+  _header->capacity = capacity;
+  _header->format = format;
+  _header->element = uint32_t(element);
+  _header->version = SHARED_RING_VERSION;
+  // readers check the magic last
+  __atomic_store_n(&_header->magic, SHARED_RING_MAGIC, __ATOMIC_RELEASE);
+}
+
+// Destructor
+SharedCircularBuffer::~SharedCircularBuffer() {
+  if (_header) {
+    close();
+    shm_unlink(_name.c_str());
+  }
+}
+
+size_t SharedCircularBuffer::bytesFree() const {
+  if (! _header) { return 0; }
+  uint64_t put = _header->put.load(std::memory_order_relaxed), oldest = put;
+  for (size_t i=0; i<SharedRingHeader::MAX_READERS; i++) {
+    if (_header->readers[i].active.load(std::memory_order_acquire)) {
+      uint64_t take = _header->readers[i].take.load(std::memory_order_acquire);
+      if (take < oldest) { oldest = take; }
+    }
+  }
+  // a reader attaching right now may still show a stale cursor
+  if ((put-oldest) > _header->capacity) { return 0; }
+  return _header->capacity - size_t(put-oldest);
+}
+
+size_t SharedCircularBuffer::readers() const {
+  size_t n = 0;
+  for (size_t i=0; _header && (i<SharedRingHeader::MAX_READERS); i++) {
+    n += _header->readers[i].active.load(std::memory_order_relaxed) ? 1 : 0;
+  }
+  return n;
+}
+
+bool SharedCircularBuffer::push(const RawBuffer &data) {
+  RawBuffer view = reserve(data.bytesLen());
+  if (view.isEmpty()) { return 0 == data.bytesLen(); }
+  std::memcpy(view.data(), data.data(), data.bytesLen());
+  commit(data.bytesLen());
+  return true;
+}
+
+RawBuffer SharedCircularBuffer::reserve(size_t N) {
+  _reserved = 0;
+  if ((0 == N) || (bytesFree() < N)) { return RawBuffer(); }
+  _reserved = N;
+  size_t index = size_t(_header->put.load(std::memory_order_relaxed) % _header->capacity);
+  // contiguous thanks to the mirrored mapping
+  return RawBuffer(_data+index, 0, N);
+}
+
+size_t SharedCircularBuffer::commit(size_t N) {
+  if (! _header) { return 0; }
+  // never publish over unread data
+  N = std::min(N, std::min(_reserved, bytesFree()));
+  if (0 == N) { return 0; }
+  _reserved -= N;
+  _header->put.fetch_add(N, std::memory_order_release);
+  _header->data_seq.fetch_add(1, std::memory_order_seq_cst);
+  if (_header->data_waiters.load(std::memory_order_seq_cst)) { wake(_header->data_seq); }
+  return N;
+}
+
+bool SharedCircularBuffer::waitWritable(size_t N, int timeout) {
+  if ((! _header) || (N > _header->capacity)) { return false; }
+  for (;;) {
+    uint32_t seq = _header->space_seq.load(std::memory_order_seq_cst);
+    if (bytesFree() >= N) { return true; }
+    _header->space_waiters.fetch_add(1, std::memory_order_seq_cst);
+    if (bytesFree() < N) { wait(_header->space_seq, seq, timeout); }
+    _header->space_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    if ((0 <= timeout) && (bytesFree() < N)) { return false; }
+  }
+}
+
+void SharedCircularBuffer::close() {
+  if (! _header) { return; }
+  _header->closed.store(1, std::memory_order_release);
+  _header->data_seq.fetch_add(1, std::memory_order_seq_cst);
+  wake(_header->data_seq);
+}
+
+void SharedCircularBuffer::detach(size_t reader) {
+  if ((! _header) || (reader >= SharedRingHeader::MAX_READERS)) { return; }
+  _header->readers[reader].active.store(0, std::memory_order_release);
+}
+
+
+// Reader
+// Constructor
+SharedCircularReader::SharedCircularReader(const std::string &name)
+  : SharedRing(name), _slot(0)
+{
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) { return; }
+  // the header tells the capacity
+  struct stat st;
+  SharedRingHeader *header = 0;
+  if ((0 == fstat(fd, &st)) && (size_t(st.st_size) > _header_size)) {
+    void *ptr = mmap(0, _header_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED != ptr) { header = (SharedRingHeader *)ptr; }
+  }
+  bool valid = header && (SHARED_RING_MAGIC == __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE)) &&
+      (SHARED_RING_VERSION == header->version) && ((_header_size+header->capacity) == size_t(st.st_size));
+  size_t capacity = valid ? header->capacity : 0;
+  if (header) { munmap(header, _header_size); }
+  if ((! valid) || (! map(fd, capacity, false))) { ::close(fd); return; }
+  ::close(fd);
+  // claim a free slot, starting at the current write position
+  for (_slot=0; _slot<SharedRingHeader::MAX_READERS; _slot++) {
+    uint32_t expected = 0;
+    SharedRingHeader::Slot &slot = _header->readers[_slot];
+    if (slot.active.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+      // until the cursor is set, the writer sees an older (zero or stale)
+      // cursor and assumes the ring is full
+      slot.take.store(_header->put.load(std::memory_order_acquire), std::memory_order_release);
+      return;
+    }
+  }
+  // no free slot
+  munmap(_data, 2*_header->capacity); munmap(_header, _header_size);
+  _data = 0; _header = 0;
+}
+
+// Destructor
+SharedCircularReader::~SharedCircularReader() {
+  if (_header) {
+    _header->readers[_slot].active.store(0, std::memory_order_release);
+    // the writer may be waiting for this reader
+    _header->space_seq.fetch_add(1, std::memory_order_seq_cst);
+    if (_header->space_waiters.load(std::memory_order_seq_cst)) { wake(_header->space_seq); }
+  }
+}
+
+size_t SharedCircularReader::bytesLen() const {
+  if (! _header) { return 0; }
+  return size_t(_header->put.load(std::memory_order_acquire) -
+                _header->readers[_slot].take.load(std::memory_order_relaxed));
+}
+
+RawBuffer SharedCircularReader::peek() const {
+  size_t N = bytesLen();
+  if (0 == N) { return RawBuffer(); }
+  size_t index = size_t(_header->readers[_slot].take.load(std::memory_order_relaxed) % _header->capacity);
+  return RawBuffer(_data+index, 0, N);
+}
+
+void SharedCircularReader::drop(size_t N) {
+  if (! _header) { return; }
+  N = std::min(N, bytesLen());
+  _header->readers[_slot].take.fetch_add(N, std::memory_order_release);
+  _header->space_seq.fetch_add(1, std::memory_order_seq_cst);
+  if (_header->space_waiters.load(std::memory_order_seq_cst)) { wake(_header->space_seq); }
+}
+
+bool SharedCircularReader::waitReadable(size_t N, int timeout) {
+  if (! _header) { return false; }
+  for (;;) {
+    uint32_t seq = _header->data_seq.load(std::memory_order_seq_cst);
+    if (bytesLen() >= N) { return true; }
+    if (closed()) { return false; }
+    _header->data_waiters.fetch_add(1, std::memory_order_seq_cst);
+    if (bytesLen() < N) { wait(_header->data_seq, seq, timeout); }
+    _header->data_waiters.fetch_sub(1, std::memory_order_seq_cst);
+    if ((0 <= timeout) && (bytesLen() < N)) { return false; }
+  }
+}
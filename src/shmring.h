@@ -0,0 +1,200 @@
+#ifndef __SDR_SHMRING_H__
+#define __SDR_SHMRING_H__
+
+#include "buffer.h"
+#include <atomic>
+#include <string>
+
+namespace sdr {
+
+  // Cross-process ring buffer in a named POSIX shared memory segment.
+  //
+  // One writer process creates the segment (SharedCircularBuffer), reader
+  // processes attach by name (SharedCircularReader). Every reader has its
+  // own read cursor in the process-shared header, the writer reclaims space
+  // once all attached readers have dropped it (the slowest reader blocks the
+  // writer, as BroadcastBuffer::WAIT_FOR_SLOWEST).
+  //
+  // The data region is mapped twice back to back, hence every span of up to
+  // the capacity is contiguous in memory and readers get zero-copy views
+  // without wrap-around splits. Readers map the data read-only: writing into
+  // their views faults. Waiting for data (readers) or space (writer) uses a
+  // process-shared futex, the writer only enters the kernel if a peer waits.
+  //
+  // A reader process that dies without detaching keeps its slot and stalls
+  // the writer; the writer may release it with detach().
+
+  // Process-shared header at the start of the segment
+  struct SharedRingHeader {
+    // maximum number of readers
+    static const size_t MAX_READERS = 16;
+
+    // A reader slot
+    struct Slot {
+      // slot is in use
+      std::atomic<uint32_t> active;
+      // read cursor (total number of bytes consumed)
+      std::atomic<uint64_t> take;
+    };
+
+    // identifies an initialized segment
+    uint32_t magic;
+    // layout version
+    uint32_t version;
+    // capacity of the ring in bytes (multiple of the page size)
+    uint64_t capacity;
+    // sample format, defined by the application
+    uint32_t format;
+    // size of a sample in bytes
+    uint32_t element;
+    // write cursor (total number of bytes written)
+    std::atomic<uint64_t> put;
+    // futex word, incremented when data was written
+    std::atomic<uint32_t> data_seq;
+    // futex word, incremented when a reader dropped data
+    std::atomic<uint32_t> space_seq;
+    // number of processes waiting on data_seq
+    std::atomic<uint32_t> data_waiters;
+    // number of processes waiting on space_seq
+    std::atomic<uint32_t> space_waiters;
+    // set by the writer when the stream ends
+    std::atomic<uint32_t> closed;
+    // reader slots
+    Slot readers[MAX_READERS];
+  };
+
+
+  // Common mapping of the writer and the readers
+  class SharedRing {
+    public:
+      // Destructor, unmaps the segment
+      virtual ~SharedRing();
+
+      // Inline helper functions
+      // returns true if the segment is mapped
+      inline bool isOpen() const { return 0 != _header; }
+      // returns the segment name
+      inline const std::string &name() const { return _name; }
+      // returns the capacity in bytes
+      inline size_t capacity() const { return _header ? _header->capacity : 0; }
+      // returns the sample format
+      inline uint32_t format() const { return _header ? _header->format : 0; }
+      // returns the sample size in bytes
+      inline size_t element() const { return _header ? _header->element : 0; }
+      // returns the total number of bytes written
+      inline uint64_t written() const { return _header ? _header->put.load(std::memory_order_acquire) : 0; }
+      // returns true if the writer closed the stream
+      inline bool closed() const { return _header && _header->closed.load(std::memory_order_acquire); }
+
+      // Mappings cannot be copied
+      SharedRing(const SharedRing &other) = delete;
+      SharedRing &operator=(const SharedRing &other) = delete;
+
+    protected:
+      // Constructor, no mapping yet
+      SharedRing(const std::string &name);
+      // maps header and mirrored data of the open segment, returns false on error
+      bool map(int fd, size_t capacity, bool writable);
+      // waits until the futex word changes from value (timeout in ms, <0: forever)
+      static void wait(std::atomic<uint32_t> &word, uint32_t value, int timeout);
+      // wakes all processes waiting on the futex word
+      static void wake(std::atomic<uint32_t> &word);
+
+    protected:
+      // segment name
+      std::string _name;
+      // size of the header mapping
+      size_t _header_size;
+      // the header
+      SharedRingHeader *_header;
+      // start of the mirrored data region (2*capacity)
+      char *_data;
+  };
+
+
+  // Writer side: creates the segment
+  class SharedCircularBuffer: public SharedRing {
+    public:
+      // Constructor, creates (or replaces) the segment with the given name
+      // (e.g. "/sdr-capture"), capacity in bytes (rounded up to pages),
+      // application-defined format and sample size
+      SharedCircularBuffer(const std::string &name, size_t capacity, uint32_t format=0, size_t element=1);
+
+      // Destructor, closes the stream and removes the name (attached readers
+      // keep their mapping)
+      virtual ~SharedCircularBuffer();
+
+      // Returns the number of free bytes (limited by the slowest reader)
+      size_t bytesFree() const;
+      // Returns the number of attached readers
+      size_t readers() const;
+
+      // Copies the data into the ring, returns false if there is not enough
+      // space
+      bool push(const RawBuffer &data);
+
+      // Returns a writable view of N bytes at the write position (empty if
+      // not enough space), e.g. for reading from a device directly into the
+      // ring. The data becomes visible to the readers with commit(N).
+      RawBuffer reserve(size_t N);
+      // Publishes N bytes written into the reserved view, N is limited to
+      // the part of the last reserve() not committed yet. Returns the number
+      // of bytes published.
+      size_t commit(size_t N);
+
+      // Waits until at least N bytes are free, returns false on timeout (ms,
+      // <0: forever)
+      bool waitWritable(size_t N, int timeout=-1);
+
+      // Marks the end of the stream, readers waiting for data return
+      void close();
+
+      // Releases the slot of a (dead) reader
+      void detach(size_t reader);
+
+    protected:
+      // bytes reserved but not committed yet
+      size_t _reserved;
+  };
+
+
+  // Reader side: attaches to an existing segment
+  class SharedCircularReader: public SharedRing {
+    public:
+      // Constructor, attaches to the segment with the given name and
+      // registers a reader slot starting at the current write position (see
+      // isOpen())
+      SharedCircularReader(const std::string &name);
+
+      // Destructor, releases the reader slot
+      virtual ~SharedCircularReader();
+
+      // Returns the reader slot
+      inline size_t slot() const { return _slot; }
+      // Returns the number of bytes available to this reader
+      size_t bytesLen() const;
+
+      // Returns a read-only, zero-copy view of all available bytes
+      RawBuffer peek() const;
+      // Returns a zero-copy view of all available complete samples of type T
+      template <class T>
+      inline Buffer<T> peek() const {
+        RawBuffer raw = peek();
+        return Buffer<T>(reinterpret_cast<T *>(raw.data()), raw.bytesLen()/sizeof(T));
+      }
+
+      // Releases N bytes, the views of them become invalid
+      void drop(size_t N);
+
+      // Waits until at least N bytes are available, returns false on timeout
+      // (ms, <0: forever) or if the stream was closed with less data
+      bool waitReadable(size_t N, int timeout=-1);
+
+    protected:
+      // reader slot in the header
+      size_t _slot;
+  };
+
+}
+
+#endif
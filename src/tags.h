@@ -0,0 +1,379 @@
+#ifndef __SDR_TAGS_H__
+#define __SDR_TAGS_H__
+
+#include "buffer.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <algorithm>
+
+namespace sdr {
+
+  // Stream tags: sparse metadata attached to absolute sample offsets.
+  //
+  // A tag marks the sample at which something happened (retune, gain change,
+  // overrun, ...) with a key and a small value. Tags travel next to the
+  // samples instead of in-band: a TaggedBuffer is a view of samples with the
+  // absolute offset of its first sample and a shared, sorted set of tags,
+  // sub() views select the tags in their range without copying. The
+  // TaggedCircularBuffer moves tags along with its read and write cursors
+  // and TagRateChange maps them through decimation and resampling.
+  //
+  // Blocks without tags carry an empty set (no allocation), every query on
+  // them returns immediately.
+
+  // Well-known tag keys, applications use keys from TAG_USER on
+  typedef enum {
+    TAG_FREQUENCY = 1,   // center frequency in Hz
+    TAG_SAMPLE_RATE = 2, // sample rate in Hz
+    TAG_GAIN = 3,        // gain in dB
+    TAG_TIME = 4,        // time of the sample in s
+    TAG_OVERRUN = 5,     // samples were lost before this one (value: count)
+    TAG_USER = 0x100
+  } TagKey;
+
+  // A tag
+  struct Tag {
+    // Constructor
+    Tag(uint64_t offset=0, uint32_t key=0, double value=0) : offset(offset), key(key), value(value) {}
+
+    // absolute sample offset in the stream
+    uint64_t offset;
+    // key (see TagKey)
+    uint32_t key;
+    // value
+    double value;
+  };
+
+  // returns true if tag a is located before tag b
+  inline bool tagBefore(const Tag &a, const Tag &b) { return a.offset < b.offset; }
+
+
+  // A contiguous range of sorted tags
+  class TagRange {
+    public:
+      // Empty constructor
+      TagRange() : _begin(0), _end(0) {}
+      // Constructor from a range of tags
+      TagRange(const Tag *begin, const Tag *end) : _begin(begin), _end(end) {}
+
+      // Inline helper functions
+      // returns the first tag
+      inline const Tag *begin() const { return _begin; }
+      // returns the end of the range
+      inline const Tag *end() const { return _end; }
+      // returns the number of tags
+      inline size_t size() const { return size_t(_end-_begin); }
+      // returns true if there are no tags
+      inline bool empty() const { return _begin == _end; }
+      // returns tag i
+      inline const Tag &operator[] (size_t i) const { return _begin[i]; }
+
+    protected:
+      // first tag
+      const Tag *_begin;
+      // end of the range
+      const Tag *_end;
+  };
+
+
+  // An immutable, sorted set of tags shared between views
+  class TagSet {
+    public:
+      // Empty constructor, no storage
+      TagSet() : _tags() {}
+
+      // Constructor from tags (sorted by offset, the order of tags at the
+      // same offset is kept)
+      TagSet(std::vector<Tag> tags) : _tags() {
+        if (tags.empty()) { return; }
+        std::stable_sort(tags.begin(), tags.end(), tagBefore);
+        _tags = std::make_shared< const std::vector<Tag> >(std::move(tags));
+      }
+
+      // Inline helper functions
+      // returns the number of tags
+      inline size_t size() const { return _tags ? _tags->size() : 0; }
+      // returns true if there are no tags
+      inline bool empty() const { return ! _tags; }
+      // returns all tags
+      inline TagRange all() const {
+        if (! _tags) { return TagRange(); }
+        return TagRange(_tags->data(), _tags->data()+_tags->size());
+      }
+
+      // Returns the tags with offsets in [begin, end)
+      TagRange range(uint64_t begin, uint64_t end) const {
+        if (! _tags) { return TagRange(); }
+        const Tag *first = _tags->data(), *last = first+_tags->size();
+        const Tag *a = std::lower_bound(first, last, Tag(begin), tagBefore);
+        const Tag *b = std::lower_bound(a, last, Tag(end), tagBefore);
+        return TagRange(a, b);
+      }
+
+    protected:
+      // shared storage, null if there are no tags
+      std::shared_ptr< const std::vector<Tag> > _tags;
+  };
+
+
+  // A view of samples at an absolute stream offset with their tags
+  template <class T>
+  class TaggedBuffer {
+    public:
+      // Empty constructor
+      TaggedBuffer() : _samples(), _offset(0), _tags() {}
+
+      // Constructor from samples, the absolute offset of the first sample and
+      // the tags (may cover more than the samples)
+      TaggedBuffer(const Buffer<T> &samples, uint64_t offset, const TagSet &tags=TagSet())
+        : _samples(samples), _offset(offset), _tags(tags) {}
+
+      // Destructor
+      virtual ~TaggedBuffer() {}
+
+      // Inline helper functions
+      // returns the samples
+      inline const Buffer<T> &samples() const { return _samples; }
+      // returns the absolute offset of the first sample
+      inline uint64_t offset() const { return _offset; }
+      // returns the number of samples
+      inline size_t size() const { return _samples.size(); }
+      // returns the shared tag set
+      inline const TagSet &tagSet() const { return _tags; }
+      // returns the tags of the samples in this view
+      inline TagRange tags() const { return _tags.range(_offset, _offset+_samples.size()); }
+      // returns true if a sample of this view is tagged
+      inline bool hasTags() const { return (! _tags.empty()) && (! tags().empty()); }
+      // returns the index of a tag relative to the first sample
+      inline size_t index(const Tag &tag) const { return size_t(tag.offset-_offset); }
+      // returns sample i
+      inline T &operator[] (int i) const { return _samples[i]; }
+
+      // Return new view, keeps the tags in its range
+      inline TaggedBuffer<T> sub(size_t offset, size_t len) const {
+        if ((offset+len) > size()) { return TaggedBuffer<T>(); }
+        return TaggedBuffer<T>(_samples.sub(offset, len), _offset+offset, _tags);
+      }
+      // Return head view
+      inline TaggedBuffer<T> head(size_t n) const { return (n > size()) ? TaggedBuffer<T>() : sub(0, n); }
+      // Return tail view
+      inline TaggedBuffer<T> tail(size_t n) const { return (n > size()) ? TaggedBuffer<T>() : sub(size()-n, n); }
+
+    protected:
+      // samples
+      Buffer<T> _samples;
+      // absolute offset of the first sample
+      uint64_t _offset;
+      // tags
+      TagSet _tags;
+  };
+
+
+  // A circular buffer with absolute read and write cursors and a queue of
+  // tags between them. Tags of consumed samples are discarded. If samples
+  // are overwritten (overwrite mode), their tags move to the oldest
+  // remaining sample, followed by a TAG_OVERRUN tag with the number of lost
+  // samples. Use the functions of this class (not those of the base) to keep
+  // the tags in sync.
+  template <class Scalar>
+  class TaggedCircularBuffer: public CircularBuffer<Scalar> {
+    public:
+      // Empty constructor
+      TaggedCircularBuffer() : CircularBuffer<Scalar>(), _written(0), _taken(0), _tags() {}
+
+      // Construct from size N, optionally in overwrite mode
+      TaggedCircularBuffer(size_t N, bool overwrite=false)
+        : CircularBuffer<Scalar>(N, overwrite), _written(0), _taken(0), _tags() {}
+
+      // Destructor
+      virtual ~TaggedCircularBuffer() {}
+
+      // Inline helper functions
+      // returns the absolute offset of the next sample pushed
+      inline uint64_t written() const { return _written; }
+      // returns the absolute offset of the oldest stored sample
+      inline uint64_t taken() const { return _taken; }
+      // returns the number of tags of the stored samples
+      inline size_t pendingTags() const { return _tags.size(); }
+
+      // Tags the next sample pushed
+      inline void tag(uint32_t key, double value) { addTag(Tag(_written, key, value)); }
+
+      // Adds a tag at an absolute offset, returns false if the sample was
+      // already consumed
+      bool addTag(const Tag &tag) {
+        if (tag.offset < _taken) { return false; }
+        if (_tags.empty() || (_tags.back().offset <= tag.offset)) { _tags.push_back(tag); }
+        else { _tags.insert(std::upper_bound(_tags.begin(), _tags.end(), tag, tagBefore), tag); }
+        return true;
+      }
+
+      // Returns the tags of the next N samples
+      TagSet tags(size_t N) const {
+        if (_tags.empty() || (_tags.front().offset >= (_taken+N))) { return TagSet(); }
+        std::vector<Tag> result;
+        for (size_t i=0; (i<_tags.size()) && (_tags[i].offset < (_taken+N)); i++) { result.push_back(_tags[i]); }
+        return TagSet(std::move(result));
+      }
+
+      // push samples, returns false if they do not fit (see CircularBuffer)
+      inline bool push(const Buffer<Scalar> &data) {
+        if (! CircularBuffer<Scalar>::push(data)) { return false; }
+        _written += data.size();
+        overrun();
+        return true;
+      }
+
+      // push tagged samples, their tags are moved to the write position
+      bool push(const TaggedBuffer<Scalar> &block) {
+        if ((! this->overwrite()) && (block.size() > this->free())) { return false; }
+        TagRange range = block.tags();
+        for (const Tag *t=range.begin(); t!=range.end(); t++) {
+          addTag(Tag(_written+block.index(*t), t->key, t->value));
+        }
+        return push(block.samples());
+      }
+
+      // pull N samples into dest, their tags are discarded
+      inline bool pull(const Buffer<Scalar> &dest, size_t N) {
+        if (! CircularBuffer<Scalar>::pull(dest, N)) { return false; }
+        consume(N);
+        return true;
+      }
+
+      // pull N samples into dest, returns a view of them with their tags
+      // (empty if the pull failed)
+      TaggedBuffer<Scalar> pullTagged(const Buffer<Scalar> &dest, size_t N) {
+        uint64_t offset = _taken;
+        TagSet set = tags(N);
+        if (! pull(dest, N)) { return TaggedBuffer<Scalar>(); }
+        return TaggedBuffer<Scalar>(dest.head(N), offset, set);
+      }
+
+      // delete N elements from buffer with their tags
+      inline void drop(size_t N) {
+        N = std::min(N, this->stored());
+        CircularBuffer<Scalar>::drop(N);
+        consume(N);
+      }
+
+      // makes N elements written into the free spans readable
+      inline void commit(size_t N) {
+        size_t before = this->stored();
+        CircularBuffer<Scalar>::commit(N);
+        _written += this->stored()-before;
+      }
+
+    protected:
+      // advances the read cursor, discards the tags of consumed samples
+      inline void consume(size_t N) {
+        _taken += N;
+        while ((! _tags.empty()) && (_tags.front().offset < _taken)) { _tags.pop_front(); }
+      }
+
+      // moves the read cursor past overwritten samples
+      inline void overrun() {
+        uint64_t oldest = _written - this->stored();
+        if (oldest <= _taken) { return; }
+        Tag lost(oldest, TAG_OVERRUN, double(oldest-_taken));
+        // tags of lost samples stay valid for the following ones, earlier
+        // unread overruns add up
+        std::deque<Tag> moved;
+        while ((! _tags.empty()) && (_tags.front().offset < oldest)) {
+          Tag tag = _tags.front(); _tags.pop_front();
+          if (TAG_OVERRUN == tag.key) {
+            lost.value += tag.value;
+          } else {
+            tag.offset = oldest; moved.push_back(tag);
+          }
+        }
+        _tags.insert(_tags.begin(), moved.begin(), moved.end());
+        _taken = oldest;
+        addTag(lost);
+      }
+
+    protected:
+      // absolute write cursor
+      uint64_t _written;
+      // absolute read cursor
+      uint64_t _taken;
+      // tags of the stored samples, sorted by offset
+      std::deque<Tag> _tags;
+  };
+
+
+  // Maps tags through a rate change by interp/decim.
+  //
+  // Input sample i (counted from the first block) corresponds to output
+  // sample floor(i*interp/decim), this is exact for the decimators of this
+  // library (CICDecimator, FixedFIR) starting from a reset. The group delay
+  // of the filter is not included. Tags mapping past the produced output
+  // are held back until the next block.
+  class TagRateChange {
+    public:
+      // Constructor with interpolation and decimation factors and the
+      // absolute offset of the first output sample
+      TagRateChange(size_t interp=1, size_t decim=1, uint64_t outOffset=0)
+        : _interp(std::max(size_t(1), interp)), _decim(std::max(size_t(1), decim)),
+          _started(false), _in_origin(0), _out_origin(outOffset), _next(outOffset), _pending() {}
+
+      // Destructor
+      virtual ~TagRateChange() {}
+
+      // Inline helper functions
+      // returns the absolute offset of the next output sample
+      inline uint64_t next() const { return _next; }
+      // returns the output offset of an input offset
+      inline uint64_t map(uint64_t offset) const {
+        return _out_origin + ((offset-_in_origin)*_interp)/_decim;
+      }
+
+      // Restarts the mapping (with the filter), the next output sample gets
+      // the given absolute offset
+      inline void reset(uint64_t outOffset) {
+        _started = false; _out_origin = _next = outOffset;
+        _pending.clear();
+      }
+
+      // Returns a view of the N output samples produced from the input block
+      // with the mapped tags
+      template <class T>
+      TaggedBuffer<T> apply(const TaggedBuffer<T> &in, const Buffer<T> &out, size_t N) {
+        if (! _started) { _in_origin = in.offset(); _out_origin = _next; _started = true; }
+        uint64_t offset = _next;
+        _next += N;
+        TagRange range = in.tags();
+        // fast path: nothing to map
+        if (range.empty() && _pending.empty()) { return TaggedBuffer<T>(out.head(N), offset); }
+        for (const Tag *t=range.begin(); t!=range.end(); t++) {
+          _pending.push_back(Tag(std::max(map(t->offset), offset), t->key, t->value));
+        }
+        // tags of the produced samples, the rest waits for the next block
+        std::vector<Tag> result;
+        size_t i = 0;
+        for (; (i<_pending.size()) && (_pending[i].offset < _next); i++) { result.push_back(_pending[i]); }
+        _pending.erase(_pending.begin(), _pending.begin()+i);
+        return TaggedBuffer<T>(out.head(N), offset, TagSet(std::move(result)));
+      }
+
+    protected:
+      // interpolation factor
+      size_t _interp;
+      // decimation factor
+      size_t _decim;
+      // true once the first block was seen
+      bool _started;
+      // input offset of the first block
+      uint64_t _in_origin;
+      // output offset corresponding to it
+      uint64_t _out_origin;
+      // offset of the next output sample
+      uint64_t _next;
+      // mapped tags not yet produced
+      std::vector<Tag> _pending;
+  };
+
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef __SDR_WINDOW_H__
+#define __SDR_WINDOW_H__
+
+#include "buffer.h"
+#include <deque>
+
+namespace sdr {
+
+  // Accumulator types of the sliding window statistics: double for real
+  // samples, std::complex<double> for complex samples
+  template <class Scalar>
+  struct WindowTraits {
+    typedef double Sum;
+    static inline double power(const Scalar &x) { return double(x)*double(x); }
+  };
+
+  template <class T>
+  struct WindowTraits< std::complex<T> > {
+    typedef std::complex<double> Sum;
+    static inline double power(const std::complex<T> &x) {
+      return double(x.real())*double(x.real()) + double(x.imag())*double(x.imag());
+    }
+  };
+
+
+  // Sliding-window statistics (mean, mean power, peak power) over the last
+  // W samples. The samples are kept in a CircularBuffer. Each pushed sample is
+  // added to running sums and each sample dropped from the window is
+  // subtracted, hence an update costs O(1) per sample instead of O(W) per
+  // block. The peak is tracked with a monotonic queue (amortized O(1)).
+  //
+  // To bound the floating point drift of the running sums, they are
+  // recomputed from the window contents every resync*W samples.
+  template <class Scalar>
+  class SlidingWindow {
+    public:
+      // accumulator type
+      typedef typename WindowTraits<Scalar>::Sum Sum;
+
+    public:
+      // Constructor with window length and resync interval (in windows)
+      SlidingWindow(size_t window, size_t resync=16)
+        : _ring(std::max(size_t(1), window)), _resync(std::max(size_t(1), resync)*_ring.size()),
+          _sum(0), _power(0), _count(0), _since_resync(0), _peaks()
+      {}
+
+      // Destructor
+      virtual ~SlidingWindow() {}
+
+      // Inline helper functions
+      // returns the window length
+      inline size_t window() const { return _ring.size(); }
+      // returns the number of samples in the window
+      inline size_t stored() const { return _ring.stored(); }
+      // returns true if the window is filled
+      inline bool full() const { return _ring.stored() == _ring.size(); }
+      // returns the total number of samples pushed
+      inline uint64_t count() const { return _count; }
+      // returns the mean over the window
+      inline Sum mean() const { return stored() ? (_sum/double(stored())) : Sum(0); }
+      // returns the mean power |x|^2 over the window
+      inline double power() const { return stored() ? (_power/stored()) : 0; }
+      // returns the RMS over the window
+      inline double rms() const { return std::sqrt(power()); }
+      // returns the peak power |x|^2 within the window
+      inline double peak() const { return _peaks.size() ? _peaks.front().power : 0; }
+      // returns the underlying ring buffer holding the window
+      inline CircularBuffer<Scalar> &ring() { return _ring; }
+
+      // Pushes a block of samples, older samples leave the window
+      void push(const Buffer<Scalar> &data) {
+        size_t n = data.size(), W = _ring.size();
+        if (n >= W) {
+          // the block replaces the whole window
+          _ring.drop(_ring.stored());
+          _sum = 0; _power = 0; _peaks.clear();
+          _count += n-W;
+          append(data.tail(W));
+          resync();
+          return;
+        }
+        // drop the oldest samples leaving the window
+        size_t excess = (_ring.stored()+n > W) ? (_ring.stored()+n-W) : 0;
+        for (size_t i=0; i<excess; i++) {
+          Scalar x = _ring[i];
+          _sum -= Sum(x); _power -= WindowTraits<Scalar>::power(x);
+        }
+        _ring.drop(excess);
+        append(data);
+        if ((_since_resync += n) >= _resync) { resync(); }
+      }
+
+      // Recomputes the running sums from the window contents
+      void resync() {
+        _sum = 0; _power = 0;
+        for (size_t i=0; i<_ring.stored(); i++) {
+          Scalar x = _ring[i];
+          _sum += Sum(x); _power += WindowTraits<Scalar>::power(x);
+        }
+        _since_resync = 0;
+      }
+
+      // Empties the window
+      void clear() {
+        _ring.drop(_ring.stored());
+        _sum = 0; _power = 0; _count = 0; _since_resync = 0; _peaks.clear();
+      }
+
+    protected:
+      // adds the samples of the block (fits into the window)
+      void append(const Buffer<Scalar> &data) {
+        uint64_t W = _ring.size();
+        for (size_t i=0; i<data.size(); i++, _count++) {
+          double p = WindowTraits<Scalar>::power(data[i]);
+          _sum += Sum(data[i]); _power += p;
+          // monotonic queue: drop smaller peaks and those leaving the window
+          while (_peaks.size() && (_peaks.back().power <= p)) { _peaks.pop_back(); }
+          Peak peak = {_count, p};
+          _peaks.push_back(peak);
+          while ((_peaks.front().index+W) <= _count) { _peaks.pop_front(); }
+        }
+        _ring.push(data);
+      }
+
+    protected:
+      // a peak candidate: sample index and power
+      struct Peak {
+        uint64_t index;
+        double power;
+      };
+
+      // samples in the window
+      CircularBuffer<Scalar> _ring;
+      // number of samples between resyncs
+      size_t _resync;
+      // running sum of the samples
+      Sum _sum;
+      // running sum of the sample powers
+      double _power;
+      // total number of samples pushed
+      uint64_t _count;
+      // samples pushed since the last resync
+      size_t _since_resync;
+      // decreasing peak candidates within the window
+      std::deque<Peak> _peaks;
+  };
+
+
+  // Squelch / energy detector with hysteresis on the sliding-window power.
+  // The detector opens once the mean power within the window exceeds the
+  // open threshold and closes once it falls below the close threshold. It
+  // stays closed until the window has been filled.
+  template <class Scalar>
+  class EnergyDetector {
+    public:
+      // Constructor with window length and open/close thresholds in dB
+      // (10*log10 of the mean power |x|^2). The close threshold should be
+      // below the open threshold.
+      EnergyDetector(size_t window, double openDb, double closeDb)
+        : _window(window), _open_level(std::pow(10., openDb/10)),
+          _close_level(std::pow(10., std::min(openDb, closeDb)/10)), _open(false), _transitions(0)
+      {}
+
+      // Destructor
+      virtual ~EnergyDetector() {}
+
+      // Inline helper functions
+      // returns true if the squelch is open
+      inline bool isOpen() const { return _open; }
+      // returns the number of open/close transitions so far
+      inline size_t transitions() const { return _transitions; }
+      // returns the current level in dB
+      inline double levelDb() const { return 10*std::log10(std::max(_window.power(), 1e-30)); }
+      // returns the sliding window
+      inline const SlidingWindow<Scalar> &window() const { return _window; }
+
+      // Adds a block of samples, returns true if the squelch is open
+      // afterwards (the block should then be demodulated)
+      bool process(const Buffer<Scalar> &data) {
+        _window.push(data);
+        if (! _window.full()) { return _open; }
+        double p = _window.power();
+        if ((! _open) && (p > _open_level)) { _open = true; _transitions++; }
+        else if (_open && (p < _close_level)) { _open = false; _transitions++; }
+        return _open;
+      }
+
+      // Closes the squelch and empties the window
+      void reset() { _window.clear(); _open = false; }
+
+    protected:
+      // power statistics
+      SlidingWindow<Scalar> _window;
+      // open threshold (linear power)
+      double _open_level;
+      // close threshold (linear power)
+      double _close_level;
+      // current state
+      bool _open;
+      // number of transitions
+      size_t _transitions;
+  };
+
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/adaptive.h"
+#include "../src/logger.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+// Pushes blocks of samples as fast as the ring accepts them
+class Source: public Stage {
+  public:
+    Source(FlowControlBuffer<float> &out, size_t total)
+      : _out(out), _block(4096), _total(total), _sent(0) {
+      for (size_t i=0; i<_block.size(); i++) { _block[i] = 1; }
+    }
+    virtual bool ready() const { return (_sent < _total) && (FlowControlBuffer<float>::FLOW_OK == _out.flow()); }
+    virtual void process() {
+      if (_out.push(_block)) { _sent += _block.size(); }
+    }
+  protected:
+    FlowControlBuffer<float> &_out;
+    Buffer<float> _block;
+    size_t _total, _sent;
+};
+
+// Sums up its input in adaptive blocks
+class Accumulator: public AdaptiveStage {
+  public:
+    Accumulator(FlowControlBuffer<float> &in)
+      : AdaptiveStage(1e6, 0.005), _in(in), _block(65536), _sum(0), _count(0), _max_block(0) {}
+    virtual size_t queued() const { return _in.stored(); }
+    virtual size_t space() const { return 65536; }
+    virtual void processBlock(size_t N) {
+      _in.pull(_block, N);
+      for (size_t i=0; i<N; i++) { _sum += _block[i]; }
+      _count += N;
+      _max_block = std::max(_max_block, N);
+    }
+    inline double sum() const { return _sum; }
+    inline size_t count() const { return _count; }
+    inline size_t maxBlock() const { return _max_block; }
+  protected:
+    FlowControlBuffer<float> &_in;
+    Buffer<float> _block;
+    double _sum;
+    std::atomic<size_t> _count;
+    size_t _max_block;
+};
+
+
+int main() {
+
+  // a stage that falls behind grows its block up to the latency limit
+  std::cout << "Test growth" << std::endl;
+  BlockSizer sizer(2.4e6, 0.01, 64, 65536);
+  for (int i=0; i<20; i++) {
+    size_t N = sizer.block();
+    sizer.update(N, 20e-6 + 5e-9*N, 10*N);
+  }
+  std::cout << "Block " << sizer.block() << ", limit " << sizer.limit() << ", grown " << sizer.grown() << std::endl;
+  std::cout << "Overhead " << sizer.overhead()*1e6 << " us, per sample " << sizer.perSample()*1e9
+            << " ns, latency " << sizer.latency()*1e3 << " ms" << std::endl;
+
+  // an idle stage shrinks back to the minimum
+  std::cout << "Test shrinking" << std::endl;
+  for (int i=0; i<40; i++) {
+    size_t N = sizer.block();
+    sizer.update(N, 20e-6 + 5e-9*N, 0);
+  }
+  std::cout << "Block " << sizer.block() << ", shrunk " << sizer.shrunk() << std::endl;
+
+  // more expensive than real time
+  std::cout << "Test overload" << std::endl;
+  BlockSizer slow(1e6, 0.01, 64, 65536);
+  for (int i=0; i<20; i++) {
+    size_t N = slow.block();
+    slow.update(N, 10e-6 + 2e-6*N, 10*N);
+  }
+  std::cout << "Block " << slow.block() << ", limit " << slow.limit() << ", load " << (slow.load() > 1 ? "above" : "below")
+            << " real time" << std::endl;
+
+  // explicit flow signals instead of silent push failures
+  std::cout << "Test flow control" << std::endl;
+  const char *names[] = { "OK", "SLOW", "STOP" };
+  FlowControlBuffer<float> ring(1000);
+  ring.setListener([names](FlowControlBuffer<float>::Flow flow) { std::cout << "  -> " << names[flow] << std::endl; });
+  Buffer<float> block(300), out(1000);
+  for (int i=0; i<4; i++) {
+    FlowControlBuffer<float>::Flow flow = ring.offer(block);
+    std::cout << "offer: " << names[flow] << ", stored " << ring.stored() << std::endl;
+  }
+  ring.pull(out, 200);
+  std::cout << "pull 200: " << names[ring.flow()] << std::endl;
+  ring.pull(out, 300);
+  std::cout << "pull 300: " << names[ring.flow()] << std::endl;
+  std::cout << "Rejected " << ring.rejected() << ", signals " << ring.signals() << std::endl;
+
+  // adaptive stage in the scheduler
+  std::cout << "Test adaptive stage" << std::endl;
+  const size_t total = 1 << 22;
+  FlowControlBuffer<float> queue(1 << 16);
+  Source source(queue, total);
+  Accumulator acc(queue);
+  source.connect(&acc);
+  acc.connect(&source);
+  Scheduler scheduler(1);
+  scheduler.add(&source);
+  scheduler.add(&acc);
+  scheduler.start();
+  while (acc.count() < total) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+  scheduler.stop();
+  std::cout << "Sum " << acc.sum() << ", block grew: " << (acc.maxBlock() > 64)
+            << ", within limit: " << (acc.sizer().block() <= acc.sizer().limit()) << std::endl;
+
+  return 0;
+}
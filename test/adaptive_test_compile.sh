@@ -0,0 +1 @@
+gcc adaptive_test.cpp ../src/adaptive.cpp ../src/scheduler.cpp ../src/buffer.cpp ../src/logger.cpp -lstdc++ -lm -pthread -o adaptive_test.o
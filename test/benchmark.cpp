@@ -0,0 +1,769 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "../src/buffer.h"
+#include "../src/logger.h"
+#include "../src/expression.h"
+#include "../src/fixed.h"
+#include "../src/cic.h"
+#include "../src/conditioner.h"
+#include "../src/window.h"
+#include "../src/correlator.h"
+#include "../src/multibuffer.h"
+#include "../src/codec.h"
+#include "../src/tags.h"
+#include "../src/generator.h"
+using namespace sdr;
+
+// Usage:
+//   benchmark.o [--reps N] [--min-time MS] [--filter STR] [--csv FILE]
+//               [--compare BASELINE.csv] [--threshold PCT]
+//
+// Every benchmark is calibrated to run for at least --min-time per repetition
+// and is repeated --reps times. The median is reported together with the
+// minimum and the median absolute deviation (MAD) as a noise estimate.
+// --csv writes the results in a machine-readable form which can be used as a
+// baseline for --compare later on. In compare mode, a benchmark is flagged as
+// a regression if its median is slower than the baseline by more than the
+// threshold (and more than 3 MADs), the exit code is then 1.
+
+
+// Keeps the compiler from optimizing a value away
+template <class T>
+inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Keeps the compiler from assuming memory is unchanged
+inline void clobberMemory() {
+  asm volatile("" : : : "memory");
+}
+
+// A single benchmark: the function runs the operation N times
+struct Benchmark {
+  std::string name;
+  // number of samples (items) processed per operation
+  double items;
+  std::function<void(size_t)> run;
+};
+
+// Result of a benchmark
+struct Result {
+  std::string name;
+  // median, minimum and median absolute deviation in ns per operation
+  double ns_op, min_ns_op, mad_ns_op;
+  // throughput in mega-samples per second (at the median)
+  double msps;
+  size_t reps;
+};
+
+// Scale factor for the scalar operations, volatile to keep the compiler from
+// folding the multiplication/division by one
+static volatile float unity = 1;
+
+// Stream buffer that discards everything (used for log handler benchmarks)
+class NullStreamBuffer: public std::streambuf {
+  protected:
+    virtual int overflow(int c) { return c; }
+    virtual std::streamsize xsputn(const char *, std::streamsize n) { return n; }
+};
+
+static double median(std::vector<double> v) {
+  std::sort(v.begin(), v.end());
+  size_t n = v.size();
+  if (0 == n) { return 0; }
+  return (n % 2) ? v[n/2] : 0.5*(v[n/2-1]+v[n/2]);
+}
+
+static double elapsedNs(const std::function<void(size_t)> &fn, size_t N) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  fn(N);
+  std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop-start).count();
+}
+
+// Calibrates, warms up and runs a single benchmark
+static Result measure(const Benchmark &bench, size_t reps, double min_time_ns) {
+  // calibrate number of iterations per repetition
+  size_t N = 1;
+  double t = elapsedNs(bench.run, N);
+  while (t < min_time_ns) {
+    size_t factor = (t > 0) ? size_t(1.4*min_time_ns/t)+1 : 10;
+    N *= std::min(std::max(factor, size_t(2)), size_t(100));
+    t = elapsedNs(bench.run, N);
+  }
+  // measure
+  std::vector<double> samples;
+  for (size_t i=0; i<reps; i++)
+    samples.push_back(elapsedNs(bench.run, N)/N);
+  Result res;
+  res.name = bench.name;
+  res.ns_op = median(samples);
+  res.min_ns_op = *std::min_element(samples.begin(), samples.end());
+  std::vector<double> dev;
+  for (size_t i=0; i<samples.size(); i++)
+    dev.push_back(std::abs(samples[i]-res.ns_op));
+  res.mad_ns_op = median(dev);
+  res.msps = (res.ns_op > 0) ? (1e3*bench.items/res.ns_op) : 0;
+  res.reps = reps;
+  return res;
+}
+
+
+// RING BUFFER BENCHMARKS
+// The ring is exactly one block large. With wrap offset 0, every push and pull
+// is a single contiguous copy. With a non-zero offset, the take index sits at
+// that position and every push and pull is split into two copies.
+static void addRingBenchmarks(std::vector<Benchmark> &benchmarks) {
+  typedef std::complex<float> cf32;
+  const size_t blocks[] = {64, 1024, 16384};
+  for (size_t b=0; b<3; b++) {
+    size_t block = blocks[b];
+    size_t offsets[] = {0, block/2};
+    for (size_t o=0; o<2; o++) {
+      size_t nbytes = block*sizeof(cf32), offset = offsets[o]*sizeof(cf32);
+      std::stringstream suffix;
+      suffix << "cf32/block=" << block << "/wrap=" << (offset ? "mid" : "none");
+
+      std::shared_ptr< RawCircularBuffer > ring(new RawCircularBuffer(nbytes));
+      Buffer<cf32> src(block), dst(block);
+      for (size_t i=0; i<block; i++) { src[i] = cf32(i, -float(i)); }
+      // move take index to wrap position
+      ring->push(src.head(offsets[o]));
+      ring->drop(offset);
+
+      Benchmark push_pull;
+      push_pull.name = "ring/push_pull/" + suffix.str();
+      push_pull.items = block;
+      push_pull.run = [ring, src, dst, nbytes](size_t N) {
+        for (size_t i=0; i<N; i++) {
+          ring->push(src);
+          ring->pull(dst, nbytes);
+          clobberMemory();
+        }
+      };
+      benchmarks.push_back(push_pull);
+
+      Benchmark push_drop;
+      push_drop.name = "ring/push_drop/" + suffix.str();
+      push_drop.items = block;
+      push_drop.run = [ring, src, nbytes](size_t N) {
+        for (size_t i=0; i<N; i++) {
+          ring->push(src);
+          ring->drop(nbytes);
+          clobberMemory();
+        }
+      };
+      benchmarks.push_back(push_drop);
+    }
+  }
+
+  // static ring: small blocks at a moving wrap position and single elements
+  typedef StaticCircularBuffer<cf32, 64> StaticRing;
+  std::shared_ptr< StaticRing > sring(new StaticRing());
+  Buffer<cf32> sblock(24), dblock(24);
+  Benchmark static_block; static_block.name = "ring/static/push_pull/cf32/block=24"; static_block.items = 24;
+  static_block.run = [sring, sblock, dblock](size_t M) {
+    for (size_t i=0; i<M; i++) {
+      sring->push(sblock);
+      sring->pull(dblock, 24);
+      clobberMemory();
+    }
+  };
+  benchmarks.push_back(static_block);
+
+  Benchmark static_elem; static_elem.name = "ring/static/push_pull/cf32/element"; static_elem.items = 1;
+  static_elem.run = [sring](size_t M) {
+    cf32 value(1, 0);
+    for (size_t i=0; i<M; i++) {
+      sring->push(value);
+      sring->pull(value);
+      doNotOptimize(value);
+    }
+  };
+  benchmarks.push_back(static_elem);
+}
+
+
+// BUFFER BENCHMARKS
+template <class T>
+static void addBufferBenchmarks(std::vector<Benchmark> &benchmarks, const std::string &type) {
+  const size_t N = 4096;
+  Buffer<T> buf(N);
+  for (size_t i=0; i<N; i++) { buf[i] = T(i%7+1); }
+
+  Benchmark l1; l1.name = "buffer/norm_l1/" + type; l1.items = N;
+  l1.run = [buf](size_t M) {
+    for (size_t i=0; i<M; i++) { doNotOptimize(buf.norm_l1()); clobberMemory(); }
+  };
+  benchmarks.push_back(l1);
+
+  Benchmark l2; l2.name = "buffer/norm_l2/" + type; l2.items = N;
+  l2.run = [buf](size_t M) {
+    for (size_t i=0; i<M; i++) { doNotOptimize(buf.norm_l2()); clobberMemory(); }
+  };
+  benchmarks.push_back(l2);
+
+  Benchmark lp; lp.name = "buffer/norm_lp/" + type; lp.items = N;
+  lp.run = [buf](size_t M) {
+    for (size_t i=0; i<M; i++) { doNotOptimize(buf.norm_lp(3)); clobberMemory(); }
+  };
+  benchmarks.push_back(lp);
+
+  // multiply and divide by one to keep the values stable
+  Benchmark mul; mul.name = "buffer/mul_scalar/" + type; mul.items = N;
+  mul.run = [buf](size_t M) mutable {
+    for (size_t i=0; i<M; i++) { buf *= T(unity); clobberMemory(); }
+  };
+  benchmarks.push_back(mul);
+
+  Benchmark div; div.name = "buffer/div_scalar/" + type; div.items = N;
+  div.run = [buf](size_t M) mutable {
+    for (size_t i=0; i<M; i++) { buf /= T(unity); clobberMemory(); }
+  };
+  benchmarks.push_back(div);
+}
+
+
+// EXPRESSION BENCHMARKS
+// gain, offset and multiplication by a second buffer: fused single pass
+// against separate passes over the data
+static void addExpressionBenchmarks(std::vector<Benchmark> &benchmarks) {
+  typedef std::complex<float> cf32;
+  const size_t N = 4096;
+  Buffer<cf32> a(N), b(N), out(N);
+  for (size_t i=0; i<N; i++) { a[i] = cf32(i%7, 1); b[i] = cf32(1, i%5); }
+
+  Benchmark fused; fused.name = "expr/gain_offset_mul/fused/cf32"; fused.items = N;
+  fused.run = [a, b, out](size_t M) {
+    for (size_t i=0; i<M; i++) {
+      eval(out, (float(unity)*a + cf32(unity, 0))*b);
+      clobberMemory();
+    }
+  };
+  benchmarks.push_back(fused);
+
+  Benchmark passes; passes.name = "expr/gain_offset_mul/passes/cf32"; passes.items = N;
+  passes.run = [a, b, out](size_t M) mutable {
+    for (size_t i=0; i<M; i++) {
+      for (size_t j=0; j<N; j++) { out[j] = a[j]; }
+      out *= cf32(unity, 0);
+      for (size_t j=0; j<N; j++) { out[j] += cf32(unity, 0); }
+      for (size_t j=0; j<N; j++) { out[j] *= b[j]; }
+      clobberMemory();
+    }
+  };
+  benchmarks.push_back(passes);
+}
+
+
+// FIXED-POINT BENCHMARKS
+static void addFixedBenchmarks(std::vector<Benchmark> &benchmarks) {
+  const size_t N = 4096;
+  Buffer<cint16> in(N), out(N);
+  Buffer<int16_t> mag(N);
+  for (size_t i=0; i<N; i++) { in[i] = cint16(i%2000-1000, 1000-i%1500); }
+
+  Benchmark mixer; mixer.name = "fixed/mixer/cint16"; mixer.items = N;
+  std::shared_ptr< FixedMixer > nco(new FixedMixer(0.1));
+  mixer.run = [in, out, nco](size_t M) {
+    for (size_t i=0; i<M; i++) { nco->process(in, out); clobberMemory(); }
+  };
+  benchmarks.push_back(mixer);
+
+  const size_t ntaps[] = {16, 64};
+  for (size_t t=0; t<2; t++) {
+    std::vector<float> taps(ntaps[t], 1./ntaps[t]);
+    std::shared_ptr< FixedFIR > filter(new FixedFIR(taps, 1));
+    Buffer<cint16> fout(filter->maxOutputs(N));
+    std::stringstream name;
+    name << "fixed/fir/cint16/taps=" << ntaps[t];
+    Benchmark fir; fir.name = name.str(); fir.items = N;
+    fir.run = [in, fout, filter](size_t M) {
+      for (size_t i=0; i<M; i++) { filter->process(in, fout); clobberMemory(); }
+    };
+    benchmarks.push_back(fir);
+  }
+
+  Benchmark magn; magn.name = "fixed/magnitude/cint16"; magn.items = N;
+  magn.run = [in, mag](size_t M) {
+    for (size_t i=0; i<M; i++) { magnitude(in, mag); clobberMemory(); }
+  };
+  benchmarks.push_back(magn);
+}
+
+
+// CIC BENCHMARKS
+static void addCICBenchmarks(std::vector<Benchmark> &benchmarks) {
+  const size_t N = 16384;
+  Buffer<cint16> in(N);
+  for (size_t i=0; i<N; i++) { in[i] = cint16(i%2000-1000, 1000-i%1500); }
+
+  // order 4, decimation by 16, without and with a 31 tap compensation FIR
+  const size_t comp[] = {0, 31};
+  for (size_t c=0; c<2; c++) {
+    std::shared_ptr< CICDecimator<cint16> > cic(new CICDecimator<cint16>(4, 16, 1, comp[c]));
+    Buffer<cint16> out(cic->maxOutputs(N));
+    std::stringstream name;
+    name << "cic/decimate/cint16/N=4/R=16/comp=" << comp[c];
+    Benchmark dec; dec.name = name.str(); dec.items = N;
+    dec.run = [in, out, cic](size_t M) {
+      for (size_t i=0; i<M; i++) { cic->process(in, out); clobberMemory(); }
+    };
+    benchmarks.push_back(dec);
+  }
+}
+
+
+// CONDITIONER BENCHMARKS
+static void addConditionerBenchmarks(std::vector<Benchmark> &benchmarks) {
+  const size_t N = 4096;
+  Buffer< std::complex<float> > in(N);
+  for (size_t i=0; i<N; i++) { in[i] = std::complex<float>(0.1*std::cos(0.1*i)+0.01, 0.12*std::sin(0.1*i+0.1)); }
+
+  Benchmark cond; cond.name = "conditioner/dc+iq+agc/cf32"; cond.items = N;
+  std::shared_ptr< IQConditioner > conditioner(new IQConditioner());
+  conditioner->setAGC(0.5);
+  cond.run = [in, conditioner](size_t M) {
+    for (size_t i=0; i<M; i++) { conditioner->process(in, in); clobberMemory(); }
+  };
+  benchmarks.push_back(cond);
+}
+
+
+// SLIDING WINDOW BENCHMARKS
+static void addWindowBenchmarks(std::vector<Benchmark> &benchmarks) {
+  const size_t W = 4096, N = 256;
+  Buffer< std::complex<float> > block(N);
+  Buffer< std::complex<float> > full(W);
+  for (size_t i=0; i<N; i++) { block[i] = std::complex<float>(std::cos(0.1*i), std::sin(0.1*i)); }
+  for (size_t i=0; i<W; i++) { full[i] = std::complex<float>(std::cos(0.1*i), std::sin(0.1*i)); }
+
+  // incremental update per block
+  Benchmark sliding; sliding.name = "window/sliding-power/cf32"; sliding.items = N;
+  std::shared_ptr< SlidingWindow< std::complex<float> > > win(new SlidingWindow< std::complex<float> >(W));
+  sliding.run = [block, win](size_t M) {
+    for (size_t i=0; i<M; i++) { win->push(block); doNotOptimize(win->power()); }
+  };
+  benchmarks.push_back(sliding);
+
+  // recomputing the norm over the full window per block
+  Benchmark recompute; recompute.name = "window/norm_l2-recompute/cf32"; recompute.items = N;
+  recompute.run = [full](size_t M) {
+    for (size_t i=0; i<M; i++) { doNotOptimize(full.norm_l2()); }
+  };
+  benchmarks.push_back(recompute);
+}
+
+
+// FFT AND CORRELATOR BENCHMARKS
+static void addCorrelatorBenchmarks(std::vector<Benchmark> &benchmarks) {
+  const size_t N = 65536, L = 1024;
+  Buffer< std::complex<float> > in(N);
+  Buffer< std::complex<float> > pre(L);
+  for (size_t i=0; i<N; i++) { in[i] = std::complex<float>(std::cos(0.37*i), std::sin(0.11*i*i)); }
+  for (size_t i=0; i<L; i++) { pre[i] = std::complex<float>((i*7)%3 ? 1 : -1, (i*5)%7 ? 1 : -1); }
+
+  Benchmark fft; fft.name = "fft/radix2/cf32/size=4096"; fft.items = 4096;
+  std::shared_ptr< FFT > plan(new FFT(4096));
+  Buffer< std::complex<float> > spec(4096);
+  fft.run = [in, spec, plan](size_t M) {
+    for (size_t i=0; i<M; i++) { plan->execute(in, spec); clobberMemory(); }
+  };
+  benchmarks.push_back(fft);
+
+  Benchmark corr; corr.name = "correlator/fft/cf32/preamble=1024"; corr.items = N;
+  std::shared_ptr< PreambleCorrelator > correlator(new PreambleCorrelator(pre, 0.9));
+  std::shared_ptr< std::vector<PreambleCorrelator::Event> > events(new std::vector<PreambleCorrelator::Event>());
+  corr.run = [in, correlator, events](size_t M) {
+    for (size_t i=0; i<M; i++) { correlator->process(in, *events); events->clear(); clobberMemory(); }
+  };
+  benchmarks.push_back(corr);
+}
+
+
+// MULTI-CHANNEL BENCHMARKS
+static void addMultiBenchmarks(std::vector<Benchmark> &benchmarks) {
+  const size_t C = 4, N = 4096;
+  Buffer< std::complex<float> > in(C*N);
+  Buffer< std::complex<float> > beam(N);
+  for (size_t i=0; i<C*N; i++) { in[i] = std::complex<float>(std::cos(0.1*i), std::sin(0.1*i)); }
+  std::shared_ptr< MultiBuffer< std::complex<float> > > multi(new MultiBuffer< std::complex<float> >(C, N));
+  multi->deinterleave(in);
+
+  Benchmark deint; deint.name = "multi/deinterleave/cf32/channels=4"; deint.items = C*N;
+  deint.run = [in, multi](size_t M) {
+    for (size_t i=0; i<M; i++) { multi->deinterleave(in); clobberMemory(); }
+  };
+  benchmarks.push_back(deint);
+
+  Benchmark bf; bf.name = "multi/beamform/cf32/channels=4"; bf.items = C*N;
+  std::vector< std::complex<float> > weights(C, std::complex<float>(0.25, 0.1));
+  bf.run = [multi, beam, weights](size_t M) {
+    for (size_t i=0; i<M; i++) { multi->beamform(weights, beam); clobberMemory(); }
+  };
+  benchmarks.push_back(bf);
+}
+
+
+// CODEC BENCHMARKS
+static void addCodecBenchmarks(std::vector<Benchmark> &benchmarks) {
+  const size_t N = 65536;
+  Buffer<int16_t> in(N), back(N);
+  for (size_t i=0; i<N; i++) { in[i] = int16_t(1500*std::cos(0.01*i) + int((i*7919)%17) - 8); }
+  Buffer<uint8_t> packed(packedSize(N, 12));
+  pack(in, packed, 12);
+
+  Benchmark p12; p12.name = "codec/pack/bits=12"; p12.items = N;
+  p12.run = [in, packed](size_t M) {
+    for (size_t i=0; i<M; i++) { pack(in, packed, 12); clobberMemory(); }
+  };
+  benchmarks.push_back(p12);
+
+  Benchmark u12; u12.name = "codec/unpack/bits=12"; u12.items = N;
+  u12.run = [packed, back](size_t M) {
+    for (size_t i=0; i<M; i++) { unpack(packed, back, N, 12); clobberMemory(); }
+  };
+  benchmarks.push_back(u12);
+
+  std::shared_ptr< IQEncoder > enc(new IQEncoder(IQBlockHeader::DELTA_RICE, 16384, 2));
+  std::shared_ptr< std::vector<uint8_t> > stream(new std::vector<uint8_t>());
+  enc->encode(in, *stream);
+  Benchmark re; re.name = "codec/delta_rice/encode"; re.items = N;
+  re.run = [in, enc, stream](size_t M) {
+    for (size_t i=0; i<M; i++) { stream->clear(); enc->encode(in, *stream); clobberMemory(); }
+  };
+  benchmarks.push_back(re);
+
+  std::shared_ptr< std::vector<int16_t> > decoded(new std::vector<int16_t>());
+  Benchmark rd; rd.name = "codec/delta_rice/decode"; rd.items = N;
+  rd.run = [stream, decoded](size_t M) {
+    for (size_t i=0; i<M; i++) {
+      decoded->clear(); IQDecoder::decode(&(*stream)[0], stream->size(), *decoded); clobberMemory();
+    }
+  };
+  benchmarks.push_back(rd);
+}
+
+
+// TAG BENCHMARKS
+// Tagged ring round trip of untagged blocks against the plain ring, and with
+// one tag per block.
+static void addTagBenchmarks(std::vector<Benchmark> &benchmarks) {
+  typedef std::complex<float> cf32;
+  const size_t N = 1024;
+  Buffer<cf32> src(N), dst(N);
+
+  Benchmark plain; plain.name = "tags/ring/cf32/plain"; plain.items = N;
+  std::shared_ptr< CircularBuffer<cf32> > ring(new CircularBuffer<cf32>(N));
+  plain.run = [ring, src, dst](size_t M) {
+    for (size_t i=0; i<M; i++) { ring->push(src); ring->pull(dst, N); clobberMemory(); }
+  };
+  benchmarks.push_back(plain);
+
+  Benchmark untagged; untagged.name = "tags/ring/cf32/untagged"; untagged.items = N;
+  std::shared_ptr< TaggedCircularBuffer<cf32> > tagged(new TaggedCircularBuffer<cf32>(N));
+  untagged.run = [tagged, src, dst](size_t M) {
+    for (size_t i=0; i<M; i++) {
+      tagged->push(src);
+      doNotOptimize(tagged->pullTagged(dst, N).hasTags());
+    }
+  };
+  benchmarks.push_back(untagged);
+
+  Benchmark one; one.name = "tags/ring/cf32/tag-per-block"; one.items = N;
+  one.run = [tagged, src, dst](size_t M) {
+    for (size_t i=0; i<M; i++) {
+      tagged->tag(TAG_FREQUENCY, 100e6);
+      tagged->push(src);
+      doNotOptimize(tagged->pullTagged(dst, N).hasTags());
+    }
+  };
+  benchmarks.push_back(one);
+}
+
+
+// GENERATOR BENCHMARKS
+// Synthetic signals per component type, and a mixed load in both formats.
+static void addGeneratorBenchmarks(std::vector<Benchmark> &benchmarks) {
+  typedef std::complex<float> cf32;
+  const size_t N = 4096;
+  Buffer<cf32> out(N);
+  Buffer<cint16> out16(N);
+
+  std::shared_ptr< SignalGenerator > noise(new SignalGenerator(1));
+  noise->setNoise(1);
+  std::shared_ptr< SignalGenerator > tone(new SignalGenerator(1));
+  tone->addTone(0.1);
+  std::shared_ptr< SignalGenerator > chirp(new SignalGenerator(1));
+  chirp->addChirp(-0.4, 0.4, 100000);
+  std::shared_ptr< SignalGenerator > carrier(new SignalGenerator(1));
+  carrier->addCarrier(0.05, 8, 2);
+  std::shared_ptr< SignalGenerator > mixed(new SignalGenerator(1));
+  mixed->addTone(0.1, 0.1); mixed->addTone(-0.2, 0.1); mixed->addTone(0.3, 0.1);
+  mixed->addCarrier(0.05, 8, 2, 0.2);
+  mixed->setSNR(10);
+
+  const char *names[] = {"noise", "tone", "chirp", "qpsk", "mixed"};
+  std::shared_ptr< SignalGenerator > generators[] = {noise, tone, chirp, carrier, mixed};
+  for (size_t g=0; g<5; g++) {
+    std::shared_ptr< SignalGenerator > gen = generators[g];
+    Benchmark b; b.name = std::string("generator/") + names[g] + "/cf32"; b.items = N;
+    b.run = [gen, out](size_t M) {
+      for (size_t i=0; i<M; i++) { gen->generate(out); clobberMemory(); }
+    };
+    benchmarks.push_back(b);
+  }
+
+  Benchmark b16; b16.name = "generator/mixed/cint16"; b16.items = N;
+  b16.run = [mixed, out16](size_t M) {
+    for (size_t i=0; i<M; i++) { mixed->generate(out16, 8192); clobberMemory(); }
+  };
+  benchmarks.push_back(b16);
+}
+
+
+// ALLOCATION BENCHMARKS
+static void addAllocBenchmarks(std::vector<Benchmark> &benchmarks) {
+  const size_t sizes[] = {64, 4096, 65536};
+  for (size_t s=0; s<3; s++) {
+    size_t N = sizes[s];
+    std::stringstream name;
+    name << "alloc/buffer/cf32/n=" << N;
+    Benchmark alloc; alloc.name = name.str(); alloc.items = 1;
+    alloc.run = [N](size_t M) {
+      for (size_t i=0; i<M; i++) {
+        Buffer< std::complex<float> > buf(N);
+        doNotOptimize(buf.ptr());
+      }
+    };
+    benchmarks.push_back(alloc);
+  }
+}
+
+
+// VIEW BENCHMARKS
+// Creating a view takes one reference, returning and moving it must not
+// touch the reference counter.
+static void addViewBenchmarks(std::vector<Benchmark> &benchmarks) {
+  typedef std::complex<float> cf32;
+  Buffer<cf32> buf(4096);
+
+  Benchmark sub; sub.name = "view/sub/cf32"; sub.items = 1;
+  sub.run = [buf](size_t M) {
+    for (size_t i=0; i<M; i++) {
+      Buffer<cf32> view = buf.sub(i%2048, 1024);
+      doNotOptimize(view.data());
+    }
+  };
+  benchmarks.push_back(sub);
+
+  Benchmark as; as.name = "view/as/cf32_to_f32"; as.items = 1;
+  as.run = [buf](size_t M) {
+    for (size_t i=0; i<M; i++) {
+      Buffer<float> view = buf.as<float>();
+      doNotOptimize(view.data());
+    }
+  };
+  benchmarks.push_back(as);
+
+  Benchmark copy; copy.name = "view/copy_assign/cf32"; copy.items = 1;
+  copy.run = [buf](size_t M) {
+    Buffer<cf32> view;
+    for (size_t i=0; i<M; i++) { view = buf; doNotOptimize(view.data()); }
+  };
+  benchmarks.push_back(copy);
+
+  Benchmark move; move.name = "view/move_assign/cf32"; move.items = 1;
+  move.run = [buf](size_t M) {
+    Buffer<cf32> a(buf), b;
+    for (size_t i=0; i<M; i++) {
+      b = std::move(a); a = std::move(b);
+      doNotOptimize(a.data());
+    }
+  };
+  benchmarks.push_back(move);
+
+  Benchmark swap; swap.name = "view/swap/cf32"; swap.items = 1;
+  swap.run = [buf](size_t M) {
+    Buffer<cf32> a(buf), b;
+    for (size_t i=0; i<M; i++) { a.swap(b); doNotOptimize(a.data()); }
+  };
+  benchmarks.push_back(swap);
+}
+
+
+// LOGGER BENCHMARKS
+// Handlers cannot be removed from the logger, hence the order matters: the
+// benchmark without handlers must run first.
+static void addLoggerBenchmarks(std::vector<Benchmark> &benchmarks) {
+  static NullStreamBuffer nullbuf;
+  static std::ostream nullstream(&nullbuf);
+  static LogMessage msg(LOG_INFO, "benchmark message");
+
+  Benchmark none; none.name = "logger/log/handlers=0"; none.items = 1;
+  none.run = [](size_t M) {
+    for (size_t i=0; i<M; i++) { Logger::get().log(msg); clobberMemory(); }
+  };
+  benchmarks.push_back(none);
+
+  Benchmark filtered; filtered.name = "logger/log/handlers=1/filtered"; filtered.items = 1;
+  filtered.run = [](size_t M) {
+    static bool added = false;
+    if (! added) { Logger::get().addHandler(new StreamLogHandler(nullstream, LOG_ERROR)); added = true; }
+    for (size_t i=0; i<M; i++) { Logger::get().log(msg); clobberMemory(); }
+  };
+  benchmarks.push_back(filtered);
+
+  Benchmark active; active.name = "logger/log/handlers=2/active"; active.items = 1;
+  active.run = [](size_t M) {
+    static bool added = false;
+    if (! added) { Logger::get().addHandler(new StreamLogHandler(nullstream, LOG_DEBUG)); added = true; }
+    for (size_t i=0; i<M; i++) { Logger::get().log(msg); clobberMemory(); }
+  };
+  benchmarks.push_back(active);
+
+  Benchmark construct; construct.name = "logger/construct_log/handlers=2/active"; construct.items = 1;
+  construct.run = [](size_t M) {
+    for (size_t i=0; i<M; i++) {
+      LogMessage m(LOG_INFO);
+      m << "sample " << i;
+      Logger::get().log(m);
+    }
+  };
+  benchmarks.push_back(construct);
+}
+
+
+// CSV input/output
+static void writeCSV(std::ostream &stream, const std::vector<Result> &results) {
+  stream << "name,ns_per_op,min_ns_per_op,mad_ns_per_op,msps,reps" << std::endl;
+  stream << std::setprecision(6);
+  for (size_t i=0; i<results.size(); i++) {
+    const Result &r = results[i];
+    stream << r.name << "," << r.ns_op << "," << r.min_ns_op << "," << r.mad_ns_op
+           << "," << r.msps << "," << r.reps << std::endl;
+  }
+}
+
+static bool readCSV(const std::string &filename, std::map<std::string, Result> &results) {
+  std::ifstream file(filename.c_str());
+  if (! file.is_open()) { return false; }
+  std::string line;
+  std::getline(file, line); // skip header
+  while (std::getline(file, line)) {
+    std::stringstream row(line);
+    Result r; std::string field;
+    if (! std::getline(row, r.name, ',')) { continue; }
+    std::getline(row, field, ','); r.ns_op = atof(field.c_str());
+    std::getline(row, field, ','); r.min_ns_op = atof(field.c_str());
+    std::getline(row, field, ','); r.mad_ns_op = atof(field.c_str());
+    std::getline(row, field, ','); r.msps = atof(field.c_str());
+    std::getline(row, field, ','); r.reps = atoi(field.c_str());
+    results[r.name] = r;
+  }
+  return true;
+}
+
+
+int main(int argc, char *argv[]) {
+  size_t reps = 15;
+  double min_time_ms = 20, threshold = 5;
+  std::string filter, csv_file, baseline_file;
+  for (int i=1; i<argc; i++) {
+    std::string arg(argv[i]);
+    if (("--reps" == arg) && (i+1 < argc)) { reps = std::max(1, atoi(argv[++i])); }
+    else if (("--min-time" == arg) && (i+1 < argc)) { min_time_ms = atof(argv[++i]); }
+    else if (("--filter" == arg) && (i+1 < argc)) { filter = argv[++i]; }
+    else if (("--csv" == arg) && (i+1 < argc)) { csv_file = argv[++i]; }
+    else if (("--compare" == arg) && (i+1 < argc)) { baseline_file = argv[++i]; }
+    else if (("--threshold" == arg) && (i+1 < argc)) { threshold = atof(argv[++i]); }
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--reps N] [--min-time MS] [--filter STR]"
+                << " [--csv FILE] [--compare BASELINE.csv] [--threshold PCT]" << std::endl;
+      return 2;
+    }
+  }
+
+  std::map<std::string, Result> baseline;
+  if (baseline_file.size() && (! readCSV(baseline_file, baseline))) {
+    std::cerr << "Cannot read baseline " << baseline_file << std::endl;
+    return 2;
+  }
+
+  std::vector<Benchmark> benchmarks;
+  addRingBenchmarks(benchmarks);
+  addBufferBenchmarks<float>(benchmarks, "f32");
+  addBufferBenchmarks<double>(benchmarks, "f64");
+  addBufferBenchmarks< std::complex<float> >(benchmarks, "cf32");
+  addBufferBenchmarks< std::complex<double> >(benchmarks, "cf64");
+  addExpressionBenchmarks(benchmarks);
+  addFixedBenchmarks(benchmarks);
+  addCICBenchmarks(benchmarks);
+  addConditionerBenchmarks(benchmarks);
+  addWindowBenchmarks(benchmarks);
+  addCorrelatorBenchmarks(benchmarks);
+  addMultiBenchmarks(benchmarks);
+  addCodecBenchmarks(benchmarks);
+  addTagBenchmarks(benchmarks);
+  addGeneratorBenchmarks(benchmarks);
+  addAllocBenchmarks(benchmarks);
+  addViewBenchmarks(benchmarks);
+  addLoggerBenchmarks(benchmarks);
+
+  std::vector<Result> results;
+  size_t regressions = 0;
+  std::cout << std::left << std::setw(48) << "benchmark" << std::right
+            << std::setw(12) << "ns/op" << std::setw(12) << "MS/s"
+            << std::setw(10) << "MAD %";
+  if (baseline.size()) { std::cout << std::setw(10) << "change %"; }
+  std::cout << std::endl;
+
+  for (size_t i=0; i<benchmarks.size(); i++) {
+    if (filter.size() && (std::string::npos == benchmarks[i].name.find(filter))) { continue; }
+    Result r = measure(benchmarks[i], reps, 1e6*min_time_ms);
+    results.push_back(r);
+    double mad_pct = (r.ns_op > 0) ? 100*r.mad_ns_op/r.ns_op : 0;
+    std::cout << std::left << std::setw(48) << r.name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(12) << r.ns_op
+              << std::setw(12) << r.msps << std::setw(10) << mad_pct;
+    std::map<std::string, Result>::iterator base = baseline.find(r.name);
+    if (baseline.end() != base) {
+      double change = 100*(r.ns_op-base->second.ns_op)/base->second.ns_op;
+      // noise level: 3 MADs of both measurements
+      double noise = 300*(r.mad_ns_op+base->second.mad_ns_op)/base->second.ns_op;
+      std::cout << std::setw(10) << change;
+      if ((change > threshold) && (change > noise)) {
+        std::cout << "  REGRESSION";
+        regressions++;
+      }
+    } else if (baseline.size()) {
+      std::cout << std::setw(10) << "new";
+    }
+    std::cout << std::endl;
+  }
+
+  if (csv_file.size()) {
+    std::ofstream file(csv_file.c_str());
+    if (! file.is_open()) {
+      std::cerr << "Cannot write " << csv_file << std::endl;
+      return 2;
+    }
+    writeCSV(file, results);
+  }
+
+  if (baseline.size()) {
+    std::cout << regressions << " regression(s) against " << baseline_file << std::endl;
+  }
+  return (regressions ? 1 : 0);
+}
@@ -0,0 +1 @@
+gcc benchmark.cpp ../src/buffer.cpp ../src/logger.cpp ../src/fixed.cpp ../src/conditioner.cpp ../src/fft.cpp ../src/correlator.cpp ../src/codec.cpp ../src/generator.cpp -O2 -lstdc++ -lm -o benchmark.o
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/broadcast.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+int main() {
+
+  Buffer<int> block(4);
+  for (size_t i=0; i<4; i++) { block[i] = i+1; }
+
+  // wait for slowest reader
+  std::cout << "Test WAIT_FOR_SLOWEST policy" << std::endl;
+  BroadcastBuffer<int> ring(10);
+  int fast = ring.addReader(), slow = ring.addReader();
+  ring.push(block);
+  ring.push(block);
+  std::cout << "Free: " << ring.free() << std::endl;
+  ring.drop(fast, 8);
+  std::cout << "Free after fast reader: " << ring.free() << std::endl;
+  std::cout << "Push: " << (ring.push(block) ? "successful" : "not successful") << std::endl;
+  ring.drop(slow, 4);
+  std::cout << "Push after slow reader: " << (ring.push(block) ? "successful" : "not successful") << std::endl;
+
+  // zero-copy views, wrapped data is returned in two views
+  std::cout << "Views of fast reader: ";
+  while (ring.available(fast)) {
+    Buffer<int> view = ring.peek(fast, 8);
+    std::cout << view << " ";
+    ring.drop(fast, view.size());
+  }
+  std::cout << std::endl;
+
+  // copy for slow reader
+  Buffer<int> dest(8);
+  ring.pull(slow, dest, 8);
+  std::cout << "Pulled by slow reader: " << dest << std::endl;
+
+  // skip lagging readers
+  std::cout << "Test SKIP_LAGGING policy" << std::endl;
+  BroadcastBuffer<int> lossy(10, 2, BroadcastBuffer<int>::SKIP_LAGGING);
+  int r0 = lossy.addReader(), r1 = lossy.addReader();
+  std::cout << "Third reader: " << lossy.addReader() << std::endl;
+  for (size_t i=0; i<3; i++) { lossy.push(block); lossy.drop(r0, 4); }
+  std::cout << "Skipped: " << lossy.skipped(r0) << ", " << lossy.skipped(r1) << std::endl;
+  std::cout << "Available: " << lossy.available(r0) << ", " << lossy.available(r1) << std::endl;
+  lossy.removeReader(r1);
+  std::cout << "Free after remove: " << lossy.free() << std::endl;
+
+  // a reader skipped while holding a view loses nothing beyond the skip
+  std::cout << "Test skip between peek and drop" << std::endl;
+  BroadcastBuffer<int> skip(10, 1, BroadcastBuffer<int>::SKIP_LAGGING);
+  int r = skip.addReader();
+  Buffer<int> counting(4);
+  int value = 0;
+  for (size_t i=0; i<4; i++) { counting[i] = ++value; }
+  skip.push(counting);
+  uint64_t from;
+  Buffer<int> held = skip.peek(r, 4, &from);
+  for (size_t k=0; k<2; k++) {
+    for (size_t i=0; i<4; i++) { counting[i] = ++value; }
+    skip.push(counting);
+  }
+  bool dropped = skip.drop(r, held.size(), from);
+  std::cout << "Drop of stale view: " << (dropped ? "successful" : "not successful")
+            << ", skipped " << skip.skipped(r) << ", available " << skip.available(r) << std::endl;
+  Buffer<int> rest(10);
+  skip.pull(r, rest, skip.available(r));
+  std::cout << "Remaining: " << rest << std::endl;
+
+  return 0;
+}
@@ -0,0 +1 @@
+gcc broadcast_test.cpp ../src/buffer.cpp -lstdc++ -lm -o broadcast_test.o
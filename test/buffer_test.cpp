@@ -115,5 +115,61 @@ int main() {
   std::cout << "BytesLen: " << cir_buf1.bytesLen() << std::endl;
   std::cout << "BytesFree: " << cir_buf1.bytesFree() << std::endl;
 
+  // test reference counting and move semantics
+  std::cout << "Test reference counting and move semantics" << std::endl;
+  Buffer<double> buf3(8);
+  std::cout << "RefCount: " << buf3.refCount() << std::endl;
+  Buffer<double> view = buf3.sub(2, 4);
+  std::cout << "RefCount after sub: " << buf3.refCount() << std::endl;
+  Buffer<double> moved(std::move(view));
+  std::cout << "RefCount after move: " << buf3.refCount() << std::endl;
+  std::cout << "Moved size: " << moved.size() << ", source size: " << view.size() << std::endl;
+  Buffer<double> buf4(2);
+  buf4.swap(moved);
+  std::cout << "Swapped size: " << buf4.size() << ", " << moved.size() << std::endl;
+  buf4 = Buffer<double>();
+  std::cout << "RefCount after release: " << buf3.refCount() << std::endl;
+
+  // test overwrite mode
+  std::cout << "Test overwrite mode" << std::endl;
+  CircularBuffer<double> cir_buf2(6, true);
+  cir_buf2.push(buf1);
+  cir_buf2.push(buf1);
+  std::cout << "Stored: " << cir_buf2.stored() << ", overwritten: " << cir_buf2.overwritten()
+            << ", overruns: " << cir_buf2.overruns() << ", gap: " << cir_buf2.takeGap() << std::endl;
+  for (size_t i=0; i<cir_buf2.stored(); i++) {
+    std::cout << cir_buf2[i] << std::endl;
+  }
+  std::cout << "Gap after read: " << cir_buf2.takeGap() << std::endl;
+
+  // test direct writes into the free spans
+  std::cout << "Test direct write" << std::endl;
+  CircularBuffer<uint8_t> cir_buf3(8);
+  cir_buf3.push(Buffer<uint8_t>(6));
+  cir_buf3.drop(5);
+  std::pair<RawBuffer, RawBuffer> spans = cir_buf3.freeSpans();
+  std::cout << "Free spans: " << spans.first.bytesLen() << " + " << spans.second.bytesLen() << std::endl;
+  for (size_t i=0; i<spans.first.bytesLen(); i++) { spans.first.data()[i] = char(10+i); }
+  for (size_t i=0; i<spans.second.bytesLen(); i++) { spans.second.data()[i] = char(20+i); }
+  cir_buf3.commit(5);
+  std::cout << "Stored: " << cir_buf3.stored() << ", free: " << cir_buf3.free() << std::endl;
+  for (size_t i=1; i<cir_buf3.stored(); i++) {
+    std::cout << int(cir_buf3[i]) << std::endl;
+  }
+
+  // test static circular buffer
+  std::cout << "Test static circular buffer" << std::endl;
+  StaticCircularBuffer<double, 8> st_buf;
+  st_buf.push(buf1);
+  st_buf.push(buf1);
+  std::cout << "Push when full: " << (st_buf.push(5.0) ? "successful" : "not successful") << std::endl;
+  st_buf.pull(buf2, 2);
+  st_buf.drop(1);
+  st_buf.push(buf1.head(3));
+  std::cout << "Stored: " << st_buf.stored() << ", free: " << st_buf.free() << std::endl;
+  for (size_t i=0; i<st_buf.stored(); i++) {
+    std::cout << st_buf[i] << std::endl;
+  }
+
   return 0;
 }
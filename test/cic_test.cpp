@@ -0,0 +1,102 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/cic.h"
+#include "../src/fixed.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+// direct (non-recursive) CIC reference: moving sum of R*M samples, N times
+static std::vector<double> reference(const std::vector<double> &x, size_t N, size_t R, size_t M) {
+  std::vector<double> y(x);
+  for (size_t s=0; s<N; s++) {
+    std::vector<double> z(y.size(), 0);
+    for (size_t i=0; i<y.size(); i++) {
+      for (size_t j=0; j<(R*M) && j<=i; j++) { z[i] += y[i-j]; }
+    }
+    y = z;
+  }
+  return y;
+}
+
+
+int main() {
+
+  // DC gain of a 4th order decimator by 8 (exactly 1) and by 5 (< 1)
+  const size_t L = 200;
+  Buffer<int16_t> dc(L);
+  for (size_t i=0; i<L; i++) { dc[i] = 1000; }
+  CICDecimator<int16_t> cic8(4, 8), cic5(4, 5);
+  Buffer<int16_t> out(cic8.maxOutputs(L));
+  size_t n = cic8.process(dc, out);
+  std::cout << "R=8: " << n << " outputs, gain " << cic8.gain() << ", settled " << out[n-1] << std::endl;
+  out = Buffer<int16_t>(cic5.maxOutputs(L));
+  n = cic5.process(dc, out);
+  std::cout << "R=5: " << n << " outputs, gain " << cic5.gain() << ", settled " << out[n-1] << std::endl;
+
+  // complex int16 input in blocks of odd sizes against the direct reference
+  const size_t N = 3, R = 6, M = 2, S = 301;
+  Buffer<cint16> in(S);
+  std::vector<double> re(S), im(S);
+  for (size_t i=0; i<S; i++) {
+    in[i] = cint16(int16_t(8000*std::cos(0.05*i)), int16_t(-32768 + (i*613)%65536));
+    re[i] = in[i].real(); im[i] = in[i].imag();
+  }
+  CICDecimator<cint16> cic(N, R, M);
+  Buffer<cint16> dec(cic.maxOutputs(S));
+  size_t count = 0, offset = 0, blocks[] = {7, 1, 50, 13, 230};
+  for (size_t b=0; b<5; b++) {
+    count += cic.process(in.sub(offset, blocks[b]), dec.sub(count, dec.size()-count));
+    offset += blocks[b];
+  }
+  std::vector<double> rre = reference(re, N, R, M), rim = reference(im, N, R, M);
+  double scale = std::pow(2., -std::ceil(N*std::log2(double(R*M)))), max_err = 0;
+  for (size_t k=0; k<count; k++) {
+    size_t i = k*R+R-1;
+    max_err = std::max(max_err, std::abs(std::floor(rre[i]*scale)-dec[k].real()));
+    max_err = std::max(max_err, std::abs(std::floor(rim[i]*scale)-dec[k].imag()));
+  }
+  std::cout << "Complex, blocks: " << count << " outputs, max. error " << max_err << std::endl;
+
+  // compensation FIR flattens the passband
+  std::vector<double> taps = CICDecimator<int32_t>::compensationTaps(4, 16, 1, 15, 0.25);
+  double gain = 0;
+  std::cout << "Compensation taps:";
+  for (size_t i=0; i<taps.size(); i++) { std::cout << " " << taps[i]; }
+  std::cout << std::endl;
+  for (size_t k=0; k<=4; k++) {
+    double f = 0.05*k;
+    std::complex<double> h(0, 0);
+    for (size_t i=0; i<taps.size(); i++) { h += taps[i]*std::exp(std::complex<double>(0, -2*M_PI*f*i)); }
+    gain = std::abs(h)*CICDecimator<int32_t>::response(4, 16, 1, f);
+    std::cout << "  f=" << f << ": CIC " << CICDecimator<int32_t>::response(4, 16, 1, f)
+              << ", compensated " << gain << std::endl;
+  }
+
+  // compensated response up to the passband edge within the stated ripple
+  size_t lengths[] = {15, 31};
+  double ripples[] = {0.05, 0.005};
+  bool flat = true;
+  for (size_t t=0; t<2; t++) {
+    taps = CICDecimator<int32_t>::compensationTaps(4, 16, 1, lengths[t], 0.25);
+    double dev = 0;
+    for (size_t k=0; k<=250; k++) {
+      double f = 0.001*k;
+      std::complex<double> h(0, 0);
+      for (size_t i=0; i<taps.size(); i++) { h += taps[i]*std::exp(std::complex<double>(0, -2*M_PI*f*i)); }
+      dev = std::max(dev, std::abs(std::abs(h)*CICDecimator<int32_t>::response(4, 16, 1, f) - 1));
+    }
+    std::cout << "Compensation " << lengths[t] << " taps, ripple up to 0.25 within " << ripples[t]
+              << ": " << (dev <= ripples[t]) << std::endl;
+    flat = flat && (dev <= ripples[t]);
+  }
+
+  // compensated DC gain stays 1
+  CICDecimator<int32_t> comp(4, 16, 1, 15, 0.25);
+  Buffer<int32_t> dc32(16*64), out32(comp.maxOutputs(16*64));
+  for (size_t i=0; i<dc32.size(); i++) { dc32[i] = 100000; }
+  n = comp.process(dc32, out32);
+  std::cout << "Compensated DC: " << out32[n-1] << std::endl;
+
+  return flat ? 0 : 1;
+}
@@ -0,0 +1 @@
+gcc cic_test.cpp ../src/buffer.cpp -lstdc++ -lm -o cic_test.o
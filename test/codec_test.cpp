@@ -0,0 +1,84 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/codec.h"
+#include "../src/fixed.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+int main() {
+
+  // 12-bit and 10-bit packing round trips (odd lengths exercise the tails)
+  const size_t N = 1001;
+  Buffer<int16_t> in(N), back(N);
+  int widths[] = {12, 10, 7, 16};
+  for (size_t w=0; w<4; w++) {
+    int bits = widths[w];
+    int32_t hi = (1 << (bits-1))-1, lo = -(1 << (bits-1));
+    for (size_t i=0; i<N; i++) { in[i] = int16_t(lo + int32_t((i*2654435761u) % uint32_t(hi-lo+1))); }
+    in[0] = int16_t(lo); in[1] = int16_t(hi);
+    Buffer<uint8_t> packed(packedSize(N, bits));
+    size_t bytes = pack(in, packed, bits);
+    size_t n = unpack(packed, back, N, bits);
+    size_t errors = 0;
+    for (size_t i=0; i<N; i++) { errors += (in[i] != back[i]); }
+    std::cout << bits << "-bit: " << bytes << " bytes, " << n << " samples, errors " << errors << std::endl;
+  }
+
+  // saturation to the field width
+  Buffer<int16_t> big(4);
+  big[0] = 3000; big[1] = -3000; big[2] = 2047; big[3] = -2048;
+  Buffer<uint8_t> pb(packedSize(4, 12));
+  pack(big, pb, 12);
+  unpack(pb, big, 4, 12);
+  std::cout << "Saturated: " << big << std::endl;
+
+  // a noisy low-level complex signal: delta + Rice compresses losslessly
+  const size_t M = 50000;
+  Buffer<cint16> iq(M);
+  uint32_t state = 1;
+  for (size_t i=0; i<M; i++) {
+    state = state*1664525u + 1013904223u;
+    int noise = int(state >> 28) - 8;
+    iq[i] = cint16(int16_t(1500*std::cos(0.01*i) + noise), int16_t(1500*std::sin(0.01*i) - noise));
+  }
+  Buffer<int16_t> values = iq.as<int16_t>();
+  IQBlockHeader::Mode modes[] = {IQBlockHeader::RAW16, IQBlockHeader::PACKED, IQBlockHeader::DELTA_RICE};
+  const char *names[] = {"raw16", "packed12", "delta+rice"};
+  for (size_t m=0; m<3; m++) {
+    IQEncoder enc(modes[m], 4096, 2, 12);
+    std::vector<uint8_t> stream;
+    enc.encode(values.head(30000), stream);
+    enc.encode(values.tail(values.size()-30000), stream);
+    std::vector<int16_t> decoded;
+    size_t used = IQDecoder::decode(&stream[0], stream.size(), decoded);
+    size_t errors = (decoded.size() != values.size());
+    for (size_t i=0; (i<decoded.size()) && (i<values.size()); i++) { errors += (decoded[i] != values[i]); }
+    std::cout << names[m] << ": " << stream.size() << " bytes (" << int(100.*stream.size()/(2*values.size()))
+              << "% of int16), consumed " << (used == stream.size()) << ", errors " << errors << std::endl;
+
+    // random access
+    if (IQBlockHeader::DELTA_RICE == modes[m]) {
+      IQBlockIndex index(&stream[0], stream.size());
+      Buffer<int16_t> part(5000);
+      size_t n = index.read(12345, part, part.size());
+      size_t perrors = 0;
+      for (size_t i=0; i<n; i++) { perrors += (part[i] != values[12345+i]); }
+      std::cout << "Index: " << index.size() << " blocks, block of 70000: " << index.find(70000)
+                << ", read " << n << " values at 12345, errors " << perrors
+                << ", beyond end: " << (index.find(100000) == index.size()) << std::endl;
+    }
+  }
+
+  // incompressible data falls back to raw
+  for (size_t i=0; i<N; i++) { state = state*1664525u + 1013904223u; in[i] = int16_t(state >> 16); }
+  IQEncoder enc;
+  std::vector<uint8_t> stream;
+  enc.encode(in, stream);
+  IQBlockHeader h;
+  IQDecoder::header(&stream[0], stream.size(), h);
+  std::cout << "Random data: mode " << int(h.mode) << ", " << stream.size() << " bytes" << std::endl;
+  std::cout << "Truncated block: " << IQDecoder::header(&stream[0], stream.size()-1, h) << std::endl;
+
+  return 0;
+}
@@ -0,0 +1 @@
+gcc codec_test.cpp ../src/codec.cpp ../src/buffer.cpp -lstdc++ -lm -o codec_test.o
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/conditioner.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+// ratio of the power at -f to the power at +f over the given span
+static double imageRatio(const Buffer< std::complex<float> > &x, double f) {
+  std::complex<double> pos(0, 0), neg(0, 0);
+  for (size_t i=0; i<x.size(); i++) {
+    std::complex<double> v(x[i].real(), x[i].imag());
+    pos += v*std::exp(std::complex<double>(0, -2*M_PI*f*i));
+    neg += v*std::exp(std::complex<double>(0, 2*M_PI*f*i));
+  }
+  return std::norm(neg)/std::norm(pos);
+}
+
+
+int main() {
+
+  // tone with DC offset, IQ gain and phase imbalance at a low level
+  const size_t N = 200000;
+  const double f = 0.0123, A = 0.01;
+  Buffer< std::complex<float> > in(N), out(N), ref(N);
+  for (size_t i=0; i<N; i++) {
+    in[i] = std::complex<float>(A*std::cos(2*M_PI*f*i) + 0.05,
+                                1.2*A*std::sin(2*M_PI*f*i + 0.1) - 0.02);
+  }
+  std::cout << "Input image ratio: " << 10*std::log10(imageRatio(in.tail(8192), f)) << " dB" << std::endl;
+
+  // process in irregular blocks
+  IQConditioner cond(2048, 8192);
+  cond.setAGC(0.5, 128, 4096);
+  size_t offset = 0, len = 1;
+  while (offset < N) {
+    size_t n = std::min(len, N-offset);
+    cond.process(in.sub(offset, n), out.sub(offset, n));
+    offset += n; len = (len*7 + 3) % 1001;
+  }
+  std::cout << "DC estimate: " << cond.dc() << std::endl;
+  std::cout << "Output image ratio: "
+            << (10*std::log10(imageRatio(out.tail(8192), f)) < -40 ? "< -40 dB" : "too large") << std::endl;
+  double rms = out.tail(8192).norm_l2()/std::sqrt(8192.);
+  std::cout << "Output RMS: " << (std::abs(rms-0.5) < 0.01 ? "0.5" : "wrong") << std::endl;
+
+  // the same in one block
+  IQConditioner single(2048, 8192);
+  single.setAGC(0.5, 128, 4096);
+  single.process(in, ref);
+  double max_diff = 0;
+  for (size_t i=0; i<N; i++) { max_diff = std::max(max_diff, double(std::abs(ref[i]-out[i]))); }
+  std::cout << "Block split difference: " << (max_diff < 1e-4 ? "< 1e-4" : "too large") << std::endl;
+
+  // level step: AGC follows
+  for (size_t i=0; i<N; i++) { in[i] *= 100; }
+  cond.process(in, out);
+  rms = out.tail(8192).norm_l2()/std::sqrt(8192.);
+  std::cout << "Output RMS after +40 dB step: " << (std::abs(rms-0.5) < 0.01 ? "0.5" : "wrong") << std::endl;
+
+  // fixed gain, no AGC
+  cond.setGain(2);
+  cond.process(in.head(1024), out.head(1024));
+  std::cout << "Fixed gain: " << cond.gain() << std::endl;
+
+  return 0;
+}
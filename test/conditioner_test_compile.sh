@@ -0,0 +1 @@
+gcc conditioner_test.cpp ../src/conditioner.cpp ../src/buffer.cpp -lstdc++ -lm -o conditioner_test.o
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/coroutine.h"
+#include "../src/buffer.h"
+#include "../src/broadcast.h"
+#include <inttypes.h>
+#include <thread>
+using namespace sdr;
+
+// Pushes blocks of 3 ones as long as there is space
+Task producer(CircularBuffer<int> &out, size_t blocks) {
+  Buffer<int> block(3);
+  for (size_t i=0; i<3; i++) { block[i] = 1; }
+  for (size_t i=0; i<blocks; i++) {
+    co_await out.writable(3);
+    out.push(block);
+  }
+}
+
+// Moves blocks of 5 from in to out
+Task relay(CircularBuffer<int> &in, StaticCircularBuffer<int, 16> &out) {
+  Buffer<int> block(5);
+  for (;;) {
+    co_await in.readable(5);
+    co_await out.writable(5);
+    in.pull(block, 5);
+    out.push(block);
+  }
+}
+
+// Sums blocks of 2
+Task consumer(StaticCircularBuffer<int, 16> &in, int &sum) {
+  Buffer<int> block(2);
+  for (;;) {
+    co_await in.readable(2);
+    in.pull(block, 2);
+    sum += block[0] + block[1];
+  }
+}
+
+// Reads from a broadcast buffer
+Task reader(BroadcastBuffer<int> &in, int id, size_t n, int &sum) {
+  for (;;) {
+    co_await in.readable(id, n);
+    Buffer<int> view = in.peek(id, n);
+    for (size_t i=0; i<view.size(); i++) { sum += view[i]; }
+    in.drop(id, view.size());
+  }
+}
+
+// Condition on a ring that counts how often it is checked
+struct CountedCondition {
+  const CircularBuffer<int> &ring;
+  int &checks;
+  bool holds() const { checks++; return ring.stored() > 0; }
+  const void *source() const { return &ring; }
+};
+
+// Waits for data on a ring
+Task idler(const CircularBuffer<int> &ring, int &checks, int &woken) {
+  co_await CountedCondition{ring, checks};
+  woken++;
+}
+
+
+int main() {
+
+  std::cout << "Test coroutine stages" << std::endl;
+  CircularBuffer<int> ring1(8);
+  StaticCircularBuffer<int, 16> ring2;
+  int sum = 0;
+  Executor executor;
+  executor.spawn(producer(ring1, 20));
+  executor.spawn(relay(ring1, ring2));
+  executor.spawn(consumer(ring2, sum));
+  size_t n = executor.run();
+  std::cout << "Resumptions: " << n << ", pending: " << executor.pending() << std::endl;
+  std::cout << "Sum: " << sum << " (60 pushed, stored: " << ring1.stored() << " + " << ring2.stored() << ")" << std::endl;
+
+  std::cout << "Test many readers on a broadcast buffer" << std::endl;
+  BroadcastBuffer<int> bcast(64, 1000);
+  std::vector<int> sums(1000, 0);
+  for (size_t i=0; i<1000; i++) {
+    executor.spawn(reader(bcast, bcast.addReader(), 4+(i%4), sums[i]));
+  }
+  Buffer<int> block(16);
+  for (size_t i=0; i<16; i++) { block[i] = 1; }
+  for (size_t i=0; i<10; i++) {
+    while (! bcast.push(block)) { executor.run(); }
+    executor.run();
+  }
+  int min = sums[0], max = sums[0];
+  for (size_t i=0; i<1000; i++) { min = std::min(min, sums[i]); max = std::max(max, sums[i]); }
+  std::cout << "Reader sums: " << min << " to " << max << ", pending: " << executor.pending() << std::endl;
+
+  std::cout << "Test waiters on idle rings" << std::endl;
+  Executor indexed;
+  CircularBuffer<int> idle(4), ring3(8);
+  StaticCircularBuffer<int, 16> ring4;
+  int checks = 0, woken = 0, sum2 = 0;
+  for (size_t i=0; i<100; i++) { indexed.spawn(idler(idle, checks, woken)); }
+  indexed.run();
+  checks = 0;
+  indexed.spawn(producer(ring3, 20));
+  indexed.spawn(relay(ring3, ring4));
+  indexed.spawn(consumer(ring4, sum2));
+  n = indexed.run();
+  std::cout << "Resumptions: " << n << ", sum: " << sum2 << ", checks of idle waiters: " << checks << std::endl;
+  idle.push(block.head(1));
+  indexed.run();
+  std::cout << "Woken: " << woken << ", pending: " << indexed.pending() << std::endl;
+
+  std::cout << "Test blocking wait" << std::endl;
+  Executor blocking;
+  BroadcastBuffer<int> shared(64);
+  int got = 0;
+  blocking.spawn(reader(shared, shared.addReader(), 16, got));
+  std::thread writer([&shared, &blocking, &block]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    shared.push(block);
+    blocking.notify();
+  });
+  size_t rounds = 0;
+  while ((0 == got) && (rounds < 100)) { blocking.wait(1000); rounds++; }
+  writer.join();
+  std::cout << "Sum after wait: " << got << std::endl;
+
+  return 0;
+}
@@ -0,0 +1 @@
+gcc -std=c++20 coroutine_test.cpp ../src/coroutine.cpp ../src/buffer.cpp -lstdc++ -lm -pthread -o coroutine_test.o
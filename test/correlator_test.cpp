@@ -0,0 +1,98 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/correlator.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+// uniform noise in [-1, 1) from a linear congruential generator
+static float noise(uint32_t &state) {
+  state = state*1664525u + 1013904223u;
+  return float(state >> 8)/8388608.f - 1.f;
+}
+
+
+int main() {
+
+  // QPSK preamble of length 127
+  const size_t L = 127, N = 20000;
+  uint32_t state = 12345;
+  Buffer< std::complex<float> > pre(L), stream(N);
+  for (size_t i=0; i<L; i++) {
+    pre[i] = std::complex<float>(noise(state) > 0 ? 1 : -1, noise(state) > 0 ? 1 : -1);
+  }
+  // noise with three preambles at different levels and phases
+  for (size_t i=0; i<N; i++) { stream[i] = 0.2f*std::complex<float>(noise(state), noise(state)); }
+  size_t offsets[] = {1000, 7777, 19000};
+  float gains[] = {0.5, 3, 0.2};
+  for (size_t e=0; e<3; e++) {
+    std::complex<float> g = gains[e]*std::exp(std::complex<float>(0, 0.9*e));
+    for (size_t i=0; i<L; i++) { stream[offsets[e]+i] += g*pre[i]; }
+  }
+
+  // process in irregular blocks, extract the spans as views
+  PreambleCorrelator corr(pre, 0.5);
+  std::cout << "Preamble " << corr.length() << ", FFT size " << corr.fftSize() << std::endl;
+  std::vector<PreambleCorrelator::Event> events;
+  size_t offset = 0, len = 100;
+  while (offset < N) {
+    size_t n = std::min(len, N-offset);
+    corr.process(stream.sub(offset, n), events);
+    offset += n; len = (len*3+17) % 3001;
+  }
+  // flush the last candidate
+  Buffer< std::complex<float> > zeros(2*corr.fftSize());
+  for (size_t i=0; i<zeros.size(); i++) { zeros[i] = 0; }
+  corr.process(zeros, events);
+
+  for (size_t e=0; e<events.size(); e++) {
+    Buffer< std::complex<float> > span = PreambleCorrelator::span(stream, 0, events[e], L);
+    std::cout << "Event at " << events[e].offset << ", metric " << (events[e].metric > 0.5 ? "> 0.5" : "low")
+              << ", phase " << std::floor(10*std::arg(events[e].correlation)+0.5)/10
+              << ", span is view: " << (span.data() == stream.data()+events[e].offset*sizeof(std::complex<float>))
+              << std::endl;
+  }
+  // the running energy carried across blocks matches a direct computation
+  bool direct = true;
+  for (size_t e=0; e<events.size(); e++) {
+    double ep = 0, ex = 0;
+    std::complex<double> r = 0;
+    for (size_t i=0; i<L; i++) {
+      std::complex<float> x = stream[events[e].offset+i];
+      ep += std::norm(pre[i]); ex += std::norm(x);
+      r += std::complex<double>(x)*std::conj(std::complex<double>(pre[i]));
+    }
+    direct = direct && (std::abs(events[e].metric - std::norm(r)/(ep*ex)) < 1e-4);
+  }
+  std::cout << "Metrics match direct correlation: " << direct << std::endl;
+  // long stream: a loud burst, then a weak preamble near the end, which is
+  // only reported by flush()
+  const size_t LN = 400000, at = LN-L-50;
+  Buffer< std::complex<float> > longStream(LN);
+  for (size_t i=0; i<LN; i++) { longStream[i] = 1e-3f*std::complex<float>(noise(state), noise(state)); }
+  for (size_t i=2000; i<4000; i++) { longStream[i] = 3e4f*std::complex<float>(noise(state), noise(state)); }
+  for (size_t i=0; i<L; i++) { longStream[at+i] += 0.01f*pre[i]; }
+  PreambleCorrelator longCorr(pre, 0.5);
+  std::vector<PreambleCorrelator::Event> longEvents;
+  for (size_t offset=0; offset<LN; offset+=4096) {
+    longCorr.process(longStream.sub(offset, std::min(size_t(4096), LN-offset)), longEvents);
+  }
+  size_t before = longEvents.size();
+  size_t flushed = longCorr.flush(longEvents);
+  std::cout << "Long stream: " << before << " events before flush, " << flushed << " flushed";
+  if (longEvents.size()) {
+    double ep = 0, ex = 0;
+    std::complex<double> r = 0;
+    for (size_t i=0; i<L; i++) {
+      std::complex<float> x = longStream[longEvents.back().offset+i];
+      ep += std::norm(pre[i]); ex += std::norm(x);
+      r += std::complex<double>(x)*std::conj(std::complex<double>(pre[i]));
+    }
+    std::cout << " at " << longEvents.back().offset << " (expected " << at << "), metric matches direct: "
+              << (std::abs(longEvents.back().metric - std::norm(r)/(ep*ex)) < 1e-4);
+  }
+  std::cout << ", offsets restart: " << longCorr.consumed() << std::endl;
+  std::cout << "Span outside block: " << PreambleCorrelator::span(stream.head(100), 0, events[0], L).size() << std::endl;
+
+  return 0;
+}
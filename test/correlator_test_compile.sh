@@ -0,0 +1 @@
+gcc correlator_test.cpp ../src/correlator.cpp ../src/fft.cpp ../src/buffer.cpp -lstdc++ -lm -o correlator_test.o
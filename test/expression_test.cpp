@@ -0,0 +1,65 @@
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include "../src/expression.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+int main() {
+
+  // real valued expressions
+  std::cout << "Test real valued expressions" << std::endl;
+  Buffer<float> a(4), b(4), out(4);
+  for (size_t i=0; i<4; i++) { a[i] = i+1; b[i] = 2; }
+  eval(out, a*b + 1);
+  std::cout << "a*b+1: " << out << std::endl;
+  eval(out, 2.0*(a-b)/b);
+  std::cout << "2*(a-b)/b: " << out << std::endl;
+  eval(out, abs(-a));
+  std::cout << "abs(-a): " << out << std::endl;
+
+  // in-place evaluation
+  eval(a, a*a);
+  std::cout << "a*a (in-place): " << a << std::endl;
+
+  // complex valued expressions
+  std::cout << "Test complex valued expressions" << std::endl;
+  Buffer< std::complex<float> > x(3), y(3), z(3);
+  for (size_t i=0; i<3; i++) {
+    x[i] = std::complex<float>(i, 1);
+    y[i] = std::complex<float>(0, 1);
+  }
+  eval(z, 0.5*x*conj(y) + std::complex<float>(1, 0));
+  std::cout << "0.5*x*conj(y)+1: " << z << std::endl;
+  eval(z, x/y);
+  std::cout << "x/y: " << z << std::endl;
+  Buffer<float> re(3), im(3), mag(3);
+  eval(re, real(x)); eval(im, imag(x)); eval(mag, abs(x));
+  std::cout << "real(x): " << re << std::endl;
+  std::cout << "imag(x): " << im << std::endl;
+  std::cout << "abs(x): " << mag << std::endl;
+
+  // evaluation into a view and a new buffer
+  eval(out.head(3), re + im);
+  std::cout << "re+im into view: " << out << std::endl;
+  Buffer<float> sum = eval(re*re + im*im);
+  std::cout << "re*re+im*im (new buffer): " << sum << std::endl;
+
+  // size mismatch
+  std::cout << "Size mismatch: " << (eval(out, re+im) ? "evaluated" : "rejected") << std::endl;
+
+  // integer buffers keep fractional scalars, converted once on assignment
+  Buffer<int16_t> iq(3), scaled(3);
+  for (size_t i=0; i<3; i++) { iq[i] = int16_t(100*(i+1)); }
+  eval(scaled, iq*2.5);
+  std::cout << "int16*2.5: " << scaled << std::endl;
+  eval(scaled, iq*0.5 + iq/4.0);
+  std::cout << "int16*0.5+int16/4.0: " << scaled << std::endl;
+
+  // unrelated types are not affected
+  std::string s = std::string("no ") + "interference";
+  std::cout << s << std::endl;
+
+  return 0;
+}
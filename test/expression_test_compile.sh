@@ -0,0 +1 @@
+gcc expression_test.cpp ../src/buffer.cpp -lstdc++ -lm -o expression_test.o
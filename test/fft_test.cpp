@@ -0,0 +1,40 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/fft.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+int main() {
+
+  // forward transform against the DFT
+  const size_t N = 64;
+  Buffer< std::complex<float> > x(N), X(N), y(N);
+  for (size_t i=0; i<N; i++) { x[i] = std::complex<float>(std::cos(0.3*i)+0.1*i, std::sin(1.1*i)); }
+  FFT fwd(N), inv(N, true);
+  fwd.execute(x, X);
+  double max_err = 0;
+  for (size_t k=0; k<N; k++) {
+    std::complex<double> ref(0, 0);
+    for (size_t i=0; i<N; i++) {
+      ref += std::complex<double>(x[i].real(), x[i].imag())*std::exp(std::complex<double>(0, -2*M_PI*double(k*i)/N));
+    }
+    max_err = std::max(max_err, std::abs(ref-std::complex<double>(X[k].real(), X[k].imag())));
+  }
+  std::cout << "FFT size " << fwd.size() << ", max. error vs DFT: " << (max_err < 1e-3 ? "< 1e-3" : "too large") << std::endl;
+
+  // inverse in place restores the input (times N)
+  y = X.sub(0, N);
+  inv.execute(y, y);
+  max_err = 0;
+  for (size_t i=0; i<N; i++) { max_err = std::max(max_err, double(std::abs(y[i]/float(N)-x[i]))); }
+  std::cout << "Round trip max. error: " << (max_err < 1e-4 ? "< 1e-4" : "too large") << std::endl;
+
+  // a tone ends up in one bin
+  for (size_t i=0; i<N; i++) { x[i] = std::exp(std::complex<float>(0, 2*M_PI*5*i/N)); }
+  fwd.execute(x, X);
+  std::cout << "Tone bin 5: " << std::abs(X[5]) << ", bin 6: " << (std::abs(X[6]) < 1e-3 ? 0 : std::abs(X[6])) << std::endl;
+  std::cout << "Next power of two of 100: " << FFT::nextPow2(100) << std::endl;
+
+  return 0;
+}
@@ -0,0 +1 @@
+gcc fft_test.cpp ../src/fft.cpp ../src/buffer.cpp -lstdc++ -lm -o fft_test.o
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/fixed.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+int main() {
+
+  const size_t N = 37;
+  Buffer<cint16> in(N), out(N);
+  for (size_t i=0; i<N; i++) { in[i] = cint16(1000*(int(i%5)-2), -500*(int(i%3)-1)); }
+  in[0] = cint16(-32768, -32768);
+  std::cout << "Input: " << in.as<int16_t>() << std::endl;
+
+  // scaling by 0.5 (Q15)
+  scale(in, out, 16384);
+  std::cout << "Scaled by 0.5: " << out.as<int16_t>() << std::endl;
+
+  // magnitude and power
+  Buffer<int16_t> mag(N);
+  Buffer<uint32_t> pwr(N);
+  magnitude(in, mag);
+  power(in, pwr);
+  std::cout << "Magnitude: " << mag << std::endl;
+  std::cout << "Power: " << pwr << std::endl;
+
+  // the SSE body and the scalar tail round alike (result independent of N % 8)
+  Buffer<cint16> odd(1000);
+  Buffer<int16_t> full(1000), part(1000);
+  for (size_t i=0; i<odd.size(); i++) { odd[i] = cint16(int16_t((i*7919)%65536-32768), int16_t((i*104729)%65536-32768)); }
+  magnitude(odd, full);
+  size_t diffs = 0;
+  for (size_t i=0; i<8; i++) {
+    magnitude(odd.sub(i, 7), part);
+    for (size_t j=0; j<7; j++) { diffs += (part[j] != full[i+j]); }
+  }
+  std::cout << "Magnitude tail differences: " << diffs << std::endl;
+
+  // mixer against floating point reference
+  FixedMixer mixer(0.125);
+  mixer.process(in, out);
+  double max_err = 0;
+  for (size_t i=1; i<N; i++) {
+    std::complex<double> ref = std::complex<double>(in[i].real(), in[i].imag()) *
+        std::exp(std::complex<double>(0, 2*M_PI*0.125*i));
+    max_err = std::max(max_err, std::abs(ref-std::complex<double>(out[i].real(), out[i].imag())));
+  }
+  std::cout << "Mixer max. error: " << (max_err < 4 ? "< 4 LSB" : "too large") << std::endl;
+
+  // FIR decimator against floating point reference, processed in two blocks
+  std::vector<float> taps(11);
+  for (size_t i=0; i<taps.size(); i++) { taps[i] = 1./taps.size(); }
+  FixedFIR fir(taps, 3);
+  Buffer<cint16> dec(fir.maxOutputs(N));
+  size_t n1 = fir.process(in.head(20), dec);
+  size_t n2 = fir.process(in.tail(N-20), dec.tail(dec.size()-n1));
+  std::cout << "FIR outputs: " << n1 << " + " << n2 << std::endl;
+  max_err = 0;
+  for (size_t k=0; k<(n1+n2); k++) {
+    std::complex<double> ref(0, 0);
+    for (size_t j=0; j<taps.size(); j++) {
+      if ((3*k) >= j) {
+        ref += double(taps[j])*std::complex<double>(in[3*k-j].real(), in[3*k-j].imag());
+      }
+    }
+    max_err = std::max(max_err, std::abs(ref-std::complex<double>(dec[k].real(), dec[k].imag())));
+  }
+  std::cout << "FIR max. error: " << (max_err < 4 ? "< 4 LSB" : "too large") << std::endl;
+
+  // copies have their own history: filtering zeros with a copy must not
+  // change the output of the original
+  FixedFIR orig(taps), ref(taps);
+  Buffer<cint16> o1(orig.maxOutputs(N)), o2(orig.maxOutputs(N)), silence(N);
+  for (size_t i=0; i<N; i++) { silence[i] = cint16(0, 0); }
+  orig.process(in.head(20), o1); ref.process(in.head(20), o2);
+  FixedFIR copy(orig);
+  copy.process(silence.head(20), o1);
+  size_t c1 = orig.process(in.tail(N-20), o1), c2 = ref.process(in.tail(N-20), o2);
+  bool same = (c1 == c2);
+  for (size_t k=0; same && (k<c1); k++) { same = (o1[k] == o2[k]); }
+  FixedFIR assigned(std::vector<float>(3, 0.f));
+  assigned = ref;
+  assigned.process(silence.head(20), o1);
+  FixedMixer mcopy(mixer), mref(mixer);
+  Buffer<cint16> m1(N), m2(N);
+  mcopy.process(silence, m1);
+  mixer.process(in, m1); mref.process(in, m2);
+  for (size_t k=0; k<N; k++) { same = same && (m1[k] == m2[k]); }
+  std::cout << "Copies independent: " << same << std::endl;
+
+  // large taps accumulate in 64 bits and saturate
+  FixedFIR loud(std::vector<float>(8, 0.9f));
+  Buffer<cint16> extreme(16), sat(loud.maxOutputs(16));
+  for (size_t i=0; i<16; i++) { extreme[i] = cint16(-32768, 32767); }
+  loud.process(extreme, sat);
+  std::cout << "Wide: " << fir.wide() << " " << loud.wide() << ", saturated: " << sat[15] << std::endl;
+
+  // no taps: a single zero tap
+  FixedFIR none((std::vector<float>()));
+  Buffer<cint16> zeros(none.maxOutputs(N));
+  size_t nz = none.process(in, zeros);
+  std::cout << "Empty FIR: " << none.numTaps() << " tap, " << nz << " outputs, first " << zeros[0] << std::endl;
+
+  // conversion to float
+  Buffer< std::complex<float> > flt(N);
+  toFloat(dec.head(n1+n2), flt.head(n1+n2));
+  std::cout << "As float: " << flt.head(n1+n2) << std::endl;
+
+  return 0;
+}
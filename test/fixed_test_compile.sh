@@ -0,0 +1 @@
+gcc fixed_test.cpp ../src/fixed.cpp ../src/buffer.cpp -lstdc++ -lm -o fixed_test.o
@@ -0,0 +1,175 @@
+#include <iostream>
+#include <stdlib.h>
+#include <cstring>
+#include <thread>
+#include "../src/generator.h"
+#include <inttypes.h>
+using namespace sdr;
+
+typedef std::complex<float> cf32;
+
+
+// returns the mean power of the samples
+static double power(const Buffer<cf32> &x) {
+  double p = 0;
+  for (size_t i=0; i<x.size(); i++) { p += std::norm(x[i]); }
+  return p/x.size();
+}
+
+
+int main() {
+
+  // counter-based: any word directly, also across the 2^32 boundary
+  std::cout << "Test random words" << std::endl;
+  CounterRNG rng(42);
+  Buffer<uint32_t> words(1001);
+  uint64_t start = (uint64_t(1) << 32) - 500;
+  rng.fill(start, words);
+  size_t errors = 0;
+  for (size_t i=0; i<words.size(); i++) { errors += (words[i] != rng(start+i)); }
+  std::cout << "fill vs single words: errors " << errors << ", other seed equal: "
+            << (CounterRNG(43)(start) == words[0]) << std::endl;
+
+  Buffer<float> gauss(1 << 20);
+  rng.gaussian(0, gauss, 2);
+  double mean = 0, var = 0, peak = 0;
+  for (size_t i=0; i<gauss.size(); i++) { mean += gauss[i]; var += gauss[i]*gauss[i]; peak = std::max(peak, double(std::abs(gauss[i]))); }
+  mean /= gauss.size(); var = var/gauss.size() - mean*mean;
+  std::cout << "Gaussian: mean " << (std::abs(mean) < 0.01) << ", sigma " << (std::abs(std::sqrt(var)-2) < 0.01)
+            << ", peak " << peak/2 << " sigma" << std::endl;
+
+  // the output does not depend on the block split, seek jumps anywhere
+  std::cout << "Test reproducibility" << std::endl;
+  const size_t N = 20000;
+  SignalGenerator gen(7);
+  gen.addTone(0.1, 0.5, 1);
+  gen.addTone(-0.23, 0.25);
+  gen.addChirp(-0.4, 0.4, 5000, 0.3);
+  gen.addCarrier(0.05, 10, 2, 0.5);
+  gen.setSNR(10);
+  Buffer<cf32> whole(N), parts(N);
+  gen.generate(whole);
+  SignalGenerator same(7);
+  same.addTone(0.1, 0.5, 1);
+  same.addTone(-0.23, 0.25);
+  same.addChirp(-0.4, 0.4, 5000, 0.3);
+  same.addCarrier(0.05, 10, 2, 0.5);
+  same.setSNR(10);
+  const size_t sizes[] = {1, 7, 63, 1000, 1025, 3};
+  for (size_t i=0, k=0; i<N; k++) {
+    size_t n = std::min(sizes[k%6], N-i);
+    same.generate(parts.sub(i, n));
+    i += n;
+  }
+  std::cout << "Blocks: equal " << (0 == std::memcmp(whole.data(), parts.data(), N*sizeof(cf32)))
+            << ", position " << same.position() << std::endl;
+  Buffer<cf32> tail(3000);
+  same.seek(12345);
+  same.generate(tail);
+  std::cout << "Seek: equal " << (0 == std::memcmp(tail.data(), whole.data()+12345*sizeof(cf32), tail.bytesLen())) << std::endl;
+  SignalGenerator other(8);
+  other.addTone(0.1, 0.5, 1);
+  other.setSNR(10);
+  other.generate(tail);
+  std::cout << "Other seed equal: " << (0 == std::memcmp(tail.data(), whole.data(), tail.bytesLen())) << std::endl;
+
+  // oscillator accuracy against the exact tone
+  std::cout << "Test tone" << std::endl;
+  SignalGenerator tone;
+  tone.addTone(0.1234567, 0.8, 0.5);
+  tone.seek(1000000);
+  Buffer<cf32> out(4096);
+  tone.generate(out);
+  double error = 0;
+  for (size_t i=0; i<out.size(); i++) {
+    std::complex<double> exact = std::polar(0.8, 0.5 + 2*M_PI*0.1234567*double(1000000+i));
+    error = std::max(error, std::abs(std::complex<double>(out[i]) - exact));
+  }
+  std::cout << "Max error below 1e-5: " << (error < 1e-5) << std::endl;
+
+  // chirp: instantaneous frequency sweeps linearly, phase continues at the wrap
+  std::cout << "Test chirp" << std::endl;
+  SignalGenerator chirp;
+  chirp.addChirp(-0.25, 0.25, 1000);
+  Buffer<cf32> sweep(2000);
+  chirp.generate(sweep);
+  double ferr = 0;
+  for (size_t i=0; i+1<sweep.size(); i++) {
+    double f = std::arg(sweep[i+1]*std::conj(sweep[i]))/(2*M_PI);
+    ferr = std::max(ferr, std::abs(f - (-0.25 + 0.5*double(i%1000)/1000)));
+  }
+  std::cout << "Frequency error below 1e-4: " << (ferr < 1e-4) << std::endl;
+
+  // carrier: QPSK symbols at the carrier frequency 0
+  std::cout << "Test carrier" << std::endl;
+  SignalGenerator psk(3);
+  psk.addCarrier(0, 8, 2);
+  Buffer<cf32> syms(8000);
+  psk.generate(syms);
+  size_t counts[4] = {0, 0, 0, 0}, bad = 0;
+  for (size_t i=0; i<syms.size(); i++) {
+    double q = std::arg(syms[i])/(M_PI/2);
+    long k = std::lround(q);
+    bad += (std::abs(q-k) > 1e-4) || (syms[i] != syms[i - i%8]);
+    counts[(k+4)%4] += (0 == i%8);
+  }
+  std::cout << "Off-constellation " << bad << ", symbols " << counts[0] << " " << counts[1] << " "
+            << counts[2] << " " << counts[3] << std::endl;
+
+  // noise at the given SNR
+  std::cout << "Test SNR" << std::endl;
+  SignalGenerator noisy(11);
+  noisy.addTone(0.2, 0.5);
+  noisy.addTone(0.3, 0.5);
+  noisy.setSNR(3);
+  Buffer<cf32> big(1 << 18);
+  noisy.generate(big);
+  double total = power(big), signal = noisy.signalPower();
+  std::cout << "Signal " << signal << ", noise " << noisy.noisePower() << ", measured SNR "
+            << std::lround(10*10*std::log10(signal/(total-signal)))/10. << " dB" << std::endl;
+  noisy.clear();
+  noisy.generate(big);
+  std::cout << "Cleared power: " << power(big) << std::endl;
+
+  // int16 output: scaled, rounded and saturated
+  std::cout << "Test int16" << std::endl;
+  SignalGenerator f(5), i16(5);
+  f.addTone(0.01, 2.5); f.setNoise(0.01);
+  i16.addTone(0.01, 2.5); i16.setNoise(0.01);
+  Buffer<cf32> fo(1001);
+  Buffer<cint16> io(1001);
+  f.generate(fo);
+  i16.generate(io, 16384);
+  size_t mismatch = 0, saturated = 0;
+  for (size_t i=0; i<fo.size(); i++) {
+    float re = std::min(std::max(fo[i].real()*16384, -32768.f), 32767.f);
+    float im = std::min(std::max(fo[i].imag()*16384, -32768.f), 32767.f);
+    mismatch += (std::abs(re - io[i].real()) > 0.5f) || (std::abs(im - io[i].imag()) > 0.5f);
+    saturated += (32767 == io[i].real()) || (-32768 == io[i].real());
+  }
+  std::cout << "Mismatch " << mismatch << ", saturated " << (saturated > 0) << std::endl;
+
+  // copies render disjoint ranges of one stream in parallel
+  std::cout << "Test threads" << std::endl;
+  SignalGenerator base(13);
+  base.addTone(0.1, 0.3); base.addCarrier(-0.2, 4, 2, 0.3); base.addChirp(-0.1, 0.1, 3000, 0.2);
+  base.setSNR(6);
+  const size_t M = 1 << 16;
+  Buffer<cint16> single(M), parallel(M);
+  SignalGenerator ref(base);
+  ref.generate(single, 16384);
+  std::thread threads[2];
+  for (size_t t=0; t<2; t++) {
+    threads[t] = std::thread([&base, &parallel, t, M]() {
+      SignalGenerator copy(base);
+      copy.seek(t*M/2);
+      for (size_t i=t*M/2; i<(t+1)*M/2; i+=1000) {
+        copy.generate(parallel.sub(i, std::min(size_t(1000), (t+1)*M/2-i)), 16384);
+      }
+    });
+  }
+  for (size_t t=0; t<2; t++) { threads[t].join(); }
+  std::cout << "Equal to single thread: " << (0 == std::memcmp(single.data(), parallel.data(), single.bytesLen())) << std::endl;
+
+  return 0;
+}
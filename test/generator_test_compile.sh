@@ -0,0 +1 @@
+gcc generator_test.cpp ../src/generator.cpp ../src/buffer.cpp -lstdc++ -lm -pthread -o generator_test.o
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include "../src/buffer.h"
+#include "../src/memory.h"
+#include "../src/logger.h"
+using namespace sdr;
+
+
+// prints the counters relative to a baseline
+static void print(const char *name, const MemoryStats &stats, const MemoryStats &base) {
+  std::cout << name << ": live " << (stats.live-base.live) << " bytes in " << (stats.count()-base.count())
+            << " buffers, " << (stats.allocations-base.allocations) << " allocations" << std::endl;
+}
+
+
+int main() {
+
+  StreamLogHandler *handler = new StreamLogHandler(std::cout, LOG_INFO);
+  Logger::get().addHandler(handler);
+  MemoryStats base = MemoryTracker::snapshot();
+
+  // live bytes follow the buffer lifetimes, views share the storage
+  std::cout << "Test live bytes" << std::endl;
+  {
+    Buffer<float> a(1000);
+    Buffer<float> view = a.sub(10, 100);
+    RawBuffer b(100);
+    print("two buffers", MemoryTracker::snapshot(), base);
+    a = Buffer<float>();
+    print("view keeps storage", MemoryTracker::snapshot(), base);
+  }
+  print("released", MemoryTracker::snapshot(), base);
+
+  // size classes and tags
+  std::cout << "Test size classes and tags" << std::endl;
+  std::cout << "Classes of 1, 2, 3, 4096, 4097: " << MemoryTracker::sizeClass(1) << " " << MemoryTracker::sizeClass(2)
+            << " " << MemoryTracker::sizeClass(3) << " " << MemoryTracker::sizeClass(4096)
+            << " " << MemoryTracker::sizeClass(4097) << std::endl;
+  CircularBuffer< std::complex<float> > *ring = 0;
+  std::vector< Buffer<int16_t> > blocks;
+  {
+    MemoryTag tag("ring");
+    ring = new CircularBuffer< std::complex<float> >(65536);
+    {
+      MemoryTag inner("block");
+      for (int i=0; i<8; i++) { blocks.push_back(Buffer<int16_t>(4096)); }
+    }
+    Buffer<float> other(16);
+  }
+  MemoryStats stats = MemoryTracker::snapshot();
+  int ring_tag = MemoryTracker::tagId("ring"), block_tag = MemoryTracker::tagId("block");
+  std::cout << "ring: " << stats.tag_live[ring_tag] << " bytes, " << stats.tag_allocations[ring_tag] << " allocations" << std::endl;
+  std::cout << "block: " << stats.tag_live[block_tag] << " bytes, " << stats.tag_allocations[block_tag] << " allocations" << std::endl;
+  std::cout << "8 KiB class: " << (stats.classCount(13)-base.classCount(13)) << " live" << std::endl;
+  std::cout << "Tag after scope: " << MemoryTracker::tag() << std::endl;
+  logMemoryStats(stats);
+
+  // the peak stays after releasing
+  std::cout << "Test peak" << std::endl;
+  MemoryTracker::resetPeak();
+  int64_t before = MemoryTracker::snapshot().peak;
+  delete ring;
+  blocks.clear();
+  {
+    Buffer<char> big(1 << 24);
+  }
+  stats = MemoryTracker::snapshot();
+  print("after release", stats, base);
+  std::cout << "Peak increase " << (stats.peak-before) << " bytes" << std::endl;
+
+  // allocated on other threads, released here
+  std::cout << "Test threads" << std::endl;
+  std::vector< Buffer<float> > shared(4);
+  std::vector<std::thread> threads;
+  for (int t=0; t<4; t++) {
+    threads.push_back(std::thread([t, &shared]() {
+      MemoryTag tag("worker");
+      for (int i=0; i<1000; i++) { Buffer<float> tmp(256); }
+      shared[t] = Buffer<float>(1024);
+    }));
+  }
+  for (size_t t=0; t<threads.size(); t++) { threads[t].join(); }
+  stats = MemoryTracker::snapshot();
+  print("workers exited", stats, base);
+  shared.clear();
+  stats = MemoryTracker::snapshot();
+  print("released here", stats, base);
+  int worker_tag = MemoryTracker::tagId("worker");
+  std::cout << "worker: " << stats.tag_live[worker_tag] << " bytes, " << stats.tag_allocations[worker_tag] << " allocations" << std::endl;
+
+  // leak report when the reporter goes out of scope
+  std::cout << "Test leak report" << std::endl;
+  Buffer<double> *leak = 0;
+  {
+    MemoryReporter reporter(20);
+    MemoryTag tag("leaky");
+    leak = new Buffer<double>(512);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  }
+  delete leak;
+  print("final", MemoryTracker::snapshot(), base);
+
+  return 0;
+}
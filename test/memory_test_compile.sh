@@ -0,0 +1 @@
+gcc memory_test.cpp ../src/memory.cpp ../src/logger.cpp ../src/buffer.cpp -pthread -lstdc++ -lm -o memory_test.o
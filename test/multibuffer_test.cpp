@@ -0,0 +1,78 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/multibuffer.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+int main() {
+
+  // de-interleave 2, 3 and 4 channels of complex float
+  const size_t N = 37;
+  size_t counts[] = {2, 3, 4};
+  for (size_t k=0; k<3; k++) {
+    size_t C = counts[k];
+    Buffer< std::complex<float> > in(N*C), back(N*C);
+    for (size_t i=0; i<N*C; i++) { in[i] = std::complex<float>(i/C, i%C); }
+    MultiBuffer< std::complex<float> > multi(C, N);
+    size_t n = multi.deinterleave(in);
+    bool ok = true, aligned = true;
+    for (size_t c=0; c<C; c++) {
+      aligned &= (0 == (size_t(multi.lane(c)) % 64));
+      for (size_t s=0; s<N; s++) { ok &= (multi[c][s] == std::complex<float>(s, c)); }
+    }
+    multi.interleave(back);
+    for (size_t i=0; i<N*C; i++) { ok &= (back[i] == in[i]); }
+    std::cout << C << " channels: " << n << " samples, aligned " << aligned << ", correct " << ok << std::endl;
+  }
+
+  // real samples, generic path
+  Buffer<int16_t> ri(12);
+  for (size_t i=0; i<12; i++) { ri[i] = int16_t(i); }
+  MultiBuffer<int16_t> rm(3, 4);
+  rm.deinterleave(ri);
+  std::cout << "Channel 1: " << rm[1] << std::endl;
+
+  // beamforming: steer towards a plane wave over 4 elements
+  const size_t C = 4, M = 64;
+  double phase = 0.7;
+  MultiBuffer< std::complex<float> > arr(C, M);
+  for (size_t c=0; c<C; c++) {
+    for (size_t s=0; s<M; s++) { arr.lane(c)[s] = std::exp(std::complex<float>(0, 0.1*s + phase*c)); }
+  }
+  std::vector< std::complex<float> > steer(C), other(C);
+  for (size_t c=0; c<C; c++) {
+    steer[c] = std::exp(std::complex<float>(0, -phase*c))/float(C);
+    other[c] = std::exp(std::complex<float>(0, phase*c))/float(C);
+  }
+  Buffer< std::complex<float> > beam(M);
+  arr.beamform(steer, beam);
+  std::cout << "Steered gain: " << std::floor(1000*beam.norm_l2()/std::sqrt(double(M))+0.5)/1000 << std::endl;
+  arr.beamform(other, beam);
+  std::cout << "Mis-steered gain: " << std::floor(1000*beam.norm_l2()/std::sqrt(double(M))+0.5)/1000 << std::endl;
+
+  // per-channel norms
+  for (size_t s=0; s<M; s++) { arr.lane(2)[s] *= 2; }
+  std::vector<double> norms = arr.norms();
+  std::cout << "Norms:";
+  for (size_t c=0; c<C; c++) { std::cout << " " << norms[c]; }
+  std::cout << std::endl;
+
+  // multi-channel ring with wrap-around
+  MultiCircularBuffer< std::complex<float> > ring(2, 10);
+  Buffer< std::complex<float> > il(2*7);
+  for (size_t i=0; i<14; i++) { il[i] = std::complex<float>(i/2, i%2); }
+  ring.pushInterleaved(il);
+  ring.drop(5);
+  ring.pushInterleaved(il);
+  std::cout << "Ring stored " << ring.stored() << ", free " << ring.free()
+            << ", push too much: " << ring.pushInterleaved(il) << std::endl;
+  std::pair< Buffer< std::complex<float> >, Buffer< std::complex<float> > > parts = ring.peek(1, 9);
+  std::cout << "Peek channel 1: " << parts.first << " + " << parts.second << std::endl;
+  MultiBuffer< std::complex<float> > out(2, 9);
+  ring.pull(out, 9);
+  std::cout << "Pulled channel 0: " << out[0] << std::endl;
+  std::cout << "Ring stored " << ring.stored() << std::endl;
+
+  return 0;
+}
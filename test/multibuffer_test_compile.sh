@@ -0,0 +1 @@
+gcc multibuffer_test.cpp ../src/buffer.cpp -lstdc++ -lm -o multibuffer_test.o
@@ -0,0 +1,81 @@
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../src/offline.h"
+#include "../src/fixed.h"
+#include "../src/cic.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+// FIR decimator followed by a CIC decimator
+class Chain: public ChunkChain<cint16, cint16> {
+  public:
+    Chain(const std::vector<float> &taps) : _taps(taps), _fir(taps, 2), _cic(3, 4) {}
+
+    ChunkChain<cint16, cint16> *clone() const { return new Chain(_taps); }
+
+    size_t maxOutputs(size_t N) const { return _cic.maxOutputs(_fir.maxOutputs(N)); }
+
+    size_t process(const Buffer<cint16> &in, const Buffer<cint16> &out) {
+      if (_tmp.size() < _fir.maxOutputs(in.size())) { _tmp = Buffer<cint16>(_fir.maxOutputs(in.size())); }
+      size_t n = _fir.process(in, _tmp);
+      return _cic.process(_tmp.head(n), out);
+    }
+
+  protected:
+    std::vector<float> _taps;
+    FixedFIR _fir;
+    CICDecimator<cint16> _cic;
+    Buffer<cint16> _tmp;
+};
+
+
+int main() {
+
+  // write a recording
+  const size_t N = 100000;
+  const char *path = "/tmp/sdr_offline_test.bin";
+  {
+    std::vector<cint16> samples(N);
+    for (size_t i=0; i<N; i++) {
+      samples[i] = cint16(int16_t(10000*std::cos(0.01*i)), int16_t((i*7919)%20000-10000));
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char *)&samples[0], N*sizeof(cint16));
+  }
+
+  // zero-copy views of the mapped file
+  MappedFile file(path);
+  std::cout << "Mapped: " << file.isOpen() << ", samples: " << file.count<cint16>() << std::endl;
+  Buffer<cint16> input = file.view<cint16>();
+  std::cout << "Tail view: " << file.view<cint16>(N-10, 100).size() << " samples" << std::endl;
+  MappedFile moved(std::move(file));
+  std::cout << "Moved: " << moved.isOpen() << ", source: " << file.isOpen() << std::endl;
+  file = std::move(moved);
+
+  // sequential reference
+  std::vector<float> taps(15, 1./15);
+  Chain chain(taps);
+  Chain *seq = static_cast<Chain *>(chain.clone());
+  Buffer<cint16> ref(seq->maxOutputs(N));
+  size_t nref = seq->process(input, ref);
+  delete seq;
+
+  // parallel chunks: the chain has 15 + 2*3*4 samples of memory, the
+  // total decimation is 8
+  ChunkedProcessor<cint16, cint16> proc(chain, 9999, 64, 8, 4, 1000);
+  std::cout << "Chunk " << proc.chunk() << ", warm-up " << proc.warmup()
+            << ", chunks " << proc.numChunks(N) << ", threads " << proc.threads() << std::endl;
+  size_t order_ok = 1, next = 0;
+  size_t total = proc.run(input, [&](size_t c, const Buffer<cint16> &) { order_ok &= (c == next++); });
+  Buffer<cint16> out = proc.run(input);
+  size_t diffs = 0;
+  for (size_t i=0; i<std::min(nref, out.size()); i++) { diffs += (out[i] != ref[i]); }
+  std::cout << "Outputs: " << out.size() << " (sequential " << nref << ", sink " << total << ")"
+            << ", in order: " << order_ok << ", differences: " << diffs << std::endl;
+
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1 @@
+gcc offline_test.cpp ../src/offline.cpp ../src/fixed.cpp ../src/buffer.cpp -pthread -lstdc++ -lm -o offline_test.o
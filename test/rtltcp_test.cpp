@@ -0,0 +1,124 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "../src/rtltcp.h"
+#include "../src/logger.h"
+using namespace sdr;
+
+
+// receives exactly n bytes
+static bool recvAll(int fd, uint8_t *data, size_t n) {
+  while (n) {
+    ssize_t r = recv(fd, data, n, 0);
+    if (0 >= r) { return false; }
+    data += r; n -= size_t(r);
+  }
+  return true;
+}
+
+// prints the commands received by the server
+static void printCommands(const uint8_t *data, size_t n) {
+  for (size_t i=0; (i+5)<=n; i+=5) {
+    uint32_t value = (uint32_t(data[i+1]) << 24) | (uint32_t(data[i+2]) << 16) |
+                     (uint32_t(data[i+3]) << 8) | uint32_t(data[i+4]);
+    std::cout << "  command " << int(data[i]) << " = " << value << std::endl;
+  }
+}
+
+// Loopback stand-in for rtl_tcp: the first connection sends 300001 bytes
+// in odd-sized chunks and closes, the second one sends 100000 bytes and
+// then goes silent until the client gives up.
+static void server(int listener) {
+  const uint8_t header[12] = { 'R','T','L','0', 0,0,0,5, 0,0,0,29 };
+  for (int conn=0; conn<2; conn++) {
+    int fd = accept(listener, 0, 0);
+    if (0 > fd) { return; }
+    send(fd, header, sizeof(header), MSG_NOSIGNAL);
+    // commands sent before connecting (or replayed)
+    uint8_t commands[15];
+    size_t expected = (0 == conn) ? 10 : 15;
+    recvAll(fd, commands, expected);
+    std::cout << "Server connection " << conn << ":" << std::endl;
+    printCommands(commands, expected);
+    size_t total = (0 == conn) ? 300001 : 100000, sent = 0;
+    std::vector<uint8_t> chunk(4093);
+    while (sent < total) {
+      size_t n = std::min(chunk.size(), total-sent);
+      for (size_t i=0; i<n; i++) { chunk[i] = uint8_t(sent+i); }
+      if (0 >= send(fd, chunk.data(), n, MSG_NOSIGNAL)) { break; }
+      sent += n;
+    }
+    if (0 == conn) {
+      // gain mode set by the client once streaming
+      recvAll(fd, commands, 5);
+      printCommands(commands, 5);
+    } else {
+      // silent until the client drops the connection
+      uint8_t c;
+      while (0 < recv(fd, &c, 1, 0)) {}
+    }
+    close(fd);
+  }
+}
+
+
+int main() {
+
+  StreamLogHandler *handler = new StreamLogHandler(std::cout, LOG_INFO);
+  Logger::get().addHandler(handler);
+
+  // loopback listener on a free port
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  bind(listener, (struct sockaddr *)&addr, sizeof(addr));
+  listen(listener, 1);
+  getsockname(listener, (struct sockaddr *)&addr, &len);
+  std::thread thread(server, listener);
+
+  // small ring: the reads are throttled by the consumer
+  CircularBuffer<uint8_t> ring(16384);
+  RTLTcpSource source("127.0.0.1", ntohs(addr.sin_port), ring, 300, 50);
+  std::cout << "Queued before connect: " << source.setFrequency(100000000) << " "
+            << source.setSampleRate(2048000) << std::endl;
+
+  size_t connection = 0, position = 0, errors = 0, polls = 0;
+  uint64_t consumed = 0;
+  bool gain = false;
+  Buffer<uint8_t> block(16384);
+  while ((source.stalls() < 1) && (polls < 100000)) {
+    source.poll(100);
+    polls++;
+    if (source.connections() != connection) {
+      std::cout << "Connection " << source.connections() << ", tuner " << RTLTcpSource::tunerName(source.tunerType())
+                << ", " << source.gainCount() << " gain steps" << std::endl;
+      connection = source.connections();
+      position = 0;
+    }
+    if ((! gain) && source.isStreaming() && ring.stored()) {
+      gain = source.setGainMode(true);
+    }
+    // every connection restarts the byte pattern, pairs are complete
+    size_t n = ring.stored();
+    ring.pull(block, n);
+    for (size_t i=0; i<n; i++, position++) { errors += (block[i] != uint8_t(position)); }
+    consumed += n;
+  }
+  thread.join();
+  close(listener);
+
+  std::cout << "Received " << source.received() << " bytes, consumed " << consumed
+            << ", errors " << errors << std::endl;
+  std::cout << "Connections " << source.connections() << ", stalls " << source.stalls()
+            << ", state " << source.state() << std::endl;
+  std::cout << "Ring full " << (source.ringFull() ? "yes" : "no") << std::endl;
+
+  return 0;
+}
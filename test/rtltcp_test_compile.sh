@@ -0,0 +1 @@
+gcc rtltcp_test.cpp ../src/rtltcp.cpp ../src/logger.cpp ../src/buffer.cpp -pthread -lstdc++ -lm -o rtltcp_test.o
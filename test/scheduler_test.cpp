@@ -0,0 +1,99 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/scheduler.h"
+#include "../src/broadcast.h"
+#include "../src/logger.h"
+#include <inttypes.h>
+using namespace sdr;
+
+// Generates blocks of consecutive integers
+class Source: public Stage {
+  public:
+    Source(BroadcastBuffer<int> &out, size_t blocks)
+      : _out(out), _block(64), _count(0), _blocks(blocks) {}
+    virtual bool ready() const { return (_count < _blocks) && (_out.free() >= _block.size()); }
+    virtual void process() {
+      for (size_t i=0; i<_block.size(); i++) { _block[i] = 1; }
+      _out.push(_block);
+      _count++;
+    }
+  protected:
+    BroadcastBuffer<int> &_out;
+    Buffer<int> _block;
+    size_t _count, _blocks;
+};
+
+// Sums everything it reads from its reader slot
+class Sink: public Stage {
+  public:
+    Sink(BroadcastBuffer<int> &in)
+      : _in(in), _reader(in.addReader()), _sum(0) {}
+    virtual bool ready() const { return _in.available(_reader) > 0; }
+    virtual void process() {
+      Buffer<int> view = _in.peek(_reader, 256);
+      for (size_t i=0; i<view.size(); i++) { _sum += view[i]; }
+      _in.drop(_reader, view.size());
+    }
+    inline int64_t sum() const { return _sum.load(); }
+  protected:
+    BroadcastBuffer<int> &_in;
+    int _reader;
+    std::atomic<int64_t> _sum;
+};
+
+// Ready once triggered from outside the scheduler
+class Trigger: public Stage {
+  public:
+    Trigger() : _pending(false), _count(0) {}
+    virtual bool ready() const { return _pending.load(); }
+    virtual void process() { _pending = false; _count++; }
+    inline void fire() { _pending = true; }
+    inline int count() const { return _count.load(); }
+  protected:
+    std::atomic<bool> _pending;
+    std::atomic<int> _count;
+};
+
+
+int main() {
+
+  StreamLogHandler *handler = new StreamLogHandler(std::cout, LOG_INFO);
+  Logger::get().addHandler(handler);
+
+  const size_t blocks = 10000;
+  BroadcastBuffer<int> ring(1024);
+  Source source(ring, blocks);
+  Sink sink1(ring), sink2(ring);
+  source.connect(&sink1);
+  source.connect(&sink2);
+
+  std::cout << "Test scheduler" << std::endl;
+  Scheduler scheduler(4);
+  scheduler.add(&source);
+  scheduler.add(&sink1);
+  scheduler.add(&sink2);
+  scheduler.start();
+  while ((sink1.sum() < int64_t(64*blocks)) || (sink2.sum() < int64_t(64*blocks))) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  scheduler.stop();
+  std::cout << "Sums: " << sink1.sum() << ", " << sink2.sum() << std::endl;
+  scheduler.logStats();
+
+  std::cout << "Test notify of idle workers" << std::endl;
+  Trigger trigger;
+  Scheduler idle(2);
+  idle.add(&trigger);
+  idle.start();
+  // let the workers back off
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  trigger.fire();
+  idle.notify();
+  for (int i=0; (i<1000) && (0 == trigger.count()); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  idle.stop();
+  std::cout << "Processed after notify: " << trigger.count() << std::endl;
+
+  return 0;
+}
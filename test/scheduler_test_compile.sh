@@ -0,0 +1 @@
+gcc scheduler_test.cpp ../src/scheduler.cpp ../src/buffer.cpp ../src/logger.cpp -lstdc++ -lm -pthread -o scheduler_test.o
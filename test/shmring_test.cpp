@@ -0,0 +1,82 @@
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/shmring.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+int main() {
+
+  const char *name = "/sdr-shmring-test";
+  const size_t BLOCK = 1000, BLOCKS = 200;
+
+  // writer creates the segment: complex float samples
+  SharedCircularBuffer writer(name, 16384, 1, sizeof(std::complex<float>));
+  std::cout << "Created: " << writer.isOpen() << ", capacity " << writer.capacity()
+            << ", format " << writer.format() << ", element " << writer.element() << std::endl;
+
+  // in-process reader
+  SharedCircularReader local(name);
+  std::cout << "Local reader: " << local.isOpen() << ", slot " << local.slot() << std::endl;
+
+  // reader process
+  pid_t pid = fork();
+  if (0 == pid) {
+    SharedCircularReader reader(name);
+    if (! reader.isOpen()) { _exit(2); }
+    uint64_t expected = 0, errors = 0;
+    while (reader.waitReadable(sizeof(std::complex<float>), 1000)) {
+      Buffer< std::complex<float> > view = reader.peek< std::complex<float> >();
+      for (size_t i=0; i<view.size(); i++, expected++) {
+        errors += (view[i] != std::complex<float>(expected, -float(expected)));
+      }
+      reader.drop(view.size()*sizeof(std::complex<float>));
+    }
+    _exit(((BLOCK*BLOCKS == expected) && (0 == errors)) ? 0 : 1);
+  }
+
+  // wait for the reader process to attach
+  while (writer.readers() < 2) { usleep(1000); }
+  std::cout << "Readers attached: " << writer.readers() << std::endl;
+
+  // the local reader drains along; the ring (2048 samples) wraps many times
+  Buffer< std::complex<float> > block(BLOCK);
+  uint64_t local_count = 0, local_errors = 0, views_split = 0;
+  for (size_t b=0; b<BLOCKS; b++) {
+    for (size_t i=0; i<BLOCK; i++) { block[i] = std::complex<float>(b*BLOCK+i, -float(b*BLOCK+i)); }
+    while (! writer.push(block)) {
+      // drain the local reader, wait for the other process
+      Buffer< std::complex<float> > view = local.peek< std::complex<float> >();
+      size_t idx = size_t(local_count*sizeof(std::complex<float>) % writer.capacity());
+      views_split += (idx + view.size()*sizeof(std::complex<float>)) > writer.capacity();
+      for (size_t i=0; i<view.size(); i++, local_count++) {
+        local_errors += (view[i] != std::complex<float>(local_count, -float(local_count)));
+      }
+      local.drop(view.size()*sizeof(std::complex<float>));
+      writer.waitWritable(block.bytesLen(), 100);
+    }
+  }
+  writer.close();
+  Buffer< std::complex<float> > view = local.peek< std::complex<float> >();
+  for (size_t i=0; i<view.size(); i++, local_count++) {
+    local_errors += (view[i] != std::complex<float>(local_count, -float(local_count)));
+  }
+  local.drop(view.bytesLen());
+  std::cout << "Local reader: " << local_count << " samples, errors " << local_errors
+            << ", contiguous views across the wrap: " << (views_split > 0) << std::endl;
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  std::cout << "Reader process: " << (WIFEXITED(status) && (0 == WEXITSTATUS(status)) ? "ok" : "failed") << std::endl;
+
+  // writer-side zero-copy reservation
+  RawBuffer slot = writer.reserve(16);
+  std::cout << "Reserved: " << slot.bytesLen() << " bytes" << std::endl;
+  size_t first = writer.commit(100);
+  std::cout << "Committed: " << first << " of 100, without reservation: " << writer.commit(16) << std::endl;
+  std::cout << "Attach to missing segment: " << SharedCircularReader("/sdr-shmring-missing").isOpen() << std::endl;
+
+  return 0;
+}
@@ -0,0 +1 @@
+gcc shmring_test.cpp ../src/shmring.cpp ../src/buffer.cpp -lstdc++ -lm -o shmring_test.o
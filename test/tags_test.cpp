@@ -0,0 +1,87 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/tags.h"
+#include "../src/cic.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+// prints the tags of a view as (index: key=value)
+template <class T>
+static void printTags(const char *name, const TaggedBuffer<T> &block) {
+  std::cout << name << " [" << block.offset() << ", +" << block.size() << "):";
+  TagRange range = block.tags();
+  for (const Tag *t=range.begin(); t!=range.end(); t++) {
+    std::cout << " (" << block.index(*t) << ": " << t->key << "=" << t->value << ")";
+  }
+  std::cout << std::endl;
+}
+
+
+int main() {
+
+  // views select their tags without copying
+  std::cout << "Test views" << std::endl;
+  std::vector<Tag> list;
+  list.push_back(Tag(7000, TAG_GAIN, 20));
+  list.push_back(Tag(5010, TAG_FREQUENCY, 100e6));
+  list.push_back(Tag(5500, TAG_FREQUENCY, 101e6));
+  list.push_back(Tag(5999, TAG_USER, 1));
+  TaggedBuffer<float> block(Buffer<float>(1000), 5000, TagSet(list));
+  printTags("block", block);
+  printTags("sub(500,200)", block.sub(500, 200));
+  printTags("tail(1)", block.tail(1));
+  printTags("head(10)", block.head(10));
+  std::cout << "head(10) tagged: " << block.head(10).hasTags() << ", untagged storage: "
+            << TaggedBuffer<float>(Buffer<float>(10), 0).tagSet().size() << std::endl;
+
+  // tags move with the ring cursors
+  std::cout << "Test ring" << std::endl;
+  TaggedCircularBuffer<float> ring(1000);
+  Buffer<float> input(300), output(1000);
+  ring.push(input);
+  ring.tag(TAG_FREQUENCY, 433.92e6);
+  ring.push(input);
+  ring.push(block.sub(500, 200));
+  std::cout << "Written " << ring.written() << ", stored " << ring.stored() << ", tags " << ring.pendingTags() << std::endl;
+  printTags("pull(350)", ring.pullTagged(output, 350));
+  ring.drop(100);
+  printTags("pull(rest)", ring.pullTagged(output, ring.stored()));
+  std::cout << "Taken " << ring.taken() << ", tags " << ring.pendingTags() << std::endl;
+
+  // overwritten samples: tags move to the oldest sample, plus an overrun tag
+  std::cout << "Test overrun" << std::endl;
+  TaggedCircularBuffer<float> lossy(500, true);
+  lossy.push(input);
+  lossy.tag(TAG_GAIN, 10);
+  lossy.push(input);
+  lossy.push(input);
+  printTags("pull(all)", lossy.pullTagged(output, lossy.stored()));
+
+  // decimation: tags land on the output sample containing the input
+  std::cout << "Test decimation" << std::endl;
+  CICDecimator<int16_t> cic(3, 4);
+  TagRateChange rate(1, 4);
+  Buffer<int16_t> in(101), out(cic.maxOutputs(101));
+  for (size_t i=0; i<in.size(); i++) { in[i] = 100; }
+  uint64_t offset = 1000;
+  for (int b=0; b<4; b++, offset+=in.size()) {
+    std::vector<Tag> tags;
+    if (0 == b) { tags.push_back(Tag(offset+3, TAG_USER, 0)); tags.push_back(Tag(offset+4, TAG_USER, 1)); }
+    if (1 == b) { tags.push_back(Tag(offset+99, TAG_USER, 2)); }
+    if (2 == b) { tags.push_back(Tag(offset+100, TAG_USER, 3)); }
+    TaggedBuffer<int16_t> tagged(in, offset, TagSet(tags));
+    size_t n = cic.process(in, out);
+    printTags("output", rate.apply(tagged, out, n));
+  }
+
+  // resampling by 3/2
+  std::cout << "Test resampling" << std::endl;
+  TagRateChange resample(3, 2, 500);
+  std::vector<Tag> tags(1, Tag(10, TAG_TIME, 1.5));
+  Buffer<float> x(10), y(15);
+  printTags("output", resample.apply(TaggedBuffer<float>(x, 0), y, 15));
+  printTags("output", resample.apply(TaggedBuffer<float>(x, 10, TagSet(tags)), y, 15));
+
+  return 0;
+}
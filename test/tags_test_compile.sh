@@ -0,0 +1 @@
+gcc tags_test.cpp ../src/buffer.cpp -lstdc++ -lm -o tags_test.o
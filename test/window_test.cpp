@@ -0,0 +1,59 @@
+#include <iostream>
+#include <stdlib.h>
+#include "../src/window.h"
+#include <inttypes.h>
+using namespace sdr;
+
+
+int main() {
+
+  // sliding statistics against direct computation over the last W samples
+  const size_t W = 50, N = 1000;
+  Buffer< std::complex<float> > x(N);
+  for (size_t i=0; i<N; i++) {
+    x[i] = std::complex<float>(std::cos(0.1*i)*(1+(i%97)/10.), std::sin(0.3*i)+0.5);
+  }
+  SlidingWindow< std::complex<float> > win(W, 2);
+  double max_err = 0;
+  size_t offset = 0, len = 1;
+  while (offset < N) {
+    size_t n = std::min(len, N-offset);
+    win.push(x.sub(offset, n));
+    offset += n; len = (len*5+2) % 73;
+    // direct
+    size_t S = std::min(W, offset);
+    std::complex<double> sum(0, 0);
+    double pwr = 0, peak = 0;
+    for (size_t i=offset-S; i<offset; i++) {
+      sum += std::complex<double>(x[i].real(), x[i].imag());
+      pwr += std::norm(std::complex<double>(x[i].real(), x[i].imag()));
+      peak = std::max(peak, std::norm(std::complex<double>(x[i].real(), x[i].imag())));
+    }
+    max_err = std::max(max_err, std::abs(win.mean()-sum/double(S)));
+    max_err = std::max(max_err, std::abs(win.power()-pwr/S));
+    max_err = std::max(max_err, std::abs(win.peak()-peak));
+  }
+  std::cout << "Pushed: " << win.count() << ", stored: " << win.stored() << std::endl;
+  std::cout << "Sliding statistics max. error: " << (max_err < 1e-9 ? "< 1e-9" : "too large") << std::endl;
+
+  // real samples, block larger than the window
+  SlidingWindow<int16_t> rwin(4);
+  Buffer<int16_t> r(6);
+  for (size_t i=0; i<6; i++) { r[i] = int16_t(i*10); }
+  rwin.push(r);
+  std::cout << "Real: mean " << rwin.mean() << ", power " << rwin.power() << ", peak " << rwin.peak() << std::endl;
+
+  // squelch with hysteresis: noise floor, burst, fading tail
+  EnergyDetector< std::complex<float> > squelch(64, -20, -26);
+  Buffer< std::complex<float> > block(64);
+  double levels[] = {-40, -40, -10, -10, -22, -22, -30, -30};
+  for (size_t b=0; b<8; b++) {
+    float a = std::pow(10., levels[b]/20);
+    for (size_t i=0; i<64; i++) { block[i] = a*std::exp(std::complex<float>(0, 0.7*i)); }
+    bool open = squelch.process(block);
+    std::cout << "Level " << levels[b] << " dB: " << (open ? "open" : "closed") << std::endl;
+  }
+  std::cout << "Transitions: " << squelch.transitions() << std::endl;
+
+  return 0;
+}
@@ -0,0 +1 @@
+gcc window_test.cpp ../src/buffer.cpp -lstdc++ -lm -o window_test.o